@@ -23,7 +23,6 @@ int BmcComponent::update(string image_path)
   string dev;
   int ret;
   string flash_image = image_path;
-  stringstream cmd_str;
   string comp = this->component();
   char key[MAX_KEY_LEN] = {0}, value[MAX_VALUE_LEN] = {0};
 
@@ -118,14 +117,14 @@ int BmcComponent::update(string image_path)
     kv_set(key, get_bmc_version().c_str(), 0, 0);
   }
 
-  cmd_str << "flashcp -v " << flash_image << " " << dev;
-  ret = sys().runcmd(cmd_str.str());
+  sys().output << "Flashing to device: " << dev << endl;
+  ret = sys().flash_mtd(flash_image, dev);
   if (_writable_offset > 0) {
     // this is a temp. file, remove it.
     remove(flash_image.c_str());
   }
 
-  // If flashcp cmd was successful, keep historical info that BMC fw was upgraded
+  // If flashing was successful, keep historical info that BMC fw was upgraded
   if (ret == 0) {
     syslog(LOG_CRIT, "BMC fw upgrade completed. Version: %s", get_bmc_version().c_str());
   }
@@ -1,7 +1,6 @@
 #include <arpa/inet.h>
 #include <nlohmann/json.hpp>
 #include <openssl/evp.h>
-#include <openssl/md5.h>
 #include <openssl/sha.h>
 #include <zlib.h>
 #include <iomanip>
@@ -19,30 +18,54 @@ using nlohmann::json;
 #define EVP_MD_CTX_free EVP_MD_CTX_destroy
 #endif
 
-std::string getMd5(const char* data, size_t size) {
-  unsigned int MD5Len = EVP_MD_size(EVP_md5());
-  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
-  EVP_DigestInit_ex(ctx, EVP_md5(), NULL);
-  EVP_DigestUpdate(ctx, data, size);
-  auto MD5Digest = (unsigned char*)OPENSSL_malloc(MD5Len);
-  EVP_DigestFinal_ex(ctx, MD5Digest, &MD5Len);
-  EVP_MD_CTX_free(ctx);
+static std::string toHex(const unsigned char* digest, size_t len) {
   std::stringstream ss;
-  for (size_t i = 0; i < MD5Len; i++) {
-    unsigned int v = (unsigned int)MD5Digest[i];
+  for (size_t i = 0; i < len; i++) {
+    unsigned int v = (unsigned int)digest[i];
     ss << std::setw(2) << std::hex << std::setfill('0') << v;
   }
   return ss.str();
 }
 
+// Digest of a region of the image, read once a chunk at a time.
+static unsigned int getDigest(
+    const Image& image,
+    const EVP_MD* md,
+    const void* data,
+    size_t size,
+    unsigned char* digest) {
+  unsigned int len = 0;
+  EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(ctx, md, NULL);
+  try {
+    image.forEachChunk(data, size, [ctx](const char* chunk, size_t chunkLen) {
+      EVP_DigestUpdate(ctx, chunk, chunkLen);
+    });
+  } catch (...) {
+    EVP_MD_CTX_free(ctx);
+    throw;
+  }
+  EVP_DigestFinal_ex(ctx, digest, &len);
+  EVP_MD_CTX_free(ctx);
+  return len;
+}
+
+std::string getMd5(const char* data, size_t size) {
+  unsigned char MD5Digest[EVP_MAX_MD_SIZE];
+  unsigned int MD5Len = 0;
+  EVP_Digest(data, size, MD5Digest, &MD5Len, EVP_md5(), NULL);
+  return toHex(MD5Digest, MD5Len);
+}
+
 void validateRaw(
     const Image& image,
     size_t offset,
     size_t size,
     const std::string& expectedDigest) {
   char* data = image.peek(offset, size);
-  std::string md5 = getMd5(data, size);
-  if (md5 != expectedDigest) {
+  unsigned char MD5Digest[EVP_MAX_MD_SIZE];
+  unsigned int MD5Len = getDigest(image, EVP_md5(), data, size, MD5Digest);
+  if (toHex(MD5Digest, MD5Len) != expectedDigest) {
     throw std::runtime_error("Bad MD5");
   }
 }
@@ -80,9 +103,13 @@ void validateLegacy(const Image& image, size_t offset, size_t size) {
   if (len + HEADER_SIZE > size) {
     throw std::runtime_error("Size mismatch");
   }
-  unsigned char* data =
-      (unsigned char*)image.peekExact(offset + HEADER_SIZE, len);
-  uint32_t dcrc_c = crc32(0, data, len);
+  uint32_t dcrc_c = crc32(0, Z_NULL, 0);
+  image.forEachChunk(
+      image.peekExact(offset + HEADER_SIZE, len),
+      len,
+      [&dcrc_c](const char* chunk, size_t chunkLen) {
+        dcrc_c = crc32(dcrc_c, (const unsigned char*)chunk, chunkLen);
+      });
   if (dcrc != dcrc_c) {
     throw std::runtime_error("Data CRC mismatch");
   }
@@ -115,7 +142,11 @@ const unsigned char* getNodeData(const void* fdt, int node, size_t& dataSize) {
   return data;
 }
 
-void validateFITNode(const void* fdt, int node, size_t maxSize) {
+void validateFITNode(
+    const Image& image,
+    const void* fdt,
+    int node,
+    size_t maxSize) {
   size_t dataSize;
   const unsigned char* data = getNodeData(fdt, node, dataSize);
   if (dataSize > maxSize) {
@@ -124,8 +155,8 @@ void validateFITNode(const void* fdt, int node, size_t maxSize) {
     // description
     throw std::runtime_error("FDT larger than partition");
   }
-  unsigned char shasum[SHA256_DIGEST_LENGTH];
-  SHA256(data, dataSize, shasum);
+  unsigned char shasum[EVP_MAX_MD_SIZE];
+  getDigest(image, EVP_sha256(), data, dataSize, shasum);
 
   // Get the sha256 digest stored in the image */
   int hashnode = fdt_subnode_offset(fdt, node, "hash@1");
@@ -206,7 +237,7 @@ void validateFIT(
     if (node < 0) {
       continue;
     }
-    validateFITNode(fdt, node, size);
+    validateFITNode(image, fdt, node, size);
     numNodes++;
   }
   nodep = fdt_subnode_offset(fdt, 0, "configurations");
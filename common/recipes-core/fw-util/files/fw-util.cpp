@@ -37,6 +37,7 @@
 #endif
 #include "fw-util.h"
 #include "scheduler.h"
+#include "update_plan.h"
 using namespace std;
 
 std::atomic<int> signal_received{0};
@@ -123,6 +124,20 @@ int AliasComponent::print_version()
   return _target_comp->print_version();
 }
 
+string AliasComponent::update_resource()
+{
+  if (!setup())
+    return Component::update_resource();
+  return _target_comp->update_resource();
+}
+
+size_t AliasComponent::update_rate()
+{
+  if (!setup())
+    return Component::update_rate();
+  return _target_comp->update_rate();
+}
+
 void AliasComponent::set_update_ongoing(int timeout)
 {
   if (setup())
@@ -150,6 +165,7 @@ void usage()
   cout << "       " << exec_name << " FRU --update COMPONENT IMAGE_PATH --schedule now" << endl;
   cout << "       " << exec_name << " all --show-schedule" << endl;
   cout << "       " << exec_name << " all --delete-schedule TASK_ID" << endl;
+  cout << "       " << exec_name << " all --update-plan PLAN_JSON [--jobs N] [--dry-run]" << endl;
   cout << endl;
   cout << left << setw(10) << "FRU" << " : Components" << endl;
   cout << "---------- : ----------" << endl;
@@ -207,6 +223,8 @@ int main(int argc, char *argv[])
   json json_array(nullptr);
   bool add_task = false;
   Scheduler tasker;
+  UpdatePlan plan;
+  unsigned max_jobs = 4;
 
   if (action == "--force") {
     if (argc < 4) {
@@ -226,7 +244,7 @@ int main(int argc, char *argv[])
         cerr << "         Use: --version|--update " << component << " instead" << endl;
       }
     }
-  } else {
+  } else if (action != "--update-plan") {
     if (argc >= 4) {
       component.assign(argv[3]);
       if (component.compare(0, 2, "--") == 0) {
@@ -313,6 +331,29 @@ int main(int argc, char *argv[])
       return -1;
     }
     return tasker.del_task(task_id);
+  } else if (action == "--update-plan") {
+    bool dry_run = false;
+    if (fru != "all" || argc < 4) {
+      usage();
+      return -1;
+    }
+    for (int i = 4; i < argc; i++) {
+      string opt(argv[i]);
+      if (opt == "--dry-run") {
+        dry_run = true;
+      } else if (opt == "--jobs" && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+        max_jobs = atoi(argv[++i]);
+      } else {
+        usage();
+        return -1;
+      }
+    }
+    if (!plan.load(string(argv[3]))) {
+      return -1;
+    }
+    if (dry_run) {
+      return plan.dry_run(max_jobs);
+    }
   } else {
     cerr << "Invalid action: " << action << endl;
     usage();
@@ -326,6 +367,18 @@ int main(int argc, char *argv[])
   sigaction(SIGINT, &sa, NULL);
   sigaction(SIGTERM, &sa, NULL);
   sigaction(SIGPIPE, &sa, NULL); // for ssh terminate
+
+  if (action == "--update-plan") {
+    if (system.wait_shutdown_non_executable(2)) {
+      syslog(LOG_WARNING, "fw-util: shutdown command can still be executed after 2 seconds waiting");
+    }
+    if (system.is_reboot_ongoing()) {
+      cout << "Aborted action due to reboot ongoing" << endl;
+      return -1;
+    }
+    return plan.run(max_jobs);
+  }
+
   //print the fw version or do the fw update when the fru and the comp are found
   for (auto fkv : *Component::fru_list) {
     if (fru == "all" || fru == fkv.first) {
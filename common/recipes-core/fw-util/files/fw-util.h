@@ -81,6 +81,14 @@ class Component {
     virtual int dump(std::string /*image*/) { return FW_STATUS_NOT_SUPPORTED; }
     virtual int print_version() { return FW_STATUS_NOT_SUPPORTED; }
     virtual int get_version(json&) { return FW_STATUS_NOT_SUPPORTED; }
+    // Updates holding the same resource (a bus, a bridge IC) never run
+    // concurrently in an update plan. Update code shares globals and
+    // library state across FRUs, so all updates hold the same resource
+    // unless a platform knows its updates of a component can overlap, and
+    // returns e.g. the FRU.
+    virtual std::string update_resource() { return "fw-util"; }
+    // Rough update throughput in bytes per second, for plan estimates.
+    virtual size_t update_rate() { return 16 * 1024; }
     virtual System& sys() {
       return _sys;
     }
@@ -111,6 +119,8 @@ class AliasComponent : public Component {
     int fupdate(std::string image) override;
     int dump(std::string image) override;
     int print_version() override;
+    std::string update_resource() override;
+    size_t update_rate() override;
 
     void set_update_ongoing(int timeout) override;
     bool is_update_ongoing() override;
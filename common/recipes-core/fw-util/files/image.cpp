@@ -35,3 +35,15 @@ Image::~Image() {
     fd_ = -1;
   }
 }
+
+void Image::advise(const char* ptr, size_t size, bool sequential) const {
+  // madvise() wants page aligned addresses. This is only a hint, the
+  // pages dropped are read again if needed.
+  static const uintptr_t pageMask = sysconf(_SC_PAGESIZE) - 1;
+  uintptr_t start = reinterpret_cast<uintptr_t>(ptr) & ~pageMask;
+  uintptr_t end = reinterpret_cast<uintptr_t>(ptr) + size;
+  (void)madvise(
+      reinterpret_cast<void*>(start),
+      end - start,
+      sequential ? MADV_SEQUENTIAL : MADV_DONTNEED);
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <algorithm>
 #include <stdexcept>
 #include <string>
 
@@ -26,4 +27,28 @@ class Image {
     }
     return buffer_ + offset;
   }
+
+  // Pass [data, data + size) of the image to fn a chunk at a time. The
+  // kernel reads the next chunks ahead while fn works on one, and the
+  // pages of a chunk are dropped once done with: hashing a partition
+  // keeps about a chunk of it resident, whatever its size.
+  template <typename F>
+  void forEachChunk(const void* data, size_t size, F&& fn) const {
+    auto ptr = static_cast<const char*>(data);
+    if (ptr < buffer_ || size_t(ptr - buffer_) + size > fsize_) {
+      throw std::runtime_error("Image too short");
+    }
+    advise(ptr, size, true);
+    while (size > 0) {
+      size_t len = std::min(size, chunkSize);
+      fn(ptr, len);
+      advise(ptr, len, false);
+      ptr += len;
+      size -= len;
+    }
+  }
+
+ private:
+  static constexpr size_t chunkSize = 1024 * 1024;
+  void advise(const char* ptr, size_t size, bool sequential) const;
 };
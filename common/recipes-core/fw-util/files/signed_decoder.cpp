@@ -5,69 +5,24 @@
 #include <sys/stat.h> // for stat()
 #include <openssl/evp.h> // for evp_md_ctx*
 
-#define MD5_READ_BYTES    (1024)
+#define COPY_CHUNK_BYTES  (64 * 1024)
 
 using namespace std;
 
-int InfoChecker::check_md5(const string &image_path, long offset, long size, uint8_t* data)
+int InfoChecker::check_md5(const uint8_t* buf, size_t size, const uint8_t* data)
 {
-  int fd, byte_num, read_bytes, ret = 0;
-  char read_buf[MD5_READ_BYTES] = {0};
   uint8_t md5_digest[EVP_MAX_MD_SIZE] = {0};
-  EVP_MD_CTX* ctx = NULL;
 
-  if (size <= 0) {
+  if (size == 0) {
     return MD5_ERR::SIZE_ERROR;
   }
-
-  fd = open(image_path.c_str(), O_RDONLY);
-  if (fd < 0) {
-    return MD5_ERR::FILE_ERROR;
-  }
-
-  ctx = EVP_MD_CTX_create();
-  EVP_MD_CTX_init(ctx);
-  ret = EVP_DigestInit(ctx, EVP_md5());
-  if (ret == 0) {
-    ret = MD5_ERR::MD5_INIT_ERROR;
-    goto exit;
-  }
-
-  lseek(fd, offset, SEEK_SET);
-  while (size > 0) {
-
-    if (size < MD5_READ_BYTES) {
-      read_bytes = size;
-      size = 0;
-    } else {
-      read_bytes = MD5_READ_BYTES;
-      size -= MD5_READ_BYTES;
-    }
-    byte_num = read(fd, read_buf, read_bytes);
-
-    ret = EVP_DigestUpdate(ctx, read_buf, byte_num);
-    if (ret == 0) {
-      syslog(LOG_WARNING, "%s(): failed to update context to calculate MD5 of %s.", __func__, image_path.c_str());
-      ret = MD5_ERR::MD5_UPDATE_ERROR;
-      goto exit;
-    }
+  if (EVP_Digest(buf, size, md5_digest, NULL, EVP_md5(), NULL) == 0) {
+    return MD5_ERR::MD5_FINAL_ERROR;
   }
-
-  ret = EVP_DigestFinal(ctx, md5_digest, NULL);
-  if (ret == 0) {
-    ret = MD5_ERR::MD5_FINAL_ERROR;
-    goto exit;
-  }
-
   if (memcmp(md5_digest, data, MD5_SIZE) != 0) {
-    ret = MD5_ERR::MD5_CHECKSUM_ERROR;
-    goto exit;
+    return MD5_ERR::MD5_CHECKSUM_ERROR;
   }
-
-  ret = MD5_ERR::MD5_SUCCESS;
-exit:
-  close(fd);
-  return ret;
+  return MD5_ERR::MD5_SUCCESS;
 }
 
 int InfoChecker::check_header_info(const signed_header_t& img_info)
@@ -172,13 +127,8 @@ int SignComponent::is_image_signed(const string& image_path, bool force)
   close(fd);
   image_size = (long)info_offs;
 
-  ret = check_md5(image_path, 0, info_offs, file_info.MD5_1);
-  if (ret != 0) {
-    syslog(LOG_WARNING, "%s MD5-1 check failed, error code: %d.\n", __func__, -ret);
-    return FORMAT_ERR::INVALID_SIGNATURE;
-  }
-
-  ret = check_md5(image_path, info_offs, SIGN_INFO_SIZE-MD5_SIZE, file_info.MD5_2);
+  // MD5-1, of the image itself, is checked by get_image() while copying it.
+  ret = check_md5((const uint8_t*)&file_info, SIGN_INFO_SIZE-MD5_SIZE, file_info.MD5_2);
   if (ret != 0) {
     syslog(LOG_WARNING, "%s MD5-2 check failed, error code: %d.\n", __func__, -ret);
     return FORMAT_ERR::INVALID_SIGNATURE;
@@ -194,66 +144,90 @@ int SignComponent::is_image_signed(const string& image_path, bool force)
   return FORMAT_ERR::SUCCESS;
 }
 
+// Copy the image without its sign info, computing its MD5-1 on the way:
+// the image is read once, a chunk at a time, and what is checked is what
+// gets flashed even if the original changes meanwhile.
 int SignComponent::get_image(string& image_path, bool force)
 {
   int src = -1, dst = -1, ret = FORMAT_ERR::SUCCESS;
-  vector<uint8_t> data(image_size);
+  vector<uint8_t> data(COPY_CHUNK_BYTES);
+  uint8_t md5_digest[EVP_MAX_MD_SIZE] = {0};
+  EVP_MD_CTX* ctx = NULL;
+  size_t remaining = image_size;
 
-  /*
-   *  Copy file with image_size
-   */
   src = open(image_path.c_str(), O_RDONLY);
   if (src < 0) {
     syslog(LOG_WARNING, "%s Cannot open %s for reading\n", __func__, image_path.c_str());
-    return FORMAT_ERR::INVALID_SIGNATURE;
+    return FORMAT_ERR::INVALID_FILE;
   }
+  posix_fadvise(src, 0, image_size, POSIX_FADV_SEQUENTIAL);
 
-  dst = open(temp_image_path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  dst = open(temp_image_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
   if (dst < 0) {
     close(src);
     syslog(LOG_WARNING, "%s Cannot open %s for writing\n", __func__, temp_image_path.c_str());
-    return FORMAT_ERR::INVALID_SIGNATURE;
+    return FORMAT_ERR::INVALID_FILE;
   }
 
-  if (read(src, data.data(), data.size()) != (int)image_size) {
-    syslog(LOG_WARNING, "%s Cannot read %s\n", __func__, image_path.c_str());
-    ret = FORMAT_ERR::INVALID_SIGNATURE;
+  ctx = EVP_MD_CTX_create();
+  if (EVP_DigestInit(ctx, EVP_md5()) == 0) {
+    ret = FORMAT_ERR::INVALID_FILE;
     goto file_exit;
   }
 
-  if (write(dst, data.data(), data.size()) != (int)image_size) {
-    syslog(LOG_WARNING, "%s Cannot write %s\n", __func__, temp_image_path.c_str());
-    ret = FORMAT_ERR::INVALID_SIGNATURE;
-    goto file_exit;
+  while (remaining > 0) {
+    ssize_t len = read(src, data.data(), min(remaining, data.size()));
+    if (len < 0 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      syslog(LOG_WARNING, "%s Cannot read %s\n", __func__, image_path.c_str());
+      ret = FORMAT_ERR::INVALID_FILE;
+      goto file_exit;
+    }
+    if (EVP_DigestUpdate(ctx, data.data(), len) == 0) {
+      syslog(LOG_WARNING, "%s(): failed to update context to calculate MD5 of %s.", __func__, image_path.c_str());
+      ret = FORMAT_ERR::INVALID_FILE;
+      goto file_exit;
+    }
+    if (write(dst, data.data(), len) != len) {
+      syslog(LOG_WARNING, "%s Cannot write %s\n", __func__, temp_image_path.c_str());
+      ret = FORMAT_ERR::INVALID_FILE;
+      goto file_exit;
+    }
+    remaining -= len;
   }
   close(src);
   close(dst);
   src = -1;
   dst = -1;
 
-  // chmod to 0400 (read only)
-  if (chmod(temp_image_path.c_str(), S_IRUSR) < 0) {
-    syslog(LOG_WARNING, "%s Cannot change %s mode\n", __func__, temp_image_path.c_str());
-    ret = FORMAT_ERR::INVALID_SIGNATURE;
-    goto file_exit;
-  }
-
   if (!force) {
-    ret = check_md5(temp_image_path, 0, image_size, md5);
-    if (ret != 0) {
-      syslog(LOG_WARNING, "%s MD5-1 check failed, error code: %d.\n", __func__, -ret);
+    if (EVP_DigestFinal(ctx, md5_digest, NULL) == 0 ||
+        memcmp(md5_digest, md5, MD5_SIZE) != 0) {
+      syslog(LOG_WARNING, "%s MD5-1 check failed, error code: %d.\n", __func__, -MD5_ERR::MD5_CHECKSUM_ERROR);
       ret = FORMAT_ERR::INVALID_SIGNATURE;
       goto file_exit;
     }
   }
 
+  // chmod to 0400 (read only)
+  if (chmod(temp_image_path.c_str(), S_IRUSR) < 0) {
+    syslog(LOG_WARNING, "%s Cannot change %s mode\n", __func__, temp_image_path.c_str());
+    ret = FORMAT_ERR::INVALID_FILE;
+    goto file_exit;
+  }
+
   image_path = temp_image_path;
 
 file_exit:
+  EVP_MD_CTX_destroy(ctx);
   if (src >= 0)
     close(src);
   if (dst >= 0)
     close(dst);
+  if (ret != FORMAT_ERR::SUCCESS)
+    delete_image();
   return ret;
 }
 
@@ -273,6 +247,10 @@ int SignComponent::signed_image_update(string image, bool force)
   }
 
   ret = get_image(image, force);
+  if (ret == FORMAT_ERR::INVALID_SIGNATURE) {
+    printf("Firmware not valid. error(%d)\n", -ret);
+    return -1;
+  }
   if (ret) {
     printf("Get copy file. error(%d)\n", -ret);
     return -1;
@@ -85,7 +85,7 @@ struct pldm_image_signed_info_map {
 class InfoChecker {
   protected:
     signed_header_t comp_info{};
-    static int check_md5(const std::string& image_path, long offset, long size, uint8_t* data);
+    static int check_md5(const uint8_t* buf, size_t size, const uint8_t* data);
     int check_header_info(const signed_header_t&);
 
   public:
@@ -110,7 +110,7 @@ class SignComponent : public InfoChecker
   protected:
     static signed_header_t get_info(FW_IMG_INFO&);
     int is_image_signed(const std::string& image_path, bool force); // check signed info and store.
-    int get_image(std::string& /*image*/, bool /*force*/); // would change original file path to temp file path.
+    int get_image(std::string& /*image*/, bool /*force*/); // would change original file path to temp file path, checks MD5-1.
     int delete_image();
 
   public:
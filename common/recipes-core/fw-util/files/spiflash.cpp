@@ -5,6 +5,13 @@
 #include <syslog.h>
 #include <openbmc/libgpio.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <mtd/mtd-user.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <vector>
 
 using namespace std;
 
@@ -118,10 +125,157 @@ int MTDComponent::update_by_flashrom(const std::string& image)
   return FW_STATUS_FAILURE;
 }
 
+// pread() until len bytes are read or the end of the file.
+static ssize_t read_full(int fd, uint8_t *buf, size_t len, off_t offset)
+{
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd, buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return n < 0 ? n : done;
+    }
+    done += n;
+  }
+  return done;
+}
+
+static bool write_full(int fd, const uint8_t *buf, size_t len, off_t offset)
+{
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pwrite(fd, buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+MTDBlockPlan mtd_block_plan(const vector<uint8_t>& have,
+                            const vector<uint8_t>& want, size_t wsize)
+{
+  MTDBlockPlan plan;
+  if (have == want) {
+    return plan;
+  }
+  plan.erase = any_of(have.begin(), have.end(), [](uint8_t b) { return b != 0xFF; });
+  // Erased bytes past the last programmed page need no writing.
+  size_t end = want.size();
+  while (end > 0 && want[end - 1] == 0xFF) {
+    end--;
+  }
+  wsize = max<size_t>(wsize, 1);
+  plan.program = min(want.size(), (end + wsize - 1) / wsize * wsize);
+  return plan;
+}
+
+// Like "flashcp -v": the erase blocks covering the image end up holding
+// the image followed by erased (0xFF) bytes. Blocks already holding that
+// are left alone, blank ones are programmed without being erased, and
+// only what was programmed is read back.
+int System::flash_mtd(const std::string& image, const std::string& dev)
+{
+  auto KB = [](auto x){ return x / 1024; };
+  struct mtd_info_user info;
+  struct stat st;
+
+  int ifd = open(image.c_str(), O_RDONLY);
+  if (ifd < 0) {
+    error << "ERROR: Failed to open " << image << endl;
+    return FW_STATUS_FAILURE;
+  }
+  int fd = open(dev.c_str(), O_RDWR | O_SYNC);
+  if (fd < 0) {
+    close(ifd);
+    error << "ERROR: Failed to open " << dev << endl;
+    return FW_STATUS_FAILURE;
+  }
+  auto fail = [&](const string& msg) {
+    error << "ERROR: " << msg << ": " << strerror(errno) << endl;
+    close(fd);
+    close(ifd);
+    return FW_STATUS_FAILURE;
+  };
+  if (fstat(ifd, &st) != 0) {
+    return fail("Failed to stat " + image);
+  }
+  if (ioctl(fd, MEMGETINFO, &info) != 0) {
+    return fail(dev + " is not an MTD device");
+  }
+  size_t size = st.st_size;
+  size_t esize = info.erasesize;
+  size_t wsize = info.writesize;
+  if (size > info.size) {
+    close(fd);
+    close(ifd);
+    error << "ERROR: " << image << " (" << size << " bytes) does not fit "
+                << dev << " (" << info.size << " bytes)" << endl;
+    return FW_STATUS_FAILURE;
+  }
+
+  vector<uint8_t> want(esize), have(esize);
+  size_t written = 0, erased = 0;
+  for (size_t off = 0; off < size; off += esize) {
+    size_t len = min(esize, size - off);
+    fill(want.begin(), want.end(), 0xFF);
+    if (read_full(ifd, want.data(), len, off) != ssize_t(len)) {
+      return fail("Failed to read " + image);
+    }
+    if (read_full(fd, have.data(), esize, off) != ssize_t(esize)) {
+      return fail("Failed to read " + dev);
+    }
+
+    auto plan = mtd_block_plan(have, want, wsize);
+    if (plan.erase) {
+      struct erase_info_user erase = {uint32_t(off), uint32_t(esize)};
+      if (ioctl(fd, MEMERASE, &erase) != 0) {
+        return fail("Failed to erase " + dev);
+      }
+      erased += esize;
+    }
+    if (plan.program > 0) {
+      if (!write_full(fd, want.data(), plan.program, off)) {
+        return fail("Failed to write " + dev);
+      }
+      if (read_full(fd, have.data(), plan.program, off) != ssize_t(plan.program)) {
+        return fail("Failed to read " + dev);
+      }
+      if (!equal(want.begin(), want.begin() + plan.program, have.begin())) {
+        close(fd);
+        close(ifd);
+        error << "ERROR: Verification of " << dev << " failed at 0x"
+                    << hex << off << dec << endl;
+        return FW_STATUS_FAILURE;
+      }
+      written += plan.program;
+    }
+
+    output << "\rFlashing kb: " << KB(off + len) << "/" << KB(size)
+                 << " (" << ((off + len) * 100 / size) << "%)" << flush;
+  }
+  if (size > 0) {
+    output << endl;
+  }
+  close(fd);
+  close(ifd);
+
+  output << "Wrote " << KB(written) << " kb, erased " << KB(erased)
+               << " kb, " << KB(size) << " kb image" << endl;
+  syslog(LOG_INFO, "%s: wrote %zu bytes, erased %zu bytes for %s",
+         dev.c_str(), written, erased, image.c_str());
+  return FW_STATUS_SUCCESS;
+}
+
 int MTDComponent::update_by_flashcp(const std::string& image)
 {
   string dev;
-  string cmd;
   string comp = this->component();
   int ret;
 
@@ -131,8 +285,7 @@ int MTDComponent::update_by_flashcp(const std::string& image)
   syslog(LOG_CRIT, "Component %s upgrade initiated", comp.c_str());
 
   sys().output << "Flashing to device: " << dev << endl;
-  cmd = "flashcp -v " + image + " " + dev;
-  ret = sys().runcmd(cmd);
+  ret = sys().flash_mtd(image, dev);
   if (ret == 0) {
     syslog(LOG_CRIT, "Component %s upgrade completed", comp.c_str());
     return FW_STATUS_SUCCESS;
@@ -147,7 +300,7 @@ int MTDComponent::update(std::string image)
     std::cout << "Update by using flasrom" << std::endl;
     return update_by_flashrom(image);
   } else {
-    std::cout << "Update by using flashcp" << std::endl;
+    std::cout << "Update by writing to the MTD device" << std::endl;
     return update_by_flashcp(image);
   }
 }
@@ -1,8 +1,21 @@
 #ifndef _SPI_FLASH_H_
 #define _SPI_FLASH_H_
 #include <string>
+#include <vector>
 #include "fw-util.h"
 
+// What flashing one erase block of an MTD device takes.
+struct MTDBlockPlan {
+  bool erase = false;   // The block holds data, erase it before programming.
+  size_t program = 0;   // Bytes to program (and verify) from the block start.
+};
+
+// Plan flashing the erase block holding "have" with "want" (Both a whole
+// erase block, the image padded with 0xFF). Nothing is done if they match.
+// Trailing erased bytes are not programmed, rounded to the write size.
+MTDBlockPlan mtd_block_plan(const std::vector<uint8_t>& have,
+                            const std::vector<uint8_t>& want, size_t wsize);
+
 
 // Upgrade flash whose partitions are mounted as MTD
 class MTDComponent : public Component {
@@ -14,6 +27,8 @@ class MTDComponent : public Component {
       Component(fru, comp), _mtd_name(mtd) {}
     int update(std::string image) override;
     int dump(std::string image) override;
+    // Erasing and programming every block of the image.
+    size_t update_rate() override { return 64 * 1024; }
   private:
     int getFlashSize(const std::string& mtdIndex);
     int update_by_flashcp(const std::string& image);
@@ -34,6 +34,9 @@ class System {
       return get_mtd_name(name, dev, sz, esz);
     }
 
+    // Write image to the MTD device dev like "flashcp -v", only erasing
+    // and programming the erase blocks which differ (spiflash.cpp).
+    virtual int flash_mtd(const std::string& image, const std::string& dev);
     virtual std::string version();
     std::string name() {
       std::string vers = version();
@@ -101,8 +101,8 @@ class BmcComponentMock : public BmcComponent {
 
 // TEST1: Check if image validation fails, update will fail with the correct error message.
 // TEST2: Check if the above test succeeds, but get_mtd_name fails, update will fail with the correct error message.
-// TEST3: Check if the above tests succeeds, but runcmd fails update will fail.
-// TEST4: Check if the above tests succeeds, bmc is flashed to the correct MTD device (Correct call to flashcp)
+// TEST3: Check if the above tests succeeds, but flash_mtd fails update will fail.
+// TEST4: Check if the above tests succeeds, bmc is flashed to the correct MTD device (Correct call to flash_mtd)
 TEST(BmcComponentTest, MTDFlash) {
   stringstream out, err;
   SystemMock mock(out, err);
@@ -111,7 +111,6 @@ TEST(BmcComponentTest, MTDFlash) {
   string name("fbtp");
   string version = name + "-4.9";
   TmpFile mtd("U-Boot 2016.07 fbtp-v11.0");
-  string exp_flashcp_call("flashcp -v " + dummy_image + " " + mtd.name);
 
   EXPECT_CALL(mock, version())
     .Times(1)
@@ -127,7 +126,7 @@ TEST(BmcComponentTest, MTDFlash) {
     .WillOnce(Return(false))
     .WillOnce(Return(false));
 
-  EXPECT_CALL(mock, runcmd(string(exp_flashcp_call)))
+  EXPECT_CALL(mock, flash_mtd(dummy_image, mtd.name))
     .Times(2)
     .WillOnce(Return(-1))
     .WillOnce(Return(0));
@@ -160,10 +159,10 @@ TEST(BmcComponentTest, MTDFlash) {
   err.str("");
 
   // Third call, is_valid() returns true, get_mtd_name() will return true and
-  // a valid image, but runcmd(flashcp) call will fail.
+  // a valid image, but flash_mtd() will fail.
   EXPECT_EQ(FW_STATUS_FAILURE, b.update(dummy_image));
 
-  // Both succeeds. Check if we are calling flashcp correctly and succeeds.
+  // Both succeeds. Check if we are calling flash_mtd correctly and succeeds.
   EXPECT_EQ(0, b.update(dummy_image));
 }
 
@@ -176,7 +175,6 @@ TEST(BmcComponentTest, MTDOffsetFlash) {
   stringstream out;
   SystemMock mock(out, cerr);
   string dummy_mtd("flash123");
-  string exp_flashcp_call("flashcp -v " + exp_image_name + " " + mtd_dev.name);
 
   EXPECT_CALL(mock, get_mtd_name(dummy_mtd, _))
     .Times(1)
@@ -185,9 +183,9 @@ TEST(BmcComponentTest, MTDOffsetFlash) {
     .Times(1)
     .WillRepeatedly(Return(false));
 
-  EXPECT_CALL(mock, runcmd(string(exp_flashcp_call)))
+  EXPECT_CALL(mock, flash_mtd(exp_image_name, mtd_dev.name))
     .Times(1)
-    .WillRepeatedly(Invoke(&mock, &SystemMock::copy_file));
+    .WillRepeatedly(Invoke(&mock, &SystemMock::copy_image));
 
   // We are skipping the first 4 bytes. Copying the next 4 from mtd
   // and replacing our own.
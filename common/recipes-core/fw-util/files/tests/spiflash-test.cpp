@@ -0,0 +1,75 @@
+#include "spiflash.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+// 64 byte erase blocks, 16 byte pages.
+static vector<uint8_t> block(size_t data_len, uint8_t data = 0x5A)
+{
+  vector<uint8_t> b(64, 0xFF);
+  fill(b.begin(), b.begin() + data_len, data);
+  return b;
+}
+
+TEST(MTDBlockPlanTest, SameBlockIsSkipped) {
+  auto plan = mtd_block_plan(block(40), block(40), 16);
+  EXPECT_FALSE(plan.erase);
+  EXPECT_EQ(0, plan.program);
+
+  plan = mtd_block_plan(block(0), block(0), 16);
+  EXPECT_FALSE(plan.erase);
+  EXPECT_EQ(0, plan.program);
+}
+
+TEST(MTDBlockPlanTest, BlankBlockIsNotErased) {
+  auto plan = mtd_block_plan(block(0), block(64), 16);
+  EXPECT_FALSE(plan.erase);
+  EXPECT_EQ(64, plan.program);
+}
+
+TEST(MTDBlockPlanTest, ProgrammedBlockIsErased) {
+  auto plan = mtd_block_plan(block(64, 0x00), block(64), 16);
+  EXPECT_TRUE(plan.erase);
+  EXPECT_EQ(64, plan.program);
+
+  // A single programmed byte is enough.
+  auto have = block(0);
+  have[63] = 0xFE;
+  plan = mtd_block_plan(have, block(64), 16);
+  EXPECT_TRUE(plan.erase);
+}
+
+TEST(MTDBlockPlanTest, TrailingErasedBytesAreNotProgrammed) {
+  // Rounded up to whole pages.
+  auto plan = mtd_block_plan(block(0), block(17), 16);
+  EXPECT_FALSE(plan.erase);
+  EXPECT_EQ(32, plan.program);
+
+  plan = mtd_block_plan(block(0), block(32), 16);
+  EXPECT_EQ(32, plan.program);
+
+  plan = mtd_block_plan(block(0), block(17), 1);
+  EXPECT_EQ(17, plan.program);
+
+  // No write size reported by the device.
+  plan = mtd_block_plan(block(0), block(17), 0);
+  EXPECT_EQ(17, plan.program);
+
+  // Never past the end of the block.
+  plan = mtd_block_plan(block(0), block(60), 48);
+  EXPECT_EQ(64, plan.program);
+}
+
+TEST(MTDBlockPlanTest, ErasedImageIsOnlyErased) {
+  auto plan = mtd_block_plan(block(10), block(0), 16);
+  EXPECT_TRUE(plan.erase);
+  EXPECT_EQ(0, plan.program);
+}
+
+TEST(MTDBlockPlanTest, ErasedBytesInsideDataAreProgrammed) {
+  auto want = block(48);
+  fill(want.begin(), want.begin() + 20, 0xFF);
+  auto plan = mtd_block_plan(block(0), want, 16);
+  EXPECT_FALSE(plan.erase);
+  EXPECT_EQ(48, plan.program);
+}
@@ -0,0 +1,162 @@
+#include "update_plan.h"
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+class PlanComponent : public Component {
+    string _resource;
+  public:
+    PlanComponent(string fru, string comp, string resource = "")
+      : Component(fru, comp), _resource(resource) {}
+    // Updates of different FRUs may overlap, as a platform would allow.
+    string update_resource() override {
+      return _resource.empty() ? fru() : _resource;
+    }
+};
+
+// Records when the updates start and end instead of running them.
+class UpdatePlanMock : public UpdatePlan {
+  public:
+    mutex events_mutex;
+    vector<string> events;
+    set<string> fail;
+    size_t running = 0;
+    size_t max_running = 0;
+
+    UpdatePlanMock(ostream &out, ostream &err) : UpdatePlan(out, err) {}
+    int run_job(UpdateJob &job) override {
+      string name = job.fru + ":" + job.component;
+      {
+        lock_guard<mutex> lock(events_mutex);
+        events.push_back("start " + name);
+        max_running = max(++running, max_running);
+      }
+      this_thread::sleep_for(chrono::milliseconds(50));
+      lock_guard<mutex> lock(events_mutex);
+      events.push_back("end " + name);
+      running--;
+      return fail.count(name) ? FW_STATUS_FAILURE : FW_STATUS_SUCCESS;
+    }
+    size_t position(const string &event) {
+      return find(events.begin(), events.end(), event) - events.begin();
+    }
+};
+
+class UpdatePlanTest : public ::testing::Test {
+  protected:
+    string image = "./update-plan-test.bin";
+    stringstream out, err;
+    PlanComponent bic1{"slot1", "bic"};
+    PlanComponent bios1{"slot1", "bios"};
+    PlanComponent bic2{"slot2", "bic"};
+    PlanComponent bios2{"slot2", "bios"};
+
+    void SetUp() override {
+      // 2s at the default update rate.
+      ofstream ofs(image);
+      ofs << string(32 * 1024, '\xff');
+    }
+    void TearDown() override {
+      remove(image.c_str());
+    }
+    json update(const string &fru, const string &comp) {
+      return {{"fru", fru}, {"component", comp}, {"image", image}};
+    }
+};
+
+TEST_F(UpdatePlanTest, Dependencies) {
+  UpdatePlanMock plan(out, err);
+  json j = json::array({update("slot1", "bic"), update("slot1", "bios"),
+                        update("slot2", "bic"), update("slot2", "bios")});
+  j[3]["after"] = {"slot1:bios"};
+  ASSERT_TRUE(plan.load(j));
+  EXPECT_EQ(plan.get_jobs()[1].after, vector<size_t>({0}));
+  EXPECT_EQ(plan.get_jobs()[3].after, vector<size_t>({2, 1}));
+
+  EXPECT_EQ(0, plan.run(4));
+  EXPECT_EQ(2u, plan.max_running);
+  EXPECT_LT(plan.position("end slot1:bic"), plan.position("start slot1:bios"));
+  EXPECT_LT(plan.position("end slot1:bios"), plan.position("start slot2:bios"));
+  for (auto &job : plan.get_jobs()) {
+    EXPECT_EQ(UpdateJob::SUCCEEDED, job.state);
+  }
+  EXPECT_NE(string::npos, out.str().find("[4/4] slot2:bios succeeded"));
+}
+
+TEST_F(UpdatePlanTest, SharedResource) {
+  PlanComponent cpld1("slot1", "cpld", "i2c-12");
+  PlanComponent cpld2("slot2", "cpld", "i2c-12");
+  PlanComponent cpld3("slot3", "cpld");
+  UpdatePlanMock plan(out, err);
+  ASSERT_TRUE(plan.load(json::array({update("slot1", "cpld"), update("slot2", "cpld"),
+                                     update("slot3", "cpld")})));
+  EXPECT_EQ(0, plan.run(4));
+  EXPECT_EQ(2u, plan.max_running);
+  EXPECT_LT(plan.position("end slot1:cpld"), plan.position("start slot2:cpld"));
+}
+
+TEST_F(UpdatePlanTest, DefaultResourceIsShared) {
+  Component bic3("slot3", "bic");
+  Component bic4("slot4", "bic");
+  UpdatePlanMock plan(out, err);
+  ASSERT_TRUE(plan.load(json::array({update("slot3", "bic"), update("slot4", "bic")})));
+  EXPECT_EQ(0, plan.run(4));
+  EXPECT_EQ(1u, plan.max_running);
+}
+
+TEST_F(UpdatePlanTest, MaxJobs) {
+  UpdatePlanMock plan(out, err);
+  ASSERT_TRUE(plan.load(json::array({update("slot1", "bic"), update("slot2", "bic")})));
+  EXPECT_EQ(0, plan.run(1));
+  EXPECT_EQ(1u, plan.max_running);
+}
+
+TEST_F(UpdatePlanTest, FailureSkipsDependents) {
+  UpdatePlanMock plan(out, err);
+  json j = json::array({update("slot1", "bic"), update("slot1", "bios"),
+                        update("slot2", "bic"), update("slot2", "bios")});
+  j[3]["after"] = {"slot1:bios"};
+  ASSERT_TRUE(plan.load(j));
+  plan.fail.insert("slot1:bic");
+  EXPECT_EQ(-1, plan.run(4));
+  auto &jobs = plan.get_jobs();
+  EXPECT_EQ(UpdateJob::FAILED, jobs[0].state);
+  EXPECT_EQ(UpdateJob::SKIPPED, jobs[1].state);
+  EXPECT_EQ(UpdateJob::SUCCEEDED, jobs[2].state);
+  EXPECT_EQ(UpdateJob::SKIPPED, jobs[3].state);
+  EXPECT_EQ(4u, plan.events.size());
+}
+
+TEST_F(UpdatePlanTest, DryRun) {
+  UpdatePlanMock plan(out, err);
+  ASSERT_TRUE(plan.load(json::array({update("slot1", "bic"), update("slot1", "bios"),
+                                     update("slot2", "bic")})));
+  EXPECT_EQ(2, plan.get_jobs()[0].estimate);
+  EXPECT_EQ(0, plan.dry_run(4));
+  EXPECT_TRUE(plan.events.empty());
+  EXPECT_NE(string::npos, out.str().find("+2s    slot1:bios"));
+  EXPECT_NE(string::npos, out.str().find("Estimated time: 4s (6s one at a time)"));
+}
+
+TEST_F(UpdatePlanTest, InvalidPlans) {
+  UpdatePlanMock plan(out, err);
+  EXPECT_FALSE(plan.load(json::array()));
+  EXPECT_FALSE(plan.load(json::array({update("slot3", "bic")})));
+  EXPECT_FALSE(plan.load(json::array({update("slot1", "bic"), update("slot1", "bic")})));
+  EXPECT_FALSE(plan.load(json::array({{{"fru", "slot1"}, {"component", "bic"}}})));
+
+  json j = update("slot1", "bic");
+  j["image"] = "./does-not-exist.bin";
+  EXPECT_FALSE(plan.load(json::array({j})));
+
+  j = json::array({update("slot1", "bic"), update("slot1", "bios")});
+  j[0]["after"] = {"slot1:bios"};
+  EXPECT_FALSE(plan.load(j));
+  EXPECT_NE(string::npos, err.str().find("circular dependencies"));
+}
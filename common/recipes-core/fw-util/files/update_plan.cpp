@@ -0,0 +1,396 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <syslog.h>
+#include <sys/stat.h>
+#include <openbmc/misc-utils.h>
+#include "update_plan.h"
+
+using namespace std;
+
+extern std::atomic<int> signal_received;
+
+static string job_name(const UpdateJob &job)
+{
+  return job.fru + ":" + job.component;
+}
+
+bool UpdatePlan::load(const string &path)
+{
+  ifstream ifs(path);
+  if (!ifs.good()) {
+    error << "Cannot access: " << path << endl;
+    return false;
+  }
+  try {
+    return load(json::parse(ifs));
+  } catch (json::exception &e) {
+    error << "Invalid update plan " << path << ": " << e.what() << endl;
+    return false;
+  }
+}
+
+bool UpdatePlan::load(const json &plan)
+{
+  jobs.clear();
+  if (!plan.is_array() || plan.empty()) {
+    error << "Update plan should be a non-empty list of updates" << endl;
+    return false;
+  }
+
+  map<string, size_t> index;
+  map<string, size_t> last_of_fru;
+  for (auto &entry : plan) {
+    UpdateJob job;
+    try {
+      job.fru = entry.at("fru").get<string>();
+      job.component = entry.at("component").get<string>();
+      job.image = entry.at("image").get<string>();
+      job.force = entry.value("force", false);
+    } catch (json::exception &e) {
+      error << "Invalid update " << entry.dump() << ": " << e.what() << endl;
+      return false;
+    }
+    string name = job_name(job);
+    job.comp = Component::find_component(job.fru, job.component);
+    if (job.comp == nullptr) {
+      error << "Unknown component " << name << endl;
+      return false;
+    }
+    if (index.find(name) != index.end()) {
+      error << "Component " << name << " is updated twice" << endl;
+      return false;
+    }
+    struct stat st;
+    if (stat(job.image.c_str(), &st) != 0) {
+      error << "Cannot access: " << job.image << endl;
+      return false;
+    }
+    size_t rate = max<size_t>(job.comp->update_rate(), 1);
+    job.estimate = max<int>(st.st_size / rate, 1);
+    job.resource = job.comp->update_resource();
+
+    // Updates of a FRU go one after the other, in the order of the plan:
+    // each of them holds the update-ongoing flag of the FRU.
+    auto last = last_of_fru.find(job.fru);
+    if (last != last_of_fru.end()) {
+      job.after.push_back(last->second);
+    }
+    last_of_fru[job.fru] = jobs.size();
+    index[name] = jobs.size();
+    jobs.push_back(job);
+  }
+
+  // Dependencies across FRUs, which may refer to later updates.
+  for (size_t i = 0; i < jobs.size(); i++) {
+    auto after = plan[i].find("after");
+    if (after == plan[i].end()) {
+      continue;
+    }
+    if (!after->is_array()) {
+      error << "\"after\" of " << job_name(jobs[i]) << " should be a list" << endl;
+      return false;
+    }
+    for (auto &dep : *after) {
+      auto it = dep.is_string() ? index.find(dep.get<string>()) : index.end();
+      if (it == index.end()) {
+        error << job_name(jobs[i]) << " is after " << dep.dump()
+              << " which is not in the plan" << endl;
+        return false;
+      }
+      if (it->second == i) {
+        error << job_name(jobs[i]) << " is after itself" << endl;
+        return false;
+      }
+      jobs[i].after.push_back(it->second);
+    }
+  }
+
+  if (!acyclic()) {
+    error << "Update plan has circular dependencies" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool UpdatePlan::acyclic() const
+{
+  vector<size_t> deps(jobs.size());
+  vector<vector<size_t>> dependents(jobs.size());
+  for (size_t i = 0; i < jobs.size(); i++) {
+    deps[i] = jobs[i].after.size();
+    for (auto a : jobs[i].after) {
+      dependents[a].push_back(i);
+    }
+  }
+  vector<size_t> free;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (deps[i] == 0) {
+      free.push_back(i);
+    }
+  }
+  size_t sorted = 0;
+  while (!free.empty()) {
+    size_t i = free.back();
+    free.pop_back();
+    sorted++;
+    for (auto d : dependents[i]) {
+      if (--deps[d] == 0) {
+        free.push_back(d);
+      }
+    }
+  }
+  return sorted == jobs.size();
+}
+
+vector<UpdateJob::State> UpdatePlan::states() const
+{
+  vector<UpdateJob::State> st;
+  for (auto &job : jobs) {
+    st.push_back(job.state);
+  }
+  return st;
+}
+
+bool UpdatePlan::ready(size_t idx, const vector<UpdateJob::State> &st) const
+{
+  if (st[idx] != UpdateJob::PENDING) {
+    return false;
+  }
+  for (auto a : jobs[idx].after) {
+    if (st[a] != UpdateJob::SUCCEEDED) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (st[i] == UpdateJob::RUNNING && jobs[i].resource == jobs[idx].resource) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool UpdatePlan::skip_blocked(vector<UpdateJob::State> &st) const
+{
+  bool skipped = false;
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (size_t i = 0; i < jobs.size(); i++) {
+      if (st[i] != UpdateJob::PENDING) {
+        continue;
+      }
+      for (auto a : jobs[i].after) {
+        if (st[a] == UpdateJob::FAILED || st[a] == UpdateJob::SKIPPED) {
+          st[i] = UpdateJob::SKIPPED;
+          changed = skipped = true;
+          break;
+        }
+      }
+    }
+  }
+  return skipped;
+}
+
+// Replay the scheduling of run() with the remaining time of every job,
+// and return when the last one would end.
+int UpdatePlan::simulate(vector<UpdateJob::State> st, const vector<int> &remaining,
+                         unsigned max_jobs, vector<int> *starts) const
+{
+  vector<int> end(jobs.size(), 0);
+  unsigned running = 0;
+  int now = 0;
+
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (st[i] == UpdateJob::RUNNING) {
+      end[i] = remaining[i];
+      running++;
+    }
+  }
+  if (starts) {
+    starts->assign(jobs.size(), -1);
+  }
+  for (;;) {
+    skip_blocked(st);
+    for (size_t i = 0; i < jobs.size() && running < max_jobs; i++) {
+      if (ready(i, st)) {
+        st[i] = UpdateJob::RUNNING;
+        end[i] = now + remaining[i];
+        running++;
+        if (starts) {
+          (*starts)[i] = now;
+        }
+      }
+    }
+    if (running == 0) {
+      break;
+    }
+    size_t next = jobs.size();
+    for (size_t i = 0; i < jobs.size(); i++) {
+      if (st[i] == UpdateJob::RUNNING && (next == jobs.size() || end[i] < end[next])) {
+        next = i;
+      }
+    }
+    now = end[next];
+    st[next] = UpdateJob::SUCCEEDED;
+    running--;
+  }
+  return now;
+}
+
+int UpdatePlan::remaining_estimate(unsigned max_jobs, int now) const
+{
+  vector<int> remaining;
+  for (auto &job : jobs) {
+    int left = job.estimate;
+    if (job.state == UpdateJob::RUNNING) {
+      left = max(job.estimate - (now - job.started), 1);
+    }
+    remaining.push_back(left);
+  }
+  return simulate(states(), remaining, max_jobs);
+}
+
+int UpdatePlan::dry_run(unsigned max_jobs)
+{
+  vector<int> estimates, starts;
+  int serial = 0;
+  for (auto &job : jobs) {
+    estimates.push_back(job.estimate);
+    serial += job.estimate;
+  }
+  int total = simulate(states(), estimates, max_jobs, &starts);
+
+  output << "Update plan of " << jobs.size() << " components, at most "
+         << max_jobs << " at a time:" << endl;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    auto &job = jobs[i];
+    output << "  +" << left << setw(6) << (to_string(starts[i]) + "s")
+           << setw(24) << job_name(job) << " ~" << setw(6)
+           << (to_string(job.estimate) + "s") << " resource: " << job.resource;
+    if (!job.after.empty()) {
+      output << ", after:";
+      for (auto a : job.after) {
+        output << " " << job_name(jobs[a]);
+      }
+    }
+    output << endl;
+  }
+  output << "Estimated time: " << total << "s (" << serial
+         << "s one at a time)" << endl;
+  return 0;
+}
+
+int UpdatePlan::run_job(UpdateJob &job)
+{
+  Component *c = job.comp;
+
+  if (c->is_sled_cycle_initiated()) {
+    error << "Upgrade of " << job_name(job)
+          << " aborted due to fw update preparing" << endl;
+    return FW_STATUS_FAILURE;
+  }
+  int lfd = single_instance_lock_blocked(string("fw-util_" + c->fru()).c_str());
+  if (lfd < 0) {
+    syslog(LOG_WARNING, "Error getting single_instance_lock");
+    return FW_STATUS_FAILURE;
+  }
+  if (c->is_update_ongoing()) {
+    error << "Upgrade of " << job_name(job)
+          << " aborted due to ongoing upgrade on FRU: " << c->fru() << endl;
+    single_instance_unlock(lfd);
+    return FW_STATUS_FAILURE;
+  }
+  c->set_update_ongoing(60 * 10);
+  single_instance_unlock(lfd);
+
+  int ret = job.force ? c->fupdate(job.image) : c->update(job.image);
+  c->set_update_ongoing(0);
+  if (ret == 0) {
+    c->update_finish();
+  }
+  return ret;
+}
+
+int UpdatePlan::run(unsigned max_jobs)
+{
+  using clock = chrono::steady_clock;
+  auto begin = clock::now();
+  auto seconds = [&]() {
+    return int(chrono::duration_cast<chrono::seconds>(clock::now() - begin).count());
+  };
+  vector<thread> threads;
+  unsigned running = 0;
+  size_t finished = 0;
+
+  unique_lock<std::mutex> lock(plan_mutex);
+  output << "Updating " << jobs.size() << " components, estimated time: "
+         << remaining_estimate(max_jobs, 0) << "s" << endl;
+
+  for (;;) {
+    auto st = states();
+    if (skip_blocked(st)) {
+      for (size_t i = 0; i < jobs.size(); i++) {
+        if (st[i] == UpdateJob::SKIPPED && jobs[i].state != UpdateJob::SKIPPED) {
+          jobs[i].state = UpdateJob::SKIPPED;
+          finished++;
+          output << "[" << finished << "/" << jobs.size() << "] "
+                 << job_name(jobs[i]) << " skipped" << endl;
+        }
+      }
+    }
+    // On a signal, let the running updates finish but start no other.
+    for (size_t i = 0; i < jobs.size() && running < max_jobs &&
+                       !signal_received.load(); i++) {
+      if (!ready(i, states())) {
+        continue;
+      }
+      auto &job = jobs[i];
+      job.state = UpdateJob::RUNNING;
+      job.started = seconds();
+      running++;
+      syslog(LOG_INFO, "fw-util: update of %s started", job_name(job).c_str());
+      output << "Starting update of " << job_name(job) << " (~"
+             << job.estimate << "s)" << endl;
+      threads.emplace_back([this, &job, &running, &finished, &seconds, max_jobs]() {
+        int ret = run_job(job);
+        lock_guard<std::mutex> guard(plan_mutex);
+        job.ret = ret;
+        job.elapsed = seconds() - job.started;
+        job.state = ret == 0 ? UpdateJob::SUCCEEDED : UpdateJob::FAILED;
+        running--;
+        finished++;
+        output << "[" << finished << "/" << jobs.size() << "] "
+               << job_name(job) << (ret == 0 ? " succeeded" :
+                   ret == FW_STATUS_NOT_SUPPORTED ? " not supported" : " failed")
+               << " in " << job.elapsed << "s";
+        if (finished < jobs.size()) {
+          output << ", ~" << remaining_estimate(max_jobs, seconds())
+                 << "s remaining";
+        }
+        output << endl;
+        done.notify_all();
+      });
+    }
+    if (running == 0) {
+      break;
+    }
+    done.wait(lock);
+  }
+  lock.unlock();
+  for (auto &t : threads) {
+    t.join();
+  }
+
+  int succeeded = count_if(jobs.begin(), jobs.end(),
+      [](const UpdateJob &j) { return j.state == UpdateJob::SUCCEEDED; });
+  output << "Updated " << succeeded << " of " << jobs.size()
+         << " components in " << seconds() << "s" << endl;
+  if (signal_received.load()) {
+    cout << "Aborted action due to signal = " << signal_received.load() << endl;
+  }
+  return succeeded == int(jobs.size()) ? 0 : -1;
+}
@@ -0,0 +1,75 @@
+#ifndef _UPDATE_PLAN_H_
+#define _UPDATE_PLAN_H_
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <ostream>
+#include "fw-util.h"
+
+// One component update of a plan.
+struct UpdateJob {
+  enum State { PENDING, RUNNING, SUCCEEDED, FAILED, SKIPPED };
+
+  std::string fru;
+  std::string component;
+  std::string image;
+  bool force = false;
+  Component *comp = nullptr;
+  // Jobs which have to succeed before this one starts.
+  std::vector<size_t> after;
+  // Updates holding the same resource never run concurrently.
+  std::string resource;
+  int estimate = 0; // seconds
+  State state = PENDING;
+  int ret = 0;
+  int started = 0; // seconds into the plan
+  int elapsed = 0; // seconds
+};
+
+// Updates several components, across FRUs, from a JSON plan:
+//   [
+//     {"fru": "slot1", "component": "bic", "image": "/tmp/bic.bin"},
+//     {"fru": "slot1", "component": "bios", "image": "/tmp/bios.bin"},
+//     {"fru": "slot2", "component": "cpld", "image": "/tmp/cpld.bin",
+//      "after": ["slot1:bic"], "force": false}
+//   ]
+// Updates of a FRU run in the order of the plan, "after" adds dependencies
+// across FRUs. Independent updates run concurrently, unless their
+// components share an update resource (Component::update_resource()).
+// A failed update skips the updates which depend on it, not the others.
+class UpdatePlan {
+  protected:
+    std::vector<UpdateJob> jobs;
+    std::ostream &output;
+    std::ostream &error;
+    std::mutex plan_mutex;
+    std::condition_variable done;
+
+    bool acyclic() const;
+    std::vector<UpdateJob::State> states() const;
+    bool ready(size_t idx, const std::vector<UpdateJob::State> &st) const;
+    bool skip_blocked(std::vector<UpdateJob::State> &st) const;
+    int simulate(std::vector<UpdateJob::State> st, const std::vector<int> &remaining,
+                 unsigned max_jobs, std::vector<int> *starts = nullptr) const;
+    int remaining_estimate(unsigned max_jobs, int now) const;
+    // Update the component of the job, like "fw-util FRU --update" does.
+    virtual int run_job(UpdateJob &job);
+
+  public:
+    UpdatePlan(std::ostream &out = std::cout, std::ostream &err = std::cerr)
+      : output(out), error(err) {}
+    virtual ~UpdatePlan() = default;
+
+    // Build the jobs of the plan, false if it is not valid.
+    bool load(const json &plan);
+    bool load(const std::string &path);
+    const std::vector<UpdateJob> &get_jobs() const { return jobs; }
+
+    // Print the order of the updates and the time they should take.
+    int dry_run(unsigned max_jobs);
+    // Run the updates, at most max_jobs at a time.
+    int run(unsigned max_jobs);
+};
+
+#endif
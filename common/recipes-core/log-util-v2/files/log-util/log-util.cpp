@@ -1,4 +1,6 @@
 #include "log-util.hpp"
+#include <unistd.h>
+#include <algorithm>
 #include <fstream>
 
 void LogUtil::print(
@@ -9,13 +11,19 @@ void LogUtil::print(
         std::ostream& os) {
   std::unique_ptr<SELStream> stream =
       make_stream(opt_json ? FORMAT_JSON : FORMAT_PRINT);
-  for (auto& logfile : logfile_list()) {
+  std::vector<std::string> logfiles = logfile_list();
+  if (page_) {
+    stream->set_page(*page_);
+    std::reverse(logfiles.begin(), logfiles.end());
+  }
+  for (auto& logfile : logfiles) {
+    if (stream->done()) {
+      break;
+    }
     try {
-      auto fd = std::ifstream(logfile);
-      if (!fd.is_open()) {
-        throw std::runtime_error(logfile + " open failed");
-      }
-      stream->start(fd, os, frus, start_time, end_time);
+      SELIndex index(logfile, index_path(logfile));
+      index.update();
+      stream->start(index, os, frus, start_time, end_time);
     } catch (std::exception& e) {
       continue;
     }
@@ -26,27 +34,37 @@ void LogUtil::print(
 void LogUtil::clear(const fru_set& frus, const std::string& start_time, const std::string& end_time) {
   std::unique_ptr<SELStream> stream = make_stream(FORMAT_RAW);
   const std::vector<std::string>& llist = logfile_list();
+  // Clearing all logs needs no filter, the files are just truncated.
+  bool all = frus.count(SELFormat::FRU_ALL) &&
+      (start_time.empty() || end_time.empty());
   for (auto& logfile : llist) {
-    auto fd = std::ifstream(logfile);
-    if (!fd.is_open()) {
+    // The lines which are kept are written over the file as it is read.
+    // That only ever drops lines, so the writer never overtakes the
+    // reader, and rsyslogd keeps appending to the same file.
+    std::ofstream ofs(logfile, std::ios::in | std::ios::out);
+    if (!ofs.is_open()) {
       continue;
     }
-    std::string nfile = logfile + ".tmp";
-    std::ofstream ofs(nfile);
-    if (!ofs.is_open()) {
-      throw std::runtime_error(nfile + " creation failed");
+    if (!all) {
+      auto fd = std::ifstream(logfile);
+      if (!fd.is_open()) {
+        continue;
+      }
+      stream->start(fd, ofs, frus, start_time, end_time);
     }
-    stream->start(fd, ofs, frus, start_time, end_time);
     // If the last logfile, also add the "CLEARED"
     // log line as a breadcrumb
     if (logfile == llist.back()) {
       stream->log_cleared(ofs, frus, start_time, end_time);
     }
     stream->flush(ofs);
+    auto size = ofs.tellp();
     ofs.close();
-    if (rename(nfile.c_str(), logfile.c_str())) {
-      throw std::runtime_error(nfile + " renamed as " + logfile + " failed");
+    if (ofs.fail() || size < 0 || truncate(logfile.c_str(), size) != 0) {
+      throw std::runtime_error(logfile + " truncation failed");
     }
+    // The index would notice, but need not be checked.
+    unlink(index_path(logfile).c_str());
   }
   std::unique_ptr<rsyslogd> rd = make_rsyslogd();
   rd->reload();
@@ -1,10 +1,12 @@
 #pragma once
+#include <optional>
 #include "rsyslogd.hpp"
 #include "selstream.hpp"
 
 class LogUtil {
   std::vector<std::string> logfile_list_{"/mnt/data/logfile.0",
                                          "/mnt/data/logfile"};
+  std::optional<SELPage> page_;
 
  public:
   LogUtil() {}
@@ -18,6 +20,15 @@ class LogUtil {
   virtual const std::vector<std::string>& logfile_list() {
     return logfile_list_;
   }
+  // Indexes live in tmpfs, they are rebuilt after a reboot rather than
+  // adding to the writes to flash.
+  virtual std::string index_path(const std::string& logfile) {
+    return "/tmp/log-util/" + logfile.substr(logfile.rfind('/') + 1) + ".idx";
+  }
+  // Print only a page of the logs, newest first.
+  void set_page(const SELPage& page) {
+    page_ = page;
+  }
   void print(const fru_set& frus, const std::string& start_time, const std::string& end_time, bool opt_json, std::ostream& os = std::cout);
   void clear(const fru_set& frus, const std::string& start_time, const std::string& end_time);
 };
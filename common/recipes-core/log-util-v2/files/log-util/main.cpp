@@ -61,6 +61,14 @@ int main(int argc, char* argv[]) {
       ->needs(print_opt);
   app.add_option("fru", fru)->check(CLI::IsMember(allowed_fru))->required();
 
+  SELPage page;
+  auto offset_opt =
+      app.add_option("--offset", page.offset, "Skip the newest N SEL(s)")
+          ->needs(print_opt);
+  auto limit_opt =
+      app.add_option("--limit", page.limit, "Print at most N SEL(s), newest first")
+          ->needs(print_opt);
+
   std::string start_time = "", end_time = "";
   CLI::Option* start_time_opt = app.add_option("-s", start_time, "Starting time for timestamp delete");
   app.add_option("-e", end_time, "Ending time for timestamp delete")->needs(start_time_opt);
@@ -100,6 +108,9 @@ int main(int argc, char* argv[]) {
           strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", ts);
           end_time = curtime.data();
       }
+      if (*offset_opt || *limit_opt) {
+        util.set_page(page);
+      }
       util.print(action_fru_set, start_time, end_time, opt_json);
 
     } else if (clear) {
@@ -1,48 +1,49 @@
 #include "rsyslogd.hpp"
+#include <dirent.h>
 #include <errno.h>
-#include <array>
-#include <cstdio>
-#include <exception>
+#include <signal.h>
+#include <cstring>
+#include <fstream>
 #include <memory>
-#include <regex>
+#include <stdexcept>
 #include <string>
-#include <cstring>
 
-void rsyslogd::runcmd(const std::string& cmd, std::string& output) {
-  // 128char lines.
-  std::array<char, 128> out;
-  FILE* fp = popen(cmd.c_str(), "r");
-  if (!fp)
-    throw std::runtime_error("Cannot run: " + cmd);
-  while (fgets(out.data(), out.size(), fp) != NULL) {
-    output.append(out.data());
-  }
-  int status = pclose(fp);
-  if (status == -1) {
-    throw std::runtime_error(std::strerror(errno));
-  } else if (status > 0) {
-    throw std::runtime_error("Subprocess exited with non-zero code");
-  }
+bool rsyslogd::is_rsyslogd(int pid) {
+  std::ifstream ifs(proc_ + "/" + std::to_string(pid) + "/comm");
+  std::string comm;
+  return std::getline(ifs, comm) && comm == "rsyslogd";
 }
 
-void rsyslogd::runcmd(const std::string& cmd) {
-  if (system(cmd.c_str()) != 0)
-    throw std::runtime_error("Sending HUP to rsyslogd failed");
+void rsyslogd::signal(int pid, int sig) {
+  if (kill(pid, sig) != 0) {
+    throw std::runtime_error(
+        "Sending HUP to rsyslogd failed: " + std::string(strerror(errno)));
+  }
 }
 
 int rsyslogd::getpid(void) {
-  std::string pid;
-  runcmd("pidof rsyslogd", pid);
-  static const std::regex num_regex(R"(^(\d+)[\r\n\s]*$)");
-  if (std::smatch match; std::regex_match(pid, match, num_regex)) {
-    return std::stoi(match[1]);
+  // The pidfile is what logrotate uses, but it may be stale.
+  std::ifstream ifs(pidfile_);
+  if (int pid; ifs >> pid && pid > 0 && is_rsyslogd(pid)) {
+    return pid;
+  }
+
+  auto dir_close = [](DIR* dir) { closedir(dir); };
+  std::unique_ptr<DIR, decltype(dir_close)> dir(
+      opendir(proc_.c_str()), dir_close);
+  if (!dir) {
+    throw std::runtime_error("Cannot open " + proc_);
+  }
+  while (struct dirent* ent = readdir(dir.get())) {
+    char* end;
+    long pid = strtol(ent->d_name, &end, 10);
+    if (*end == '\0' && pid > 0 && is_rsyslogd(pid)) {
+      return pid;
+    }
   }
-  throw std::runtime_error(
-      "Non numeric PID received from `pidof rsyslogd`: \"" + pid + "\"");
+  throw std::runtime_error("rsyslogd is not running");
 }
 
 void rsyslogd::reload() {
-  int pid = getpid();
-  std::string cmd = "kill -HUP " + std::to_string(pid);
-  runcmd(cmd);
+  signal(getpid(), SIGHUP);
 }
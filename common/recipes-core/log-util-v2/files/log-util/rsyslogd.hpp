@@ -4,13 +4,18 @@
 class rsyslogd {
  private:
   int pid = -1;
+  std::string pidfile_;
+  std::string proc_;
 
-  virtual void runcmd(const std::string& cmd);
-  virtual void runcmd(const std::string& cmd, std::string& out);
+  bool is_rsyslogd(int pid);
+  virtual void signal(int pid, int sig);
 
  public:
   virtual int getpid(void);
-  rsyslogd() {}
+  explicit rsyslogd(
+      const std::string& pidfile = "/var/run/rsyslogd.pid",
+      const std::string& proc = "/proc")
+      : pidfile_(pidfile), proc_(proc) {}
   virtual ~rsyslogd() {}
   virtual void reload();
 };
@@ -4,8 +4,6 @@
 #include <iostream>
 #include <ctime>
 #include <time.h>
-#include <cstdio>
-#include <regex>
 #include <fstream>
 
 using namespace std::literals;
@@ -73,129 +71,303 @@ void SELFormat::set_clear_timestamp(uint8_t fru, const std::string& start_time,
     set_raw(std::move(log));
 }
 
-void SELFormat::set_raw(std::string&& line) {
-  self_log_ = false;
-  bare_ = true;
-  raw_.assign(line);
-  if (raw_.find("log-util") != std::string::npos) {
-    self_log_ = true;
-    if (raw_.find("all logs") != std::string::npos) {
-      fru_num_ = FRU_ALL;
-    } else if (raw_.find("sys logs") != std::string::npos) {
-      fru_num_ = FRU_SYS;
-    }
-  } else if (raw_.find(".crit") == std::string::npos) {
-    throw SELParserError("Invalid log: " + raw_);
-  } else {
-    fru_num_ = default_fru_num_;
+namespace {
+
+// Fields of a log line, pointing into it.
+struct LogFields {
+  enum Kind { NONE, LOG, CLEAR };
+  Kind kind = NONE;
+  bool self = false;
+  int year = -1; // -1 for the legacy format.
+  int mon = 0;
+  int mday = 0;
+  int hour = 0;
+  int min = 0;
+  int sec = 0;
+  std::string_view hostname;
+  std::string_view version;
+  std::string_view app;
+  std::string_view msg;
+};
+
+class Tokenizer {
+  std::string_view str_;
+  size_t pos_ = 0;
+
+ public:
+  explicit Tokenizer(std::string_view str) : str_(str) {}
+
+  // Skip whitespace, returns false if there was none.
+  bool space() {
+    size_t start = pos_;
+    while (pos_ < str_.size() && isspace((unsigned char)str_[pos_]))
+      pos_++;
+    return pos_ > start;
   }
-  static const std::regex find_fru_re(R"(FRU: (\d+))");
-  std::smatch find_fru_match;
-  if (regex_search(line, find_fru_match, find_fru_re)) {
-    fru_num_ = std::stoi(find_fru_match[1]);
+  std::string_view word() {
+    size_t start = pos_;
+    while (pos_ < str_.size() && !isspace((unsigned char)str_[pos_]))
+      pos_++;
+    return str_.substr(start, pos_ - start);
   }
-  if (fru_num_ == FRU_ALL) {
-    fru_ = "all";
-  } else if (fru_num_ == FRU_SYS) {
-    fru_ = "sys";
-    // Do not leak internal choice of magic FRU_SYS.
-    fru_num_ = FRU_ALL;
-  } else {
-    fru_ = get_fru_name(fru_num_);
+  std::string_view rest() const {
+    return str_.substr(pos_);
   }
-  static const std::regex log_match(log_fmt.data());
-  static const std::regex log_match_legacy(log_fmt_legacy.data());
-  static const std::regex log_match_clr(log_fmt_clr.data());
+};
 
-  std::smatch sm;
-  if (bool year_fmt = false;
-      (year_fmt = std::regex_search(line, sm, log_match)) ||
-      std::regex_search(line, sm, log_match_legacy)) {
-    std::array<char, 256> curtime;
-    struct tm ts;
+bool parse_number(std::string_view str, int& val) {
+  if (str.empty())
+    return false;
+  val = 0;
+  for (char c : str) {
+    if (c < '0' || c > '9')
+      return false;
+    // Saturate, nothing valid gets this far.
+    val = val > 99999999 ? val : val * 10 + (c - '0');
+  }
+  return true;
+}
 
-    if (!year_fmt) {
-      strptime(sm[1].str().c_str(), "%b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%m-%d %H:%M:%S", &ts);
-    } else {
-      strptime(sm[1].str().c_str(), "%Y %b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
-    }
-    time_.assign(std::string(curtime.data()));
-    hostname_ = sm[2];
-    version_ = sm[3];
-    app_ = sm[4];
-    msg_ = sm[5];
-    bare_ = false;
+// Full or abbreviated month name, like strptime's %b.
+int parse_month(std::string_view str) {
+  static constexpr std::array<std::string_view, 12> months = {
+      "january", "february", "march", "april", "may", "june",
+      "july", "august", "september", "october", "november", "december"};
+  if (str.size() < 3)
+    return 0;
+  for (size_t i = 0; i < months.size(); i++) {
+    const auto& name = months[i];
+    if (str.size() != 3 && str.size() != name.size())
+      continue;
+    bool equal = true;
+    for (size_t j = 0; j < str.size() && equal; j++)
+      equal = tolower((unsigned char)str[j]) == name[j];
+    if (equal)
+      return i + 1;
+  }
+  return 0;
+}
+
+// [YYYY] MON DD HH:MM:SS
+bool parse_stamp(Tokenizer& tok, bool with_year, LogFields& f) {
+  if (with_year) {
+    auto year = tok.word();
+    if (year.size() != 4 || !parse_number(year, f.year) || !tok.space())
+      return false;
   } else {
-    if (self_log_ && std::regex_search(line, sm, log_match_clr)) {
-      std::array<char, 80> curtime;
-      struct tm ts;
-      strptime(sm[0].str().c_str(), "%Y %b %d %H:%M:%S", &ts);
-      strftime(curtime.data(), curtime.size(), "%Y-%m-%d %H:%M:%S", &ts);
-      time_.assign(std::string(curtime.data()));
-      hostname_ = "";
-      version_ = "";
-      app_ = sm[1];
-      msg_ = sm[2];
-    }
+    f.year = -1;
   }
+  f.mon = parse_month(tok.word());
+  if (f.mon == 0 || !tok.space() || !parse_number(tok.word(), f.mday) ||
+      !tok.space())
+    return false;
+  auto clock = tok.word();
+  auto c1 = clock.find(':');
+  auto c2 = c1 == clock.npos ? c1 : clock.find(':', c1 + 1);
+  if (c2 == clock.npos || !parse_number(clock.substr(0, c1), f.hour) ||
+      !parse_number(clock.substr(c1 + 1, c2 - c1 - 1), f.min) ||
+      !parse_number(clock.substr(c2 + 1), f.sec))
+    return false;
+  return f.mday >= 1 && f.mday <= 31 && f.hour < 24 && f.min < 60 &&
+      f.sec <= 61;
 }
 
-bool SELFormat::fits_time_range(const std::string& start_time, const std::string& end_time) {
-  time_t time_s, time_e, time_c;
-  std::smatch sm;
+// "TAG:" followed by whitespace.
+bool parse_tag(Tokenizer& tok, std::string_view& tag) {
+  auto word = tok.word();
+  if (word.size() < 2 || word.back() != ':' || !tok.space())
+    return false;
+  tag = word.substr(0, word.size() - 1);
+  return true;
+}
 
-  // construct the regexes
-  static const std::regex time_match(time_fmt.data());
-  static const std::regex time_match_legacy(time_fmt_legacy.data());
+bool parse_log(Tokenizer tok, bool with_year, LogFields& f) {
+  if (!parse_stamp(tok, with_year, f) || !tok.space())
+    return false;
+  f.hostname = tok.word();
+  if (f.hostname.empty() || !tok.space() || tok.word().empty() ||
+      !tok.space() || !parse_tag(tok, f.version) || !parse_tag(tok, f.app))
+    return false;
+  f.msg = tok.rest();
+  return !f.msg.empty();
+}
 
-  // not expecting both of these strings to be in the same format just in case
-  if (std::regex_search(start_time, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
-  } else if (std::regex_search(start_time, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_s = std::mktime(&ts);
-  } else {
+bool parse_clear(Tokenizer tok, LogFields& f) {
+  if (!parse_stamp(tok, true, f) || !tok.space() || !parse_tag(tok, f.app))
     return false;
+  f.hostname = f.version = {};
+  f.msg = tok.rest();
+  return !f.msg.empty();
+}
+
+// First "FRU: <number>" of the line.
+bool find_fru(std::string_view line, int& fru) {
+  static constexpr std::string_view tag = "FRU: ";
+  for (auto pos = line.find(tag); pos != line.npos;
+       pos = line.find(tag, pos + 1)) {
+    auto start = pos + tag.size();
+    auto end = start;
+    while (end < line.size() && line[end] >= '0' && line[end] <= '9')
+      end++;
+    if (parse_number(line.substr(start, end - start), fru))
+      return true;
+  }
+  return false;
+}
+
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+// Seconds of a wall clock time. The legacy format has no year, those
+// times land in 1900 (as they did with mktime()).
+int64_t to_seconds(int year, int mon, int mday, int hour, int min, int sec) {
+  return days_from_civil(year < 0 ? 1900 : year, mon, mday) * 86400 +
+      hour * 3600 + min * 60 + sec;
+}
+
+SELSummary summarize(std::string_view line, LogFields& f) {
+  SELSummary sum;
+  f.self = line.find("log-util") != line.npos;
+  if (!f.self && line.find(".crit") == line.npos)
+    return sum;
+  sum.flags = SELSummary::VALID | SELSummary::BARE;
+  if (f.self) {
+    if (line.find("all logs") != line.npos) {
+      sum.fru = SELFormat::FRU_ALL;
+    } else if (line.find("sys logs") != line.npos) {
+      sum.fru = SELFormat::FRU_SYS;
+    }
   }
+  if (int fru; find_fru(line, fru))
+    sum.fru = fru;
 
-  if (std::regex_search(end_time, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
-  } else if (std::regex_search(end_time, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_e = std::mktime(&ts);
+  Tokenizer tok(line);
+  tok.space();
+  if (parse_log(tok, true, f) || parse_log(tok, false, f)) {
+    f.kind = LogFields::LOG;
+    sum.flags &= ~SELSummary::BARE;
+  } else if (f.self && parse_clear(tok, f)) {
+    f.kind = LogFields::CLEAR;
   } else {
+    return sum;
+  }
+  sum.time = to_seconds(f.year, f.mon, f.mday, f.hour, f.min, f.sec);
+  sum.flags |= SELSummary::TIMED;
+  return sum;
+}
+
+// YYYY-MM-DD HH:MM:SS, or MM-DD HH:MM:SS without the year, at pos.
+bool match_time(std::string_view str, size_t pos, bool with_year,
+                int64_t& secs) {
+  auto fixed = [&](size_t len, char sep, int& val) {
+    if (pos + len > str.size())
+      return false;
+    for (size_t i = 0; i < len; i++)
+      if (str[pos + i] < '0' || str[pos + i] > '9')
+        return false;
+    parse_number(str.substr(pos, len), val);
+    pos += len;
+    if (sep == ' ') {
+      if (pos >= str.size() || !isspace((unsigned char)str[pos]))
+        return false;
+      while (pos < str.size() && isspace((unsigned char)str[pos]))
+        pos++;
+    } else if (sep != '\0') {
+      if (pos >= str.size() || str[pos] != sep)
+        return false;
+      pos++;
+    }
+    return true;
+  };
+  int year = -1, mon, mday, hour, min, sec;
+  if ((with_year && !fixed(4, '-', year)) || !fixed(2, '-', mon) ||
+      !fixed(2, ' ', mday) || !fixed(2, ':', hour) || !fixed(2, ':', min) ||
+      !fixed(2, '\0', sec))
     return false;
+  secs = to_seconds(year, mon, mday, hour, min, sec);
+  return true;
+}
+
+} // namespace
+
+bool SELSummary::fru_matches(const fru_set& frus, uint8_t default_fru) const {
+  int num = fru == FRU_NONE ? default_fru : fru;
+  if (num == SELFormat::FRU_SYS)
+    return frus.count(SELFormat::FRU_SYS) || frus.count(SELFormat::FRU_ALL);
+  return frus.count(SELFormat::FRU_ALL) || frus.count(num);
+}
+
+SELSummary SELFormat::summarize(std::string_view line) {
+  LogFields f;
+  return ::summarize(line, f);
+}
+
+bool SELFormat::parse_time(std::string_view str, int64_t& secs) {
+  for (bool with_year : {true, false}) {
+    for (size_t pos = 0; pos < str.size(); pos++) {
+      if (match_time(str, pos, with_year, secs))
+        return true;
+    }
   }
+  return false;
+}
 
-  // time_ is stored in a different format than displayed from what I can tell
-  if (std::regex_search(time_, sm, time_match)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%Y-%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
-  } else if (std::regex_search(time_, sm, time_match_legacy)) {
-    std::tm ts{};
-    strptime(sm[0].str().c_str(), "%m-%d %H:%M:%S", &ts);
-    time_c = std::mktime(&ts);
+void SELFormat::set_raw(std::string&& line) {
+  raw_.assign(line);
+  LogFields f;
+  summary_ = ::summarize(raw_, f);
+  self_log_ = f.self;
+  bare_ = true;
+  if (!(summary_.flags & SELSummary::VALID)) {
+    throw SELParserError("Invalid log: " + raw_);
+  }
+
+  fru_num_ = summary_.fru == SELSummary::FRU_NONE ? default_fru_num_
+                                                  : summary_.fru;
+  if (fru_num_ == FRU_ALL) {
+    fru_ = "all";
+  } else if (fru_num_ == FRU_SYS) {
+    fru_ = "sys";
+    // Do not leak internal choice of magic FRU_SYS.
+    fru_num_ = FRU_ALL;
   } else {
-    return false;
+    fru_ = get_fru_name(fru_num_);
   }
 
-  // check if it is too old
-  if (difftime(time_s, time_c) > 0) {
-    return false;
+  time_.clear();
+  if (summary_.flags & SELSummary::TIMED) {
+    std::array<char, 64> curtime;
+    if (f.year < 0) {
+      snprintf(curtime.data(), curtime.size(), "%02d-%02d %02d:%02d:%02d",
+               f.mon, f.mday, f.hour, f.min, f.sec);
+    } else {
+      snprintf(curtime.data(), curtime.size(),
+               "%04d-%02d-%02d %02d:%02d:%02d", f.year, f.mon, f.mday,
+               f.hour, f.min, f.sec);
+    }
+    time_.assign(curtime.data());
   }
-  if (difftime(time_c, time_e) > 0) {
+  hostname_ = f.hostname;
+  version_ = f.version;
+  app_ = f.app;
+  msg_ = f.msg;
+  bare_ = f.kind != LogFields::LOG;
+}
+
+bool SELFormat::fits_time_range(const std::string& start_time, const std::string& end_time) {
+  int64_t time_s, time_e;
+
+  // not expecting both of these strings to be in the same format just in case
+  if (!parse_time(start_time, time_s) || !parse_time(end_time, time_e)) {
     return false;
   }
-  return true;
+  return summary_.fits_time_range(time_s, time_e);
 }
 
 std::string SELFormat::str() const {
@@ -233,18 +405,3 @@ std::ostream& operator<<(std::ostream& os, const SELFormat& s) {
   os << s.str() << '\n';
   return os;
 }
-
-std::string get_output(const std::string& cmd) {
-  char buffer[128];
-  std::string output;
-  auto pipe_close = [](auto fd) { (void)pclose(fd); };
-  std::unique_ptr<FILE, decltype(pipe_close)> pipe(popen(cmd.c_str(), "r"), pipe_close);
-  if (!pipe) {
-    std::cerr << "Failed to open a pipe" << std::endl;
-    return "Error";
-  }
-  while (fgets(buffer, 128, pipe.get()) != NULL) {
-    output += buffer;
-  }
-  return output;
-}
@@ -6,6 +6,26 @@
 
 using fru_set = std::set<uint8_t>;
 
+// What filtering needs to know about a log line, small enough for
+// SELIndex to keep one per line. See SELFormat::summarize().
+struct SELSummary {
+  static constexpr int32_t FRU_NONE = -1;
+  static constexpr uint32_t VALID = 1; // Not a parser error.
+  static constexpr uint32_t BARE = 2; // Printed as is.
+  static constexpr uint32_t TIMED = 4; // time is set.
+
+  // Seconds of the time stamp, comparable with SELFormat::parse_time().
+  int64_t time = 0;
+  // FRU the line names, or FRU_NONE for the default FRU.
+  int32_t fru = FRU_NONE;
+  uint32_t flags = 0;
+
+  bool fru_matches(const fru_set& frus, uint8_t default_fru) const;
+  bool fits_time_range(int64_t start, int64_t end) const {
+    return (flags & TIMED) && start <= time && time <= end;
+  }
+};
+
 class SELFormat {
  public:
   static constexpr uint8_t FRU_SYS = 0xFE;
@@ -65,13 +85,22 @@ class SELFormat {
     bare_ = true;
   }
   bool fru_matches(const fru_set& frus) {
-    if (frus.count(FRU_SYS) && fru_ == "sys")
-      return true;
-    return (frus.count(FRU_ALL) || frus.count(fru_num_));
+    return summary_.fru_matches(frus, default_fru_num_);
+  }
+  const SELSummary& summary() const {
+    return summary_;
   }
 
   bool fits_time_range(const std::string& start_time, const std::string& end_time);
 
+  // Summarize a line the way set_raw() would parse it, without looking
+  // up FRU names.
+  static SELSummary summarize(std::string_view line);
+
+  // Parse the first "YYYY-MM-DD HH:MM:SS" (or legacy "MM-DD HH:MM:SS")
+  // time in str as seconds. Returns false if there is none.
+  static bool parse_time(std::string_view str, int64_t& secs);
+
  private:
   bool bare_ = true;
   bool self_log_ = false;
@@ -84,6 +113,7 @@ class SELFormat {
   int default_fru_num_;
   int fru_num_ = -1;
   std::string raw_ = "";
+  SELSummary summary_;
 
   static constexpr size_t fru_num_left_align = 4;
   static constexpr size_t fru_name_left_align = 8;
@@ -104,26 +134,13 @@ class SELFormat {
   // rsyslogd's configuration and we ended up with the logfile
   // stored in persistent store without a year in the time stamp.
   // This is a hack-workaround to prevent parsing inconsistencies.
-  static constexpr std::string_view log_fmt =
-      R"(([0-9]{4}\s+\S+\s+\d+\s+\d+:\d+:\d+)\s+(\S+)\s+\S+\s+(\S+):\s+(\S+):\s+(.+)$)";
-
-  static constexpr std::string_view log_fmt_legacy =
-      R"((\S+\s+\d+\s+\d+:\d+:\d+)\s+(\S+)\s+\S+\s+(\S+):\s+(\S+):\s+(.+)$)";
-
-  static constexpr std::string_view log_fmt_clr =
-      R"(([0-9]{4}\s+\S+\s+\d+\s+\d+:\d+:\d+)\s+(\S+):\s+(.+)$)";
-
-  static constexpr std::string_view time_fmt =
-    R"([0-9]{4}-[0-9]{2}-[0-9]{2}\s+[0-9]{2}:[0-9]{2}:[0-9]{2})";
-
-  static constexpr std::string_view time_fmt_legacy =
-    R"([0-9]{2}-[0-9]{2}\s+[0-9]{2}:[0-9]{2}:[0-9]{2})";
-
-  static constexpr std::string_view release_fmt =
-    R"(OpenBMC Release (\S+))";
+  // These are matched by a hand-written parser (std::regex was most of
+  // the time spent printing a large log):
+  //   log:    YYYY MON DD HH:MM:SS HOSTNAME SEVERITY VERSION: APP: MESSAGE
+  //   legacy: MON DD HH:MM:SS HOSTNAME SEVERITY VERSION: APP: MESSAGE
+  //   clear:  YYYY MON DD HH:MM:SS APP: MESSAGE
 };
 
 void to_json(nlohmann::json& j, const SELFormat& sel);
 std::istream& operator>>(std::istream& is, SELFormat& s);
 std::ostream& operator<<(std::ostream& os, const SELFormat& s);
-std::string get_output(const std::string& cmd);
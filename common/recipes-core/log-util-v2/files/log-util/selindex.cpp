@@ -0,0 +1,209 @@
+#include "selindex.hpp"
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(SELIndex::Entry) == 24, "index entries are stored as is");
+
+SELIndex::~SELIndex() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+size_t SELIndex::pread_full(uint64_t offset, char* buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    ssize_t n = pread(fd_, buf + done, len - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      throw std::runtime_error(logfile_ + " read failed: " + strerror(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  return done;
+}
+
+// FNV-1a of the bytes [offset, end) of the log file.
+uint32_t SELIndex::line_hash(uint64_t offset, uint64_t end) {
+  std::array<char, 512> buf;
+  uint32_t hash = 2166136261u;
+  while (offset < end) {
+    size_t len = pread_full(
+        offset, buf.data(), std::min<uint64_t>(buf.size(), end - offset));
+    if (len == 0) {
+      break;
+    }
+    for (size_t i = 0; i < len; i++) {
+      hash = (hash ^ uint8_t(buf[i])) * 16777619u;
+    }
+    offset += len;
+  }
+  return hash;
+}
+
+bool SELIndex::load(int fd, const Header& hdr) {
+  struct stat log_st, idx_st;
+  if (hdr.magic != index_magic || hdr.version != index_version ||
+      fstat(fd_, &log_st) != 0 || fstat(fd, &idx_st) != 0 ||
+      hdr.dev != uint64_t(log_st.st_dev) ||
+      hdr.ino != uint64_t(log_st.st_ino) || hdr.size > size_ ||
+      hdr.count > (uint64_t(idx_st.st_size) - sizeof(hdr)) / sizeof(Entry) ||
+      (hdr.count == 0) != (hdr.size == 0)) {
+    return false;
+  }
+
+  entries_.resize(hdr.count);
+  size_t len = hdr.count * sizeof(Entry);
+  if (pread(fd, entries_.data(), len, sizeof(hdr)) != ssize_t(len) ||
+      (hdr.count > 0 && entries_.back().offset >= hdr.size)) {
+    return false;
+  }
+
+  // The log file may have been truncated and written again since, or
+  // its inode reused by a new one.
+  if (hdr.count > 0) {
+    uint64_t first_end = hdr.count > 1 ? entries_[1].offset : hdr.size;
+    if (line_hash(0, first_end) != hdr.head ||
+        line_hash(entries_.back().offset, hdr.size) != hdr.tail) {
+      return false;
+    }
+  }
+  indexed_ = hdr.size;
+  return true;
+}
+
+void SELIndex::save(int fd, const Header& hdr, size_t from) {
+  size_t len = (entries_.size() - from) * sizeof(Entry);
+  off_t pos = sizeof(hdr) + from * sizeof(Entry);
+  // The header goes last: until then, it describes the old entries.
+  if (pwrite(fd, entries_.data() + from, len, pos) == ssize_t(len)) {
+    (void)pwrite(fd, &hdr, sizeof(hdr), 0);
+  }
+}
+
+void SELIndex::update() {
+  fd_ = open(logfile_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    throw std::runtime_error(logfile_ + " open failed");
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    throw std::runtime_error(logfile_ + " stat failed");
+  }
+  size_ = st.st_size;
+
+  // The index file is only a cache, without one the log file is indexed
+  // in memory.
+  auto slash = path_.rfind('/');
+  if (slash != std::string::npos && slash > 0) {
+    mkdir(path_.substr(0, slash).c_str(), 0755);
+  }
+  int ifd = open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (ifd >= 0 && flock(ifd, LOCK_EX) != 0) {
+    close(ifd);
+    ifd = -1;
+  }
+
+  Header hdr{};
+  bool valid = ifd >= 0 &&
+      pread(ifd, &hdr, sizeof(hdr), 0) == ssize_t(sizeof(hdr)) &&
+      load(ifd, hdr);
+  if (!valid) {
+    entries_.clear();
+    indexed_ = 0;
+  }
+  size_t old_count = entries_.size();
+
+  // Index the complete lines appended since.
+  std::string chunk, stripped;
+  size_t want = chunk_size;
+  while (indexed_ < size_) {
+    chunk.resize(std::min<uint64_t>(want, size_ - indexed_));
+    chunk.resize(pread_full(indexed_, &chunk[0], chunk.size()));
+    size_t start = 0;
+    for (size_t nl; (nl = chunk.find('\n', start)) != std::string::npos;
+         start = nl + 1) {
+      std::string_view line(chunk.data() + start, nl - start);
+      // Like operator>>(std::istream&, SELFormat&).
+      if (line.find('\0') != std::string_view::npos) {
+        stripped.assign(line);
+        stripped.erase(
+            std::remove(stripped.begin(), stripped.end(), '\0'),
+            stripped.end());
+        line = stripped;
+      }
+      entries_.push_back({indexed_ + start, SELFormat::summarize(line)});
+    }
+    if (start == 0) {
+      // Either the last line is still being written, or it is longer
+      // than the chunk.
+      if (indexed_ + chunk.size() >= size_) {
+        break;
+      }
+      want *= 2;
+      continue;
+    }
+    indexed_ += start;
+  }
+
+  if (ifd >= 0) {
+    if (!valid || entries_.size() > old_count) {
+      Header nhdr{};
+      nhdr.magic = index_magic;
+      nhdr.version = index_version;
+      nhdr.dev = st.st_dev;
+      nhdr.ino = st.st_ino;
+      nhdr.size = indexed_;
+      nhdr.count = entries_.size();
+      if (!entries_.empty()) {
+        nhdr.head = line_hash(
+            0, entries_.size() > 1 ? entries_[1].offset : indexed_);
+        nhdr.tail = line_hash(entries_.back().offset, indexed_);
+      }
+      if (!valid) {
+        (void)ftruncate(ifd, 0);
+      }
+      save(ifd, nhdr, valid ? old_count : 0);
+    }
+    close(ifd);
+  }
+}
+
+bool SELIndex::read_line(uint64_t offset, std::string& line, uint64_t& next) {
+  size_t want = chunk_size;
+  for (;;) {
+    if (offset >= buf_offset_ && offset - buf_offset_ < buf_.size()) {
+      size_t start = offset - buf_offset_;
+      size_t nl = buf_.find('\n', start);
+      // Like getline(), the last line may not end with a newline.
+      if (nl != std::string::npos || buf_.size() < want) {
+        size_t end = nl != std::string::npos ? nl : buf_.size();
+        line.assign(buf_, start, end - start);
+        line.erase(std::remove(line.begin(), line.end(), '\0'), line.end());
+        next = buf_offset_ + end + (nl != std::string::npos);
+        return true;
+      }
+      if (start == 0) {
+        want = buf_.size() * 2;
+      }
+    }
+    buf_.resize(want);
+    buf_.resize(pread_full(offset, &buf_[0], want));
+    buf_offset_ = offset;
+    if (buf_.empty()) {
+      return false;
+    }
+  }
+}
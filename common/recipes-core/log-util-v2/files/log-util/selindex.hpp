@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "selformat.hpp"
+
+// Sidecar index of a log file: the offset and SELSummary of every complete
+// line, so a query only reads and parses the lines it prints.
+// The index is kept in a file of its own and brought up to date with the
+// lines appended since the previous query. A log file which was replaced
+// (rotated, cleared) or truncated is indexed from scratch.
+class SELIndex {
+ public:
+  struct Entry {
+    uint64_t offset;
+    SELSummary summary;
+  };
+
+  SELIndex(const std::string& logfile, const std::string& path)
+      : logfile_(logfile), path_(path) {}
+  ~SELIndex();
+  SELIndex(const SELIndex& other) = delete;
+  SELIndex& operator=(const SELIndex& other) = delete;
+
+  // Open the log file and index the lines appended since the last update.
+  void update();
+
+  const std::vector<Entry>& entries() const {
+    return entries_;
+  }
+  // Bytes of the log file covered by entries(). A line still being
+  // written is not indexed, but can be read past this offset.
+  uint64_t indexed_size() const {
+    return indexed_;
+  }
+
+  // Read the line at offset without its newline, and the offset of the
+  // next one. Returns false at the end of the file.
+  bool read_line(uint64_t offset, std::string& line, uint64_t& next);
+
+ private:
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size; // Bytes of the log file indexed.
+    uint64_t count; // Entries following the header.
+    uint32_t head; // Hash of the first line.
+    uint32_t tail; // Hash of the last line.
+  };
+  static constexpr uint32_t index_magic = 0x494c4553; // "SELI"
+  static constexpr uint32_t index_version = 1;
+  static constexpr size_t chunk_size = 64 * 1024;
+
+  bool load(int fd, const Header& hdr);
+  void save(int fd, const Header& hdr, size_t from);
+  uint32_t line_hash(uint64_t offset, uint64_t end);
+  size_t pread_full(uint64_t offset, char* buf, size_t len);
+
+  std::string logfile_;
+  std::string path_;
+  int fd_ = -1;
+  uint64_t size_ = 0;
+  uint64_t indexed_ = 0;
+  std::vector<Entry> entries_;
+
+  // Window of the log file read_line() reads from.
+  std::string buf_;
+  uint64_t buf_offset_ = 0;
+};
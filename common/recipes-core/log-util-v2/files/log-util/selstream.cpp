@@ -1,12 +1,17 @@
 #include "selstream.hpp"
 #include "selexception.hpp"
+#include <algorithm>
 #include <iostream>
 
 void SELStream::flush(std::ostream& os) {
   if (fmt_ == FORMAT_JSON) {
-    nlohmann::json j;
-    j["Logs"] = sel_list_;
-    os << j.dump(4) << '\n';
+    // Closes what emit() opened, the same as dump(4) of {"Logs": [...]}.
+    if (json_records_ == 0) {
+      os << "{\n    \"Logs\": []\n}\n";
+    } else {
+      os << "\n    ]\n}\n";
+    }
+    json_records_ = 0;
   }
   os.flush();
 }
@@ -15,6 +20,82 @@ std::unique_ptr<SELFormat> SELStream::make_sel(uint8_t default_fru) {
   return std::make_unique<SELFormat>(default_fru);
 }
 
+SELStream::Query::Query(
+    const fru_set& filter_fru,
+    const std::string& start_time,
+    const std::string& end_time)
+    : frus(filter_fru),
+      default_fru(
+          filter_fru.count(SELFormat::FRU_SYS) > 0 ? SELFormat::FRU_SYS
+                                                   : SELFormat::FRU_ALL),
+      timestamp(!(start_time.empty() || end_time.empty())) {
+  valid_range = timestamp && SELFormat::parse_time(start_time, start) &&
+      SELFormat::parse_time(end_time, end);
+}
+
+bool SELStream::selected(const SELSummary& summary, const Query& query) const {
+  if (fmt_ == FORMAT_JSON && (summary.flags & SELSummary::BARE)) {
+    // RAW is used by clear and we filter out all previous
+    // logs injected by this utility.
+    // We do not send this as JSON format as well.
+    return false;
+  }
+  bool blacklist = fmt_ == FORMAT_RAW;
+  bool matches = summary.fru_matches(query.frus, query.default_fru);
+  if (query.timestamp) {
+    matches = matches && query.valid_range &&
+        summary.fits_time_range(query.start, query.end);
+  }
+  return matches ^ blacklist;
+}
+
+void SELStream::emit(SELFormat& sel, std::ostream& os) {
+  if (skip_ > 0) {
+    skip_--;
+    return;
+  }
+  if (limit_ == 0)
+    return;
+  limit_--;
+
+  if (fmt_ == FORMAT_RAW)
+    sel.force_bare();
+  if (fmt_ == FORMAT_JSON) {
+    // Written as it comes rather than collected for flush(), indented
+    // as an element of the "Logs" array.
+    std::string record = nlohmann::json(sel).dump(4);
+    for (size_t pos = 0; (pos = record.find('\n', pos)) != std::string::npos;
+         pos += 9) {
+      record.replace(pos, 1, "\n        ");
+    }
+    os << (json_records_++ == 0 ? "{\n    \"Logs\": [\n        "
+                                : ",\n        ")
+       << record;
+  } else {
+    os << sel;
+  }
+}
+
+// Returns false to stop parsing.
+bool SELStream::parse(
+    SELFormat& sel,
+    std::string&& line,
+    std::ostream& os,
+    const Query& query,
+    const ParserFlag flag) {
+  try {
+    sel.set_raw(std::move(line));
+    if (selected(sel.summary(), query))
+      emit(sel, os);
+  } catch (SELException& e) {
+    if (flag & PARSE_STOP_ON_ERR) {
+      std::cerr << "[ERR] " << e.what() << std::endl;
+      return false;
+    }
+  }
+  return !done();
+}
+
 void SELStream::start(
     std::istream& is,
     std::ostream& os,
@@ -22,39 +103,27 @@ void SELStream::start(
     const std::string& start_time,
     const std::string& end_time,
     const ParserFlag flag) {
-  uint8_t default_fru_id = filter_fru.count(SELFormat::FRU_SYS) > 0
-      ? SELFormat::FRU_SYS
-      : SELFormat::FRU_ALL;
-  std::unique_ptr<SELFormat> sel = make_sel(default_fru_id);
+  Query query(filter_fru, start_time, end_time);
+  std::unique_ptr<SELFormat> sel = make_sel(query.default_fru);
+  if (newest_first_) {
+    // Without an index, the whole log has to be read first.
+    std::vector<std::string> lines;
+    for (std::string line; getline(is, line);) {
+      line.erase(std::remove(line.begin(), line.end(), '\0'), line.end());
+      lines.push_back(std::move(line));
+    }
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+      if (!parse(*sel, std::move(*it), os, query, flag))
+        break;
+    }
+    return;
+  }
   do {
     try {
-      if (!(is >> *sel))
+      if (done() || !(is >> *sel))
         break;
-      if (fmt_ == FORMAT_JSON && sel->is_bare()) {
-        // RAW is used by clear and we filter out all previous
-        // logs injected by this utility.
-        // We do not send this as JSON format as well.
-        continue;
-      }
-      bool blacklist = fmt_ == FORMAT_RAW;
-      bool timestamp = !(start_time.empty() || end_time.empty());
-      if (timestamp) {
-          if (!((sel->fru_matches(filter_fru) && sel->fits_time_range(start_time, end_time)) ^ blacklist)) {
-            continue;
-          }
-      } else {
-          if (!(sel->fru_matches(filter_fru) ^ blacklist)) {
-            continue;
-          }
-      }
-      if (fmt_ == FORMAT_RAW)
-        sel->force_bare();
-      if (fmt_ == FORMAT_JSON) {
-        nlohmann::json j(*sel);
-        sel_list_.push_back(j);
-      } else {
-        os << *sel;
-      }
+      if (selected(sel->summary(), query))
+        emit(*sel, os);
     } catch (SELException &e) {
       if (flag & PARSE_STOP_ON_ERR) {
         std::cerr << "[ERR] " << e.what() << std::endl;
@@ -64,6 +133,63 @@ void SELStream::start(
   } while (!is.eof());
 }
 
+void SELStream::start(
+    SELIndex& index,
+    std::ostream& os,
+    const fru_set& filter_fru,
+    const std::string& start_time,
+    const std::string& end_time,
+    const ParserFlag flag) {
+  Query query(filter_fru, start_time, end_time);
+  std::unique_ptr<SELFormat> sel = make_sel(query.default_fru);
+  std::string line;
+  uint64_t next;
+
+  // Lines appended since the index was updated.
+  std::vector<std::string> tail;
+  for (uint64_t offset = index.indexed_size();
+       index.read_line(offset, line, next);
+       offset = next) {
+    tail.push_back(std::move(line));
+  }
+
+  auto indexed = [&](const SELIndex::Entry& entry) {
+    // Lines which do not parse are only read to report them.
+    bool valid = entry.summary.flags & SELSummary::VALID;
+    if (valid ? !selected(entry.summary, query)
+              : !(flag & PARSE_STOP_ON_ERR))
+      return true;
+    // Neither are records before the page.
+    if (valid && skip_ > 0) {
+      skip_--;
+      return true;
+    }
+    return !index.read_line(entry.offset, line, next) ||
+        parse(*sel, std::move(line), os, query, flag);
+  };
+
+  const auto& entries = index.entries();
+  if (newest_first_) {
+    for (auto it = tail.rbegin(); it != tail.rend(); ++it) {
+      if (!parse(*sel, std::move(*it), os, query, flag))
+        return;
+    }
+    for (auto it = entries.rbegin(); it != entries.rend(); ++it) {
+      if (!indexed(*it))
+        return;
+    }
+  } else {
+    for (const auto& entry : entries) {
+      if (!indexed(entry))
+        return;
+    }
+    for (auto& tail_line : tail) {
+      if (!parse(*sel, std::move(tail_line), os, query, flag))
+        return;
+    }
+  }
+}
+
 void SELStream::log_cleared(std::ostream& os,
         const fru_set& affected_frus,
         const std::string& start_time,
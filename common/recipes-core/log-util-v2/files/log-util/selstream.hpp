@@ -1,23 +1,68 @@
 #pragma once
 #include <iostream>
+#include <limits>
 #include <memory>
 #include "selformat.hpp"
+#include "selindex.hpp"
 
 enum OutputFormat { FORMAT_PRINT, FORMAT_RAW, FORMAT_JSON };
 enum ParserFlag {
   PARSE_ALL         = 0,
   PARSE_STOP_ON_ERR = 1,
 };
+// A page of records, counted from the newest one.
+struct SELPage {
+  size_t offset = 0;
+  size_t limit = std::numeric_limits<size_t>::max();
+};
+
 class SELStream {
-  nlohmann::json sel_list_ = nlohmann::json::array();
   OutputFormat fmt_;
+  // JSON records written so far, they are not kept around.
+  size_t json_records_ = 0;
+  bool newest_first_ = false;
+  size_t skip_ = 0;
+  size_t limit_ = std::numeric_limits<size_t>::max();
+
+  // A filter, with its time range parsed once.
+  struct Query {
+    Query(const fru_set& frus, const std::string& start_time,
+          const std::string& end_time);
+    const fru_set& frus;
+    uint8_t default_fru;
+    bool timestamp;
+    bool valid_range = false;
+    int64_t start = 0;
+    int64_t end = 0;
+  };
+  bool selected(const SELSummary& summary, const Query& query) const;
+  void emit(SELFormat& sel, std::ostream& os);
+  bool parse(SELFormat& sel, std::string&& line, std::ostream& os,
+             const Query& query, const ParserFlag flag);
 
  public:
   explicit SELStream(OutputFormat fmt) : fmt_(fmt) {}
   virtual ~SELStream() {}
   void flush(std::ostream& os);
+  // Read the logs newest first and only print the records of the page.
+  // Pages span all the start() calls of the stream.
+  void set_page(const SELPage& page) {
+    newest_first_ = true;
+    skip_ = page.offset;
+    limit_ = page.limit;
+  }
+  bool newest_first() const {
+    return newest_first_;
+  }
+  // The page is full.
+  bool done() const {
+    return limit_ == 0;
+  }
   virtual std::unique_ptr<SELFormat> make_sel(uint8_t default_fru);
   void start(std::istream& is, std::ostream& os, const fru_set& filter_fru,
           const std::string& start_time, const std::string& end_time, const ParserFlag flag = PARSE_ALL);
+  // Like start(), but only parses the lines of the index passing the filter.
+  void start(SELIndex& index, std::ostream& os, const fru_set& filter_fru,
+          const std::string& start_time, const std::string& end_time, const ParserFlag flag = PARSE_ALL);
   void log_cleared(std::ostream& os, const fru_set& affected_frus, const std::string& start_time, const std::string& end_time);
 };
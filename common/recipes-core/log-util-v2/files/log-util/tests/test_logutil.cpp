@@ -1,5 +1,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include "log-util.hpp"
@@ -27,6 +29,10 @@ class MockLogUtil : public LogUtil {
   MOCK_METHOD1(make_stream, std::unique_ptr<SELStream>(OutputFormat));
   MOCK_METHOD0(make_rsyslogd, std::unique_ptr<rsyslogd>());
   MOCK_METHOD0(logfile_list, const std::vector<std::string>&());
+  // Keep the indexes next to the test logs instead of in /tmp/log-util.
+  std::string index_path(const std::string& logfile) override {
+    return logfile + ".idx";
+  }
 };
 
 class MockRsyslog : public rsyslogd {
@@ -42,16 +48,21 @@ class LogPrintTest : public ::testing::Test {
   uint8_t my_fru_id = SELFormat::FRU_ALL;
   LogPrintTest() {}
 
+  // Only the lines passing the filter are parsed, so FRU names are only
+  // looked up for those (the mb line of logfile.0 and the nic lines of
+  // logfile).
   void make_logutil(
       uint8_t my_fru_id = SELFormat::FRU_ALL,
-      OutputFormat fmt = FORMAT_PRINT) {
+      OutputFormat fmt = FORMAT_PRINT,
+      int mb_lookups = 1,
+      int nic_lookups = 2) {
     logutil = make_unique<MockLogUtil>();
     auto sel1 = std::make_unique<MockSELFormat>(my_fru_id);
-    EXPECT_CALL(*sel1, get_fru_name(1)).Times(1).WillOnce(Return(string("mb")));
+    ON_CALL(*sel1, get_fru_name(1)).WillByDefault(Return(string("mb")));
+    EXPECT_CALL(*sel1, get_fru_name(1)).Times(mb_lookups);
     auto sel2 = std::make_unique<MockSELFormat>(my_fru_id);
-    EXPECT_CALL(*sel2, get_fru_name(2))
-        .Times(2)
-        .WillRepeatedly(Return(string("nic")));
+    ON_CALL(*sel2, get_fru_name(2)).WillByDefault(Return(string("nic")));
+    EXPECT_CALL(*sel2, get_fru_name(2)).Times(nic_lookups);
     auto stream = std::make_unique<MockSELStream>(fmt);
     EXPECT_CALL(*stream, make_sel(my_fru_id))
         .Times(2)
@@ -80,6 +91,8 @@ class LogPrintTest : public ::testing::Test {
   void TearDown() {
     remove("./logfile");
     remove("./logfile.0");
+    remove("./logfile.idx");
+    remove("./logfile.0.idx");
     logutil = nullptr;
   }
 };
@@ -100,7 +113,7 @@ TEST_F(LogPrintTest, BasicPrintAll) {
 
 TEST_F(LogPrintTest, BasicPrintSome) {
   stringstream outp;
-  make_logutil();
+  make_logutil(SELFormat::FRU_ALL, FORMAT_PRINT, 0, 2);
   logutil->print({2}, "", "", false, outp);
 
   stringstream exp;
@@ -112,7 +125,7 @@ TEST_F(LogPrintTest, BasicPrintSome) {
 
 TEST_F(LogPrintTest, BasicPrintSys) {
   stringstream outp;
-  make_logutil(SELFormat::FRU_SYS);
+  make_logutil(SELFormat::FRU_SYS, FORMAT_PRINT, 0, 0);
   logutil->print({SELFormat::FRU_SYS}, "", "", false, outp);
 
   stringstream exp;
@@ -123,7 +136,7 @@ TEST_F(LogPrintTest, BasicPrintSys) {
 
 TEST_F(LogPrintTest, BasicPrintTimestamp) {
   stringstream outp;
-  make_logutil();
+  make_logutil(SELFormat::FRU_ALL, FORMAT_PRINT, 0, 1);
   logutil->print({SELFormat::FRU_ALL}, "2020-05-18 00:00:00", "2020-05-19 00:00:00", false, outp);
 
   stringstream exp;
@@ -140,14 +153,17 @@ class LogClearTest : public ::testing::Test {
   std::unique_ptr<MockLogUtil> logutil = nullptr;
   LogClearTest() {}
 
-  void make_logutil(uint8_t my_fru_id, uint8_t cleared_fru) {
+  // Clearing all logs truncates the log files without reading them.
+  void make_logutil(uint8_t my_fru_id, uint8_t cleared_fru, bool reads_logs = true) {
     logutil = make_unique<MockLogUtil>();
     auto sel1 = std::make_unique<MockSELFormat>(my_fru_id);
-    EXPECT_CALL(*sel1, get_fru_name(1)).Times(1).WillOnce(Return(string("mb")));
     auto sel2 = std::make_unique<MockSELFormat>(my_fru_id);
-    EXPECT_CALL(*sel2, get_fru_name(2))
-        .Times(2)
-        .WillRepeatedly(Return(string("nic")));
+    if (reads_logs) {
+      EXPECT_CALL(*sel1, get_fru_name(1)).Times(1).WillOnce(Return(string("mb")));
+      EXPECT_CALL(*sel2, get_fru_name(2))
+          .Times(2)
+          .WillRepeatedly(Return(string("nic")));
+    }
     auto sel3 = std::make_unique<MockSELFormat>(my_fru_id);
     if (cleared_fru != SELFormat::FRU_ALL &&
         cleared_fru != SELFormat::FRU_SYS) {
@@ -161,12 +177,18 @@ class LogClearTest : public ::testing::Test {
     auto stream = std::make_unique<MockSELStream>(FORMAT_RAW);
     auto rslog = std::make_unique<MockRsyslog>();
     EXPECT_CALL(*rslog, reload()).Times(1);
-    EXPECT_CALL(
-        *stream, make_sel(AnyOf(SELFormat::FRU_ALL, SELFormat::FRU_SYS)))
-        .Times(3)
-        .WillOnce(Return(ByMove(std::move(sel1))))
-        .WillOnce(Return(ByMove(std::move(sel2))))
-        .WillOnce(Return(ByMove(std::move(sel3))));
+    if (reads_logs) {
+      EXPECT_CALL(
+          *stream, make_sel(AnyOf(SELFormat::FRU_ALL, SELFormat::FRU_SYS)))
+          .Times(3)
+          .WillOnce(Return(ByMove(std::move(sel1))))
+          .WillOnce(Return(ByMove(std::move(sel2))))
+          .WillOnce(Return(ByMove(std::move(sel3))));
+    } else {
+      EXPECT_CALL(*stream, make_sel(SELFormat::FRU_ALL))
+          .Times(1)
+          .WillOnce(Return(ByMove(std::move(sel3))));
+    }
     EXPECT_CALL(*logutil, make_stream(FORMAT_RAW))
         .Times(1)
         .WillOnce(Return(ByMove(std::move(stream))));
@@ -193,12 +215,14 @@ class LogClearTest : public ::testing::Test {
   void TearDown() {
     remove("./logfile");
     remove("./logfile.0");
+    remove("./logfile.idx");
+    remove("./logfile.0.idx");
     logutil = nullptr;
   }
 };
 
 TEST_F(LogClearTest, BasicClearAll) {
-  make_logutil(SELFormat::FRU_ALL, SELFormat::FRU_ALL);
+  make_logutil(SELFormat::FRU_ALL, SELFormat::FRU_ALL, false);
   logutil->clear({SELFormat::FRU_ALL}, "", "");
   ifstream ifs;
   ifs.open("./logfile.0");
@@ -281,3 +305,16 @@ TEST_F(LogClearTest, BasicClearTimestamp) {
   exp << "2020 Jun 21 17:29:55 log-util: User cleared all logs from 2020-05-18 10:18:39 to 2020-05-19 00:00:00\n";
   EXPECT_EQ(str, exp.str());
 }
+
+TEST_F(LogClearTest, ClearInPlace) {
+  struct stat before, after;
+  ASSERT_EQ(stat("./logfile", &before), 0);
+  make_logutil(SELFormat::FRU_ALL, 2);
+  logutil->clear({2}, "", "");
+  ASSERT_EQ(stat("./logfile", &after), 0);
+  // rsyslogd keeps writing to the same file.
+  EXPECT_EQ(before.st_ino, after.st_ino);
+  EXPECT_EQ(
+      after.st_size,
+      strlen("2020 Jun 21 17:29:55 log-util: User cleared FRU: 2 logs\n"));
+}
@@ -1,5 +1,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <filesystem>
+#include <fstream>
 #include "rsyslogd.hpp"
 
 using namespace std;
@@ -9,30 +13,69 @@ class MockRsyslogd : public rsyslogd {
  public:
   MockRsyslogd() : rsyslogd() {}
   MOCK_METHOD0(getpid, int());
-  MOCK_METHOD1(runcmd, void(const std::string&));
-  MOCK_METHOD2(runcmd, void(const std::string&, std::string&));
+  MOCK_METHOD2(signal, void(int, int));
 };
 
 TEST(rsyslogdTest, BasicCallTest) {
   MockRsyslogd r;
   EXPECT_CALL(r, getpid()).Times(1).WillOnce(Return(42));
-  EXPECT_CALL(r, runcmd("kill -HUP 42")).Times(1);
+  EXPECT_CALL(r, signal(42, SIGHUP)).Times(1);
   r.reload();
 }
 
 class Mock2Rsyslogd : public rsyslogd {
  public:
-  Mock2Rsyslogd() : rsyslogd() {}
-  MOCK_METHOD1(runcmd, void(const std::string&));
-  MOCK_METHOD2(runcmd, void(const std::string&, std::string&));
+  Mock2Rsyslogd(const string& pidfile, const string& proc)
+      : rsyslogd(pidfile, proc) {}
+  MOCK_METHOD2(signal, void(int, int));
 };
 
-TEST(rsyslogdTest, FullCallTest) {
-  Mock2Rsyslogd r;
-  // EXPECT_CALL(r, getpid()).WillOnce([&r]() {return r.rsyslogd::getpid();});
-  EXPECT_CALL(r, runcmd("pidof rsyslogd", _))
-      .Times(1)
-      .WillRepeatedly(SetArgReferee<1>("42"));
-  EXPECT_CALL(r, runcmd("kill -HUP 42")).Times(1);
+class rsyslogdProcTest : public ::testing::Test {
+ protected:
+  const string proc = "./test-proc";
+  const string pidfile = "./test-proc/rsyslogd.pid";
+
+  void process(int pid, const string& comm) {
+    string dir = proc + "/" + to_string(pid);
+    mkdir(dir.c_str(), 0755);
+    ofstream(dir + "/comm") << comm << '\n';
+  }
+
+  void SetUp() {
+    filesystem::remove_all(proc);
+    mkdir(proc.c_str(), 0755);
+    process(1, "init");
+    process(42, "rsyslogd");
+    process(64, "bash");
+  }
+  void TearDown() {
+    filesystem::remove_all(proc);
+  }
+};
+
+TEST_F(rsyslogdProcTest, ScanProc) {
+  Mock2Rsyslogd r("./test-proc/missing.pid", proc);
+  EXPECT_CALL(r, signal(42, SIGHUP)).Times(1);
   r.reload();
 }
+
+TEST_F(rsyslogdProcTest, PidFile) {
+  process(43, "rsyslogd");
+  ofstream(pidfile) << "43\n";
+  Mock2Rsyslogd r(pidfile, proc);
+  EXPECT_CALL(r, signal(43, SIGHUP)).Times(1);
+  r.reload();
+}
+
+TEST_F(rsyslogdProcTest, StalePidFile) {
+  ofstream(pidfile) << "64\n";
+  Mock2Rsyslogd r(pidfile, proc);
+  EXPECT_EQ(r.getpid(), 42);
+}
+
+TEST_F(rsyslogdProcTest, NotRunning) {
+  filesystem::remove_all(proc + "/42");
+  Mock2Rsyslogd r(pidfile, proc);
+  EXPECT_CALL(r, signal(_, _)).Times(0);
+  EXPECT_THROW(r.reload(), runtime_error);
+}
@@ -0,0 +1,191 @@
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <fstream>
+#include <sstream>
+#include "selstream.hpp"
+
+using namespace std;
+using namespace testing;
+
+class MockSELStream : public SELStream {
+ public:
+  MockSELStream(OutputFormat fmt) : SELStream(fmt) {}
+  MOCK_METHOD1(make_sel, std::unique_ptr<SELFormat>(uint8_t));
+};
+
+class MockSELFormat : public SELFormat {
+ public:
+  MockSELFormat(uint8_t fru_id) : SELFormat(fru_id) {}
+
+  MOCK_METHOD1(get_fru_name, string(uint8_t));
+  MOCK_METHOD0(get_current_time, string());
+};
+
+static const string line1 =
+    " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - caused by reboot command\n";
+static const string line2 =
+    " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH\n";
+static const string line3 =
+    " 2020 May 18 10:18:38 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: ncsid: FRU: 2 NIC AEN Supported: 0x7, AEN Enable Mask=0x7\n";
+static const string line4 =
+    "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+
+class SELIndexTest : public ::testing::Test {
+ protected:
+  const string logfile = "./logfile.idxtest";
+  const string indexfile = "./logfile.idxtest.idx";
+
+  void write(const string& data, ios_base::openmode mode = ios_base::app) {
+    ofstream ofs(logfile, ios_base::out | mode);
+    ofs << data;
+  }
+
+  void SetUp() {
+    remove(logfile.c_str());
+    remove(indexfile.c_str());
+  }
+  void TearDown() {
+    remove(logfile.c_str());
+    remove(indexfile.c_str());
+  }
+};
+
+TEST_F(SELIndexTest, Summaries) {
+  write(line1 + line2 + "garbage\n" + line3 + line4);
+  SELIndex index(logfile, indexfile);
+  index.update();
+
+  const auto& e = index.entries();
+  ASSERT_EQ(e.size(), 5);
+  EXPECT_EQ(e[0].offset, 0);
+  EXPECT_EQ(e[1].offset, line1.size());
+  EXPECT_EQ(e[0].summary.fru, SELSummary::FRU_NONE);
+  EXPECT_EQ(e[1].summary.fru, 1);
+  EXPECT_EQ(e[2].summary.flags, 0);
+  EXPECT_EQ(e[3].summary.fru, 2);
+  EXPECT_EQ(e[3].summary.flags, SELSummary::VALID | SELSummary::TIMED);
+  EXPECT_EQ(
+      e[4].summary.flags,
+      SELSummary::VALID | SELSummary::BARE | SELSummary::TIMED);
+
+  int64_t t;
+  ASSERT_TRUE(SELFormat::parse_time("2020-05-18 10:18:40", t));
+  EXPECT_EQ(e[0].summary.time, t);
+  EXPECT_TRUE(e[0].summary.fru_matches({SELFormat::FRU_SYS}, SELFormat::FRU_SYS));
+  EXPECT_FALSE(e[0].summary.fru_matches({2}, SELFormat::FRU_ALL));
+  EXPECT_TRUE(e[3].summary.fru_matches({2}, SELFormat::FRU_ALL));
+
+  string line;
+  uint64_t next;
+  ASSERT_TRUE(index.read_line(e[3].offset, line, next));
+  EXPECT_EQ(line + "\n", line3);
+  EXPECT_EQ(next, e[4].offset);
+}
+
+TEST_F(SELIndexTest, Incremental) {
+  write(line1 + line2);
+  {
+    SELIndex index(logfile, indexfile);
+    index.update();
+    EXPECT_EQ(index.entries().size(), 2);
+    EXPECT_EQ(index.indexed_size(), line1.size() + line2.size());
+  }
+
+  // A line being written is not indexed, but can be read.
+  write(line3 + "2020 May 21 17:29:55 log-u");
+  {
+    SELIndex index(logfile, indexfile);
+    index.update();
+    EXPECT_EQ(index.entries().size(), 3);
+    EXPECT_EQ(index.entries()[2].offset, line1.size() + line2.size());
+    string line;
+    uint64_t next;
+    ASSERT_TRUE(index.read_line(index.indexed_size(), line, next));
+    EXPECT_EQ(line, "2020 May 21 17:29:55 log-u");
+    EXPECT_FALSE(index.read_line(next, line, next));
+  }
+
+  write("til: User cleared FRU: 2 logs\n");
+  {
+    SELIndex index(logfile, indexfile);
+    index.update();
+    ASSERT_EQ(index.entries().size(), 4);
+    EXPECT_EQ(index.entries()[3].summary.fru, 2);
+  }
+}
+
+TEST_F(SELIndexTest, Rewritten) {
+  write(line1 + line2 + line3);
+  {
+    SELIndex index(logfile, indexfile);
+    index.update();
+    EXPECT_EQ(index.entries().size(), 3);
+  }
+
+  // Truncated in place and written again past the indexed size.
+  write(line4 + line3 + line1 + line2, ios_base::trunc);
+  SELIndex index(logfile, indexfile);
+  index.update();
+  const auto& e = index.entries();
+  ASSERT_EQ(e.size(), 4);
+  EXPECT_EQ(e[0].summary.flags & SELSummary::BARE, SELSummary::BARE);
+  EXPECT_EQ(e[3].summary.fru, 1);
+}
+
+TEST_F(SELIndexTest, Stream) {
+  write(line1 + line2 + line3 + line4);
+  SELIndex index(logfile, indexfile);
+  index.update();
+  write(line3);
+
+  MockSELStream stream(FORMAT_PRINT);
+  auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+  // Only the lines of FRU 2 are parsed.
+  EXPECT_CALL(*sel, get_fru_name(2))
+      .Times(3)
+      .WillRepeatedly(Return(string("nic")));
+  EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(sel))));
+
+  stringstream outp;
+  stream.start(index, outp, {2}, "", "");
+  stream.flush(outp);
+
+  stringstream exp;
+  exp << "2    nic      2020-05-18 10:18:38    ncsid            FRU: 2 NIC AEN Supported: 0x7, AEN Enable Mask=0x7\n";
+  exp << "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+  exp << "2    nic      2020-05-18 10:18:38    ncsid            FRU: 2 NIC AEN Supported: 0x7, AEN Enable Mask=0x7\n";
+  EXPECT_EQ(outp.str(), exp.str());
+}
+
+TEST_F(SELIndexTest, StreamPage) {
+  write(line1 + line2 + line3 + line4);
+  SELIndex index(logfile, indexfile);
+  index.update();
+  write(line3);
+
+  MockSELStream stream(FORMAT_PRINT);
+  stream.set_page({2, 2});
+  auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+  // The appended line has to be parsed to be skipped, the indexed one
+  // before the page is skipped without.
+  EXPECT_CALL(*sel, get_fru_name(2))
+      .Times(2)
+      .WillRepeatedly(Return(string("nic")));
+  EXPECT_CALL(*sel, get_fru_name(1))
+      .Times(1)
+      .WillOnce(Return(string("mb")));
+  EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(sel))));
+
+  stringstream outp;
+  stream.start(index, outp, {SELFormat::FRU_ALL}, "", "");
+  stream.flush(outp);
+
+  stringstream exp;
+  exp << "2    nic      2020-05-18 10:18:38    ncsid            FRU: 2 NIC AEN Supported: 0x7, AEN Enable Mask=0x7\n";
+  exp << "1    mb       2020-04-06 15:00:40    sensord          ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH\n";
+  EXPECT_EQ(outp.str(), exp.str());
+}
@@ -187,3 +187,41 @@ TEST(SELStream, ClearFru) {
   exp << "2020 Jun 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
   ASSERT_EQ(outp.str(), exp.str());
 }
+
+TEST(SELStream, EmptyJSON) {
+  MockSELStream stream(FORMAT_JSON);
+  stringstream outp;
+  stream.flush(outp);
+  EXPECT_EQ(outp.str(), "{\n    \"Logs\": []\n}\n");
+}
+
+TEST(SELStream, PageNewestFirst) {
+  stringstream inp;
+
+  inp << " 2020 May 18 10:18:40 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: healthd: BMC Reboot detected - caused by reboot command\n";
+  inp << " 2020 Apr  6 15:00:40 bmc-oob. user.crit fbtp-v2020.09.1: sensord: ASSERT: Upper Non Critical threshold - raised - FRU: 1, num: 0xC0 curr_val: 8988.00 RPM, thresh_val: 8500.00 RPM, snr: MB_FAN0_TACH\n";
+  inp << " 2020 May 18 10:18:38 bmc-oob. user.crit fbtp-9b6bf3961d-dirty: ncsid: FRU: 2 NIC AEN Supported: 0x7, AEN Enable Mask=0x7\n";
+  inp << "2020 May 21 17:29:55 log-util: User cleared FRU: 2 logs\n";
+  MockSELStream stream(FORMAT_JSON);
+  stream.set_page({1, 2});
+
+  auto sel = std::make_unique<MockSELFormat>(SELFormat::FRU_ALL);
+  EXPECT_CALL(*sel, get_fru_name(AnyOf(1, 2)))
+      .Times(3)
+      .WillOnce(Return(string("nic")))
+      .WillOnce(Return(string("nic")))
+      .WillOnce(Return(string("mb")));
+  EXPECT_CALL(stream, make_sel(SELFormat::FRU_ALL))
+      .Times(1)
+      .WillOnce(Return(ByMove(std::move(sel))));
+  stringstream outp;
+  stream.start(inp, outp, {SELFormat::FRU_ALL}, "", "");
+  EXPECT_TRUE(stream.done());
+  stream.flush(outp);
+
+  // The clear log is not a JSON record, the page skips the ncsid one.
+  nlohmann::json got = nlohmann::json::parse(outp.str());
+  ASSERT_EQ(got["Logs"].size(), 2);
+  EXPECT_EQ(got["Logs"][0]["APP_NAME"], "sensord");
+  EXPECT_EQ(got["Logs"][1]["APP_NAME"], "healthd");
+}
@@ -12,9 +12,14 @@
 #include <sys/un.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <fcntl.h>
 #include "CLI/CLI.hpp"
+#include <chrono>
+#include <deque>
+#include <map>
 #include <sstream>
+#include <vector>
 
 #include <libmctp.h>
 #include <libmctp-smbus.h>
@@ -29,6 +34,12 @@
 
 #define HJ_POLLING_INTERVAL_SEC 2
 
+#define TX_RETRIES_MAX     3
+#define TX_RETRY_DELAY_MS  30
+#define TX_QUEUE_MAX       64   // messages waiting per destination eid
+
+using namespace std::chrono;
+
 // MCTP Interface
 enum {
   MCTP_SMBUS = 0x1  // MCTP SMBUS
@@ -37,6 +48,7 @@ enum {
 bool verbose = false;
 static const mctp_eid_t local_eid_default = 8;
 static char sockname[] = "mctp-mux";
+static char stats_sockname[] = "mctp-stats";
 
 struct i3c_data {
   struct mctp_binding_asti3c *asti3c;
@@ -61,6 +73,26 @@ struct client {
   int msg_tag;
 };
 
+struct tx_msg {
+  std::vector<uint8_t> buf;  // dest eid + MCTP message
+  bool tag_owner;
+  uint8_t tag;
+  int retries;
+};
+
+/*
+ * Messages to a destination eid, sent in order. When sending fails, the
+ * message is tried again after TX_RETRY_DELAY_MS, by the retry timer,
+ * while the messages to the other eids go on.
+ */
+struct tx_queue {
+  std::deque<struct tx_msg> msgs;
+  steady_clock::time_point retry_at;
+  uint64_t sent;
+  uint64_t retries;
+  uint64_t drops;
+};
+
 struct ctx {
   struct mctp *mctp;
   struct binding *binding;
@@ -78,6 +110,11 @@ struct ctx {
   bool sock_err;
   std::string bus;
   int hj_fd;
+
+  std::map<uint8_t, struct tx_queue> tx_queues;
+  uint8_t tx_last_eid;  // endpoints are served in turn, from the one after
+  int timer_fd;
+  int stats_sock;
 };
 
 
@@ -249,6 +286,132 @@ static void rx_message(uint8_t eid, void *data, void *msg, size_t len, bool tag_
   }
 }
 
+// Give up a message, a PLDM requester is answered at once with an error.
+static void tx_drop(struct ctx *ctx, struct tx_queue *queue, struct tx_msg *msg)
+{
+  static constexpr uint8_t OFFSET_TYPE = 1;       // Msg Type
+  static constexpr uint8_t OFFSET_IID = 2;        // Instance ID
+  static constexpr uint8_t OFFSET_COMP = 5;       // PLDM Completion Code
+  static constexpr uint8_t PLDM_COMP_ERR = 0x01;
+  std::vector<uint8_t> &buf = msg->buf;
+
+  queue->drops++;
+  fprintf(stderr, "%s: message to eid %d dropped, %llu so far\n",
+          __func__, buf[0], (unsigned long long)queue->drops);
+
+  if (buf.size() > OFFSET_TYPE && buf[OFFSET_TYPE] == MSG_TYPE_PLDM && msg->tag_owner) {
+    // send back a response with PLDM error completion code to avoid
+    // PLDM requester being blocked until timeout
+    if (buf.size() <= OFFSET_COMP)
+      buf.resize(OFFSET_COMP + 1);
+    buf[OFFSET_IID] &= 0x7F;  // mark as response
+    buf[OFFSET_COMP] = PLDM_COMP_ERR;
+    rx_message(buf[0], ctx, &buf[1], OFFSET_COMP, 0, 0, NULL);
+  }
+}
+
+static void tx_arm_timer(struct ctx *ctx, steady_clock::time_point when)
+{
+  struct itimerspec its;
+
+  memset(&its, 0, sizeof(its));
+  if (when != steady_clock::time_point::max()) {
+    // it_value of 0 would disarm the timer
+    long long ns = std::max<long long>(
+        duration_cast<nanoseconds>(when - steady_clock::now()).count(), 1);
+    its.it_value.tv_sec = ns / 1000000000;
+    its.it_value.tv_nsec = ns % 1000000000;
+  }
+  timerfd_settime(ctx->timer_fd, 0, &its, NULL);
+}
+
+/*
+ * Send the first message of every endpoint ready for it, starting after the
+ * endpoint served last, so a busy or unresponsive endpoint doesn't hold up
+ * the others. One message per endpoint at a time, the retry timer is armed
+ * for the rest.
+ */
+static void tx_process(struct ctx *ctx)
+{
+  auto now = steady_clock::now();
+  auto next = steady_clock::time_point::max();
+  auto it = ctx->tx_queues.upper_bound(ctx->tx_last_eid);
+
+  for (size_t n = ctx->tx_queues.size(); n > 0; n--, ++it) {
+    if (it == ctx->tx_queues.end())
+      it = ctx->tx_queues.begin();
+
+    struct tx_queue *queue = &it->second;
+    if (queue->msgs.empty())
+      continue;
+
+    if (queue->retry_at <= now) {
+      struct tx_msg *msg = &queue->msgs.front();
+      ctx->tx_last_eid = it->first;
+
+      if (tx_message(ctx, it->first, &msg->buf[1], msg->buf.size() - 1,
+                     msg->tag_owner, msg->tag) == 0) {
+        queue->sent++;
+        queue->msgs.pop_front();
+      } else if (++msg->retries > TX_RETRIES_MAX) {
+        tx_drop(ctx, queue, msg);
+        queue->msgs.pop_front();
+      } else {
+        queue->retries++;
+        queue->retry_at = now + milliseconds(TX_RETRY_DELAY_MS);
+      }
+      if (queue->msgs.empty())
+        continue;
+    }
+    next = std::min(next, std::max(queue->retry_at, now));
+  }
+
+  tx_arm_timer(ctx, next);
+}
+
+static void tx_enqueue(struct ctx *ctx, uint8_t *buf, size_t len, bool tag_owner, uint8_t tag)
+{
+  struct tx_queue *queue = &ctx->tx_queues[buf[0]];
+  struct tx_msg msg = {std::vector<uint8_t>(buf, buf + len), tag_owner, tag, 0};
+
+  if (queue->msgs.size() >= TX_QUEUE_MAX) {
+    tx_drop(ctx, queue, &msg);
+    return;
+  }
+  queue->msgs.push_back(std::move(msg));
+  tx_process(ctx);
+}
+
+static void timer_process(struct ctx *ctx)
+{
+  uint64_t expirations;
+
+  if (read(ctx->timer_fd, &expirations, sizeof(expirations)) < 0)
+    return;
+  tx_process(ctx);
+}
+
+static void stats_process(struct ctx *ctx)
+{
+  std::ostringstream os;
+  int fd;
+
+  fd = accept4(ctx->stats_sock, NULL, 0, SOCK_NONBLOCK);
+  if (fd < 0)
+    return;
+
+  for (auto &it : ctx->tx_queues) {
+    os << "eid " << (int)it.first
+       << ": sent " << it.second.sent
+       << ", retries " << it.second.retries
+       << ", drops " << it.second.drops
+       << ", queued " << it.second.msgs.size() << "\n";
+  }
+  std::string stats = os.str();
+  send(fd, stats.data(), stats.size(), MSG_NOSIGNAL);
+  close(fd);
+}
+
 static int binding_asti3c_init (struct mctp *mctp, struct binding *binding,
                               mctp_eid_t eid, int n_params,
                               char *const *params __attribute__((unused)))
@@ -433,42 +596,56 @@ struct binding *binding_lookup(const char *name)
   return NULL;
 }
 
-static int socket_init(struct ctx *ctx, char *const *argv)
+static int socket_listen(const std::string &path)
 {
   struct sockaddr_un addr;
-  int namelen, rc;
-  std::string path = sockname + std::string(argv[0]);
+  int namelen, rc, sock;
 
   namelen = path.length();
   memcpy(addr.sun_path, "\0", 1);
   memcpy(addr.sun_path+1, path.c_str(), namelen++);
 
   addr.sun_family = AF_UNIX;
-  ctx->sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
-  if (ctx->sock < 0) {
+  sock = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if (sock < 0) {
     warn("can't create socket");
     return -1;
   }
 
-  rc = bind(ctx->sock, (struct sockaddr *)&addr, sizeof(addr.sun_family) + namelen);
+  rc = bind(sock, (struct sockaddr *)&addr, sizeof(addr.sun_family) + namelen);
   if (rc) {
     warn("can't bind socket");
     goto err_close;
   }
 
-  rc = listen(ctx->sock, 1);
+  rc = listen(sock, 1);
   if (rc) {
     warn("can't listen on socket");
     goto err_close;
   }
 
-  return 0;
+  return sock;
 
 err_close:
-  close(ctx->sock);
+  close(sock);
   return -1;
 }
 
+static int socket_init(struct ctx *ctx, char *const *argv)
+{
+  ctx->sock = socket_listen(sockname + std::string(argv[0]));
+  if (ctx->sock < 0)
+    return -1;
+
+  ctx->stats_sock = socket_listen(stats_sockname + std::string(argv[0]));
+  if (ctx->stats_sock < 0) {
+    close(ctx->sock);
+    return -1;
+  }
+
+  return 0;
+}
+
 static int socket_process(struct ctx *ctx)
 {
   struct client *client;
@@ -576,30 +753,8 @@ static int client_process_recv(struct ctx *ctx, int idx)
     //Loop back Test
     rx_message(dest_eid, ctx, (uint8_t *)ctx->buf + 1, rc - 1, 0, 0, NULL);
   } else {
-    static constexpr int TX_RETRIES_MAX = 3;
-    static constexpr int TX_RETRY_DELAY = 30000;    // 30 ms
-    static constexpr uint8_t OFFSET_TYPE = 1;       // Msg Type
-    static constexpr uint8_t OFFSET_IID = 2;        // Instance ID
-    static constexpr uint8_t OFFSET_COMP = 5;       // PLDM Completion Code
-    static constexpr uint8_t PLDM_COMP_ERR = 0x01;
-    uint8_t *buf = (uint8_t *)ctx->buf;
-    int retry;
-
     tag_owner = get_mctp_tag_owner(ctx->buf);
-    for (retry = 0;
-         tx_message(ctx, dest_eid, &buf[1], rc - 1, tag_owner, client->msg_tag) < 0 &&
-         ++retry <= TX_RETRIES_MAX;) {
-      usleep(TX_RETRY_DELAY);
-    }
-    if (retry > TX_RETRIES_MAX) {
-      if (buf[OFFSET_TYPE] == MSG_TYPE_PLDM) {
-        // send back a response with PLDM error completion code to avoid
-        // PLDM requester being blocked until timeout
-        buf[OFFSET_IID] &= 0x7F;  // mark as response
-        buf[OFFSET_COMP] = PLDM_COMP_ERR;
-        rx_message(dest_eid, ctx, &buf[1], OFFSET_COMP, 0, 0, NULL);
-      }
-    }
+    tx_enqueue(ctx, (uint8_t *)ctx->buf, rc, tag_owner, client->msg_tag);
   }
   return 0;
 
@@ -627,6 +782,8 @@ static int binding_init(struct ctx *ctx, const char *name, int argc, char *const
 enum {
   FD_BINDING = 0,
   FD_SOCKET,
+  FD_TIMER,
+  FD_STATS,
   FD_NR,
 };
 
@@ -649,6 +806,12 @@ static int run_daemon(struct ctx *ctx)
   ctx->pollfds[FD_SOCKET].fd = ctx->sock;
   ctx->pollfds[FD_SOCKET].events = POLLIN;
 
+  ctx->pollfds[FD_TIMER].fd = ctx->timer_fd;
+  ctx->pollfds[FD_TIMER].events = POLLIN;
+
+  ctx->pollfds[FD_STATS].fd = ctx->stats_sock;
+  ctx->pollfds[FD_STATS].events = POLLIN;
+
   mctp_set_rx_all(ctx->mctp, rx_message, ctx);
 
   for (;;) {
@@ -684,6 +847,12 @@ static int run_daemon(struct ctx *ctx)
       }
     }
 
+    if (ctx->pollfds[FD_TIMER].revents)
+      timer_process(ctx);
+
+    if (ctx->pollfds[FD_STATS].revents)
+      stats_process(ctx);
+
     for (i = 0; i < ctx->n_clients; i++) {
       if (!ctx->pollfds[FD_NR + i].revents)
         continue;
@@ -792,6 +961,13 @@ int main(int argc, char *const *argv)
   ctx->mctp = mctp_init();
   assert(ctx->mctp);
   ctx->hj_fd = -1;
+  ctx->tx_last_eid = 0;
+  ctx->stats_sock = -1;
+  ctx->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (ctx->timer_fd < 0) {
+    fprintf(stderr, "can't create retry timer\n");
+    return EXIT_FAILURE;
+  }
   while (1) {
     rc = binding_init(ctx, argv[optind], argc - optind - 1,  argv + optind + 1);
     if (!rc) {
@@ -7,62 +7,56 @@
 #include <sys/socket.h>
 #include <glog/logging.h>
 #include <iomanip>
+#include <cerrno>
 
 using namespace std;
 
 int
-fd_handler::polling() {
-  size_t fd_count = get_count(tx_server_fds, server_fds, client_fds);
-  return do_polling(fd_count);
-};
+fd_handler::polling (int timeout_ms)
+{
+  int returnCode = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+  if (returnCode < 0 && errno != EINTR) {
+    LOG(ERROR) << "Failed to wait for fds, RC = " << returnCode
+               << ", -errno = " << -errno;
+  }
+  return returnCode;
+}
 
 void
-fd_handler::update_pollfds() {
-
-  if (!client_change)
-    return;
-
-  size_t index;
-  size_t fd_count = get_count(tx_server_fds, server_fds, client_fds);
-
-  void* result = realloc(pollfds, fd_count * sizeof(struct pollfd));
-  if (result == NULL)
-    return;
-  else
-    pollfds = (struct pollfd*)result;
-
-  index = get_count(tx_server_fds, server_fds);
-  for (auto& fd : client_fds) {
-    pollfds[index].fd = fd;
-    pollfds[index].events = POLLIN;
-    ++index;
+fd_handler::init_epoll ()
+{
+  epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    LOG(ERROR) << "Failed to create epoll fd, RC = " << -errno;
+    exit(EXIT_FAILURE);
   }
+}
 
-  client_change = false;
-};
-
-int
-fd_handler::check_pollfds (int index)
+void
+fd_handler::add_fd (int fd)
 {
-  struct pollfd* pfd = get_pollfd(index);
-  if (pfd->revents)
-    return pfd->fd;
-  else
-    return 0;
+  struct epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    LOG(ERROR) << "Failed to monitor fd = " << fd << ", RC = " << -errno;
+  }
 }
 
-struct pollfd* fd_handler::get_pollfd (int index) {
-  return pollfds + index;
+void
+fd_handler::remove_fd (int fd)
+{
+  epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
 }
 
 int fd_handler::send_data (int fd, uint8_t * buf, size_t size)
 {
-  return send (fd, buf, size, 0);
+  // don't get killed by SIGPIPE when a client has gone away
+  return send (fd, buf, size, MSG_NOSIGNAL);
 }
 
-int fd_handler::recv_data (int fd, uint8_t **buf, size_t &size)
+ssize_t fd_handler::peek_size (int fd)
 {
-  int returnCode = 0;
   ssize_t peekedLength = recv(fd, nullptr, 0, MSG_PEEK | MSG_TRUNC);
 
   // stream socket peer has performed an orderly shutdown.
@@ -70,7 +64,7 @@ int fd_handler::recv_data (int fd, uint8_t **buf, size_t &size)
     return -1;
 
   if (peekedLength < 0) {
-    if (errno != ECONNRESET) {
+    if (errno != ECONNRESET && errno != EAGAIN) {
       LOG(ERROR) << "recv system call failed, RC = "
                 << (int)peekedLength
                 << ", -errno = "
@@ -79,9 +73,21 @@ int fd_handler::recv_data (int fd, uint8_t **buf, size_t &size)
     return -errno;
   }
 
+  return peekedLength;
+}
+
+// Receive in a caller owned buffer, which only grows when needed.
+int fd_handler::recv_data (int fd, std::vector<uint8_t> &buf, size_t &size)
+{
+  int returnCode = 0;
+  ssize_t peekedLength = peek_size(fd);
+  if (peekedLength < 0)
+    return peekedLength;
+
   size = peekedLength;
-  *buf = (uint8_t *) malloc (size);
-  returnCode = recv(fd, *buf, size, 0);
+  if (buf.size() < size)
+    buf.resize(size);
+  returnCode = recv(fd, buf.data(), size, 0);
   if (returnCode < 0) {
     if (errno != ECONNRESET)
       LOG(ERROR) << "can't receive from client";
@@ -91,23 +97,6 @@ int fd_handler::recv_data (int fd, uint8_t **buf, size_t &size)
   return returnCode;
 }
 
-void fd_handler::add_client(int fd)
-{
-  add_element(client_fds, fd);
-  client_change = true;
-}
-
-void fd_handler::pop_client(int index)
-{
-  pop_element(client_fds, index);
-  client_change = true;
-}
-
-void
-fd_handler::init_tx_server_fd (int fd) {
-  tx_server_fds.push_back(fd);
-}
-
 /* init server socket for clients */
 void
 fd_handler::init_server_fd (int& fd, const std::string &path)
@@ -136,7 +125,7 @@ fd_handler::init_server_fd (int& fd, const std::string &path)
     exit(EXIT_FAILURE);
   }
 
-  if (listen(fd, 1))
+  if (listen(fd, SOMAXCONN))
   {
     returnCode = -errno;
     LOG(ERROR) << "Failed to listen the socket = " << path.c_str()
@@ -145,33 +134,5 @@ fd_handler::init_server_fd (int& fd, const std::string &path)
     exit(EXIT_FAILURE);
   }
 
-  server_fds.push_back(fd);
-}
-
-void
-fd_handler::init_pollfds ()
-{
-  // init poll fds to monitor all socket
-  size_t default_fd_counts = server_fds.size() + tx_server_fds.size();
-  pollfds = (struct pollfd*) malloc (default_fd_counts * sizeof(struct pollfd));
-
-  size_t index = 0;
-  for (size_t i = 0; i < tx_server_fds.size(); ++i, ++index) {
-    pollfds[index].fd = tx_server_fds[i];
-    pollfds[index].events = POLLIN;
-  }
-  for (size_t i = 0; i < server_fds.size(); ++i, ++index) {
-    pollfds[index].fd = server_fds[i];
-    pollfds[index].events = POLLIN;
-  }
-}
-
-int
-fd_handler::do_polling (size_t fd_count)
-{
-  int returnCode = poll(pollfds, fd_count, -1);
-  if (returnCode < 0) {
-    LOG(ERROR) << "Failed to poll fds, RC = " << returnCode;
-  }
-  return returnCode;
+  add_fd(fd);
 }
@@ -3,56 +3,33 @@
 #include <cstdint>
 #include <vector>
 #include <string>
-#include <sys/poll.h>
-#include "vector_handler.hpp"
+#include <sys/types.h>
+#include <sys/epoll.h>
 
 class fd_handler
 {
   public:
-    // pollfds handle
-    int  polling();
-    void update_pollfds();
-
-    int check_pollfds(int index); // check pollfd if event happen return fd, else return 0
-    struct pollfd* get_pollfd(int index);
+    // epoll handle, returns number of ready fds (or -1)
+    int  polling(int timeout_ms = -1);
+    int  get_event_fd(int index) { return events[index].data.fd; }
 
     // send and recv
     int send_data(int fd, uint8_t * buf, size_t size);
-    int recv_data(int fd, uint8_t ** buf, size_t &size);
-
-    // client handle
-    void add_client(int fd);
-    void pop_client(int index);
-    int get_client_count(){ return get_count(client_fds); };
-
+    int recv_data(int fd, std::vector<uint8_t> &buf, size_t &size);
 
   protected:
     /*
-     * pollfds =
-     *   {
-     *     tx server fd,
-     *         .
-     *         .
-     *     server fd,
-     *         .
-     *         .
-     *     client fd,
-     *         .
-     *         .
-     *   }
+     * All sockets (mctpd, servers and clients) are in one epoll set,
+     * events are dispatched by fd, so nothing is rebuilt when clients
+     * come and go.
      */
-    std::vector<int> tx_server_fds = {};
-    std::vector<int> server_fds = {};
-    std::vector<int> client_fds = {};
-    struct pollfd *pollfds = nullptr;
-
-    // flag for whether pollfds need to updated
-    bool client_change = false;
+    int epoll_fd = -1;
+    std::vector<struct epoll_event> events = std::vector<struct epoll_event>(16);
 
-    void init_tx_server_fd(int fd);
+    void init_epoll();
+    void add_fd(int fd);
+    void remove_fd(int fd);
     void init_server_fd(int& fd, const std::string& path);
-    void init_pollfds();
 
-    int  do_polling(size_t fd_count);
-    // void do_update_pollfd(size_t fd_count);
+    ssize_t peek_size(int fd);
 };
@@ -1,143 +1,141 @@
 #include "pldm_fd_handler.hpp"
 
 #include <algorithm>
+#include <sstream>
 #include <stdio.h>
 #include <unistd.h>
 #include <libpldm/base.h>
 #include <libpldm-oem/pldm.h>
 #include <glog/logging.h>
 
+using namespace std::chrono;
+
+// Same as the receive timeout of the clients, no response is expected after.
+const seconds INSTANCE_ID_EXPIRY(10);
+
 int
 pldm_fd_handler::polling()
 {
-  size_t fd_count = get_count(tx_server_fds, server_fds, clients_data);
-  return do_polling(fd_count);
+  // Only wake up periodically while responses are outstanding.
+  return fd_handler::polling(inflight_count ? 1000 : -1);
 };
 
 void
-pldm_fd_handler::update_pollfds()
+pldm_fd_handler::expire_instance_ids()
 {
-  if (!client_change)
+  if (inflight_count == 0)
     return;
 
-  std::vector<pldm_client> tmp_clients_data = {};
-  for (auto&client:clients_data) {
-    if (client.active == true)
-      tmp_clients_data.push_back(client);
-    else {
-      close(client.fd);
-      ids.markFree(client.instance_id);
-      if (client.client_type == UPDATE_CLIENT) {
-        fw_update_client = 0;
-        is_fw_update_active = false;
-      }
+  auto now = steady_clock::now();
+  for (size_t iid = 0; iid < inflight.size(); ++iid) {
+    auto& req = inflight[iid];
+    if (req.client_id != 0 && now - req.sent > INSTANCE_ID_EXPIRY) {
+      DLOG(INFO) << "instance id = " << iid << " expired.";
+      req.client_id = 0;
+      ids.markFree(iid);
+      --inflight_count;
+      ++expired_count;
     }
   }
-  clients_data = tmp_clients_data;
-
-  size_t index;
-  size_t fd_count = get_count(tx_server_fds, server_fds, clients_data);
-  DLOG(INFO) << "update_pollfds : fd_count = " << (int)fd_count;
-
-  void* result = realloc(pollfds, fd_count * sizeof(struct pollfd));
-  if( result == NULL )
-    return;
-  else
-    pollfds = (struct pollfd*)result;
-
-
-  index = get_count(tx_server_fds, server_fds);
-  for (auto& data : clients_data) {
-    pollfds[index].fd = data.fd;
-    pollfds[index].events = POLLIN;
-    ++index;
-  }
-  client_change = false;
 }
 
 bool
 pldm_fd_handler::add_client(int fd, uint8_t type)
 {
-  if (type == UPDATE_CLIENT && is_fw_update_active) {
-    LOG(INFO) << "fw update on going...";
-    return false;
-  }
-
-  int iid = ids.next();
-  if (iid < 0) {
-    LOG(INFO) << "add client fail. run out of instance id.";
-    return false;
-  }
-
   pldm_client data = {
     fd,
-    (uint8_t)iid,
     type,
-    true,
+    ++last_client_id,
   };
 
-  add_element(clients_data, data);
-  client_change = true;
+  clients[fd] = data;
+  add_fd(fd);
   if (type == UPDATE_CLIENT) {
-    fw_update_client = fd;
-    is_fw_update_active = true;
     LOG(INFO) << "Add client UPDATE_CLIENT successflly.";
   }
 
   return true;
 }
 
+// Responses to the requests of the client are dropped when they come.
 void
-pldm_fd_handler::pop_client(int index)
-{
-  // pop_element(clients_data, index);
-  // if (clients_data[index].type == FWUPDATE_CLIENT)
-  //   is_fw_update_active = false;
-  clients_data[index].active = false;
-  client_change = true;
-}
-
-void
-pldm_fd_handler::do_pop_client(int index)
+pldm_fd_handler::pop_client(int fd)
 {
-  pop_element(clients_data, index);
-  // client_change = true;
-}
-
-int
-pldm_fd_handler::get_client_fd(uint8_t iid)
-{
-  auto it = find_if(clients_data.begin(), clients_data.end(),
-    pldm_client_finder(iid));
+  auto it = clients.find(fd);
+  if (it == clients.end())
+    return;
 
-  if (it != clients_data.end())
-    return it->fd;
-  else
-    return -1;
+  if (it->second.client_type == UPDATE_CLIENT) {
+    for (auto eid = fw_update_clients.begin(); eid != fw_update_clients.end();) {
+      if (eid->second == fd) {
+        LOG(INFO) << "fw update of eid = " << (int)eid->first << " ended.";
+        eid = fw_update_clients.erase(eid);
+      } else {
+        ++eid;
+      }
+    }
+  }
+  clients.erase(it);
+  remove_fd(fd);
+  close(fd);
 }
 
 void
 pldm_fd_handler::show_clients()
 {
-  int index = 0;
-
-  for (auto&c:clients_data) {
-    DLOG(INFO) << "client[" << index++ << "]:";
-    DLOG(INFO) << "instance id : " << std::hex << c.instance_id;
-    DLOG(INFO) << "client type : " << std::hex << c.client_type;
-    DLOG(INFO) << "fd          : " << c.fd;
+  for (auto&c:clients) {
+    DLOG(INFO) << "client id   : " << c.second.id;
+    DLOG(INFO) << "client type : " << (int)c.second.client_type;
+    DLOG(INFO) << "fd          : " << c.first;
   }
 }
 
+std::string
+pldm_fd_handler::stats() const
+{
+  std::ostringstream os;
+  os << "Clients               : " << clients.size()
+     << "\nInstance ids in use   : " << inflight_count
+     << " (of " << inflight.size() << ")"
+     << "\nInstance ids expired  : " << expired_count
+     << "\nFirmware updates      : " << fw_update_clients.size()
+     << "\n";
+  return os.str();
+}
+
 int
-pldm_fd_handler::client_send_data(int index, uint8_t *buf, size_t size)
+pldm_fd_handler::client_send_data(int fd, uint8_t *buf, size_t size)
 {
   auto msg = reinterpret_cast<pldm_msg*>(buf+PLDMD_MSG_HDR_LEN);
 
   // If message is request, then assign instance id.
   if (msg->hdr.request == PLDM_REQUEST ||
       msg->hdr.request == PLDM_ASYNC_REQUEST_NOTIFY) {
-    msg->hdr.instance_id = clients_data[index].instance_id;
+    if (clients[fd].client_type == UPDATE_CLIENT) {
+      auto owner = fw_update_clients.emplace(buf[0], fd).first;
+      if (owner->second != fd) {
+        LOG(INFO) << "fw update of eid = " << (int)buf[0] << " on going...";
+        return ERR_EID_BUSY;
+      }
+    }
+
+    int iid = ids.next();
+    if (iid < 0) {
+      expire_instance_ids();
+      iid = ids.next();
+    }
+    if (iid < 0) {
+      LOG(WARNING) << "run out of instance id.";
+      return ERR_NO_INSTANCE_ID;
+    }
+
+    auto& req = inflight[iid];
+    req.client_id = clients[fd].id;
+    req.fd = fd;
+    req.client_iid = msg->hdr.instance_id;
+    req.sent = steady_clock::now();
+    ++inflight_count;
+    msg->hdr.instance_id = iid;
   }
 
   DLOG(INFO) << "Forward to mctp daemon.";
@@ -147,80 +145,83 @@ pldm_fd_handler::client_send_data(int index, uint8_t *buf, size_t size)
 int
 pldm_fd_handler::send_fw_client_data(uint8_t * buf, size_t size)
 {
-  return fd_handler::send_data(fw_update_client, buf, size);
+  auto it = fw_update_clients.find(buf[0]);
+  if (it == fw_update_clients.end()) {
+    LOG(WARNING) << "no fw update of eid = " << (int)buf[0];
+    return -1;
+  }
+  return fd_handler::send_data(it->second, buf, size);
 }
 
 int
-pldm_fd_handler::recv_data(int fd, uint8_t** buf, size_t &size)
+pldm_fd_handler::send_client_resp(uint8_t * buf, size_t size)
 {
-  int returnCode = fd_handler::recv_data(fd, buf, size);
+  auto msg = reinterpret_cast<pldm_msg*>(buf+PLDMD_MSG_HDR_LEN);
+  uint8_t iid = msg->hdr.instance_id;
 
-  if (returnCode == 0) {
-    if (size < PLDM_HEADER_SIZE + PLDMD_MSG_HDR_LEN) {
-      LOG(INFO) << "recv pldm package length too short.";
-      returnCode = ERR_SIZE_TOO_SHORT;
-      return returnCode;
-    }
+  pldm_inflight req = inflight[iid];
+  if (req.client_id == 0) {
+    LOG(ERROR) << "no request with instance id = " << (int)iid;
+    return -1;
   }
+  inflight[iid].client_id = 0;
+  ids.markFree(iid);
+  --inflight_count;
 
-  return returnCode;
-}
+  auto it = clients.find(req.fd);
+  if (it == clients.end() || it->second.id != req.client_id) {
+    DLOG(INFO) << "client of instance id = " << (int)iid << " is gone.";
+    return -1;
+  }
 
-int
-pldm_fd_handler::check_mctpd_socket()
-{
-  int fd = check_pollfds(MCTP_FD);
-  DLOG_IF(INFO, fd) << "Receive data from mctpd.";
-  return fd;
+  // Send back to client with the instance id it sent.
+  DLOG(INFO) << "Forward to client iid = " << (int)iid;
+  msg->hdr.instance_id = req.client_iid;
+  return fd_handler::send_data(req.fd, buf, size);
 }
 
 int
-pldm_fd_handler::check_pldmd_socket()
+pldm_fd_handler::recv_data(int fd, std::vector<uint8_t> &buf, size_t &size)
 {
-  int fd = check_pollfds(SERV_FD);
-  DLOG_IF(INFO, fd) << "Receive new client's connection.";
-  return fd;
-}
+  int returnCode = fd_handler::recv_data(fd, buf, size);
 
-int
-pldm_fd_handler::check_pldmd_fwupdate_socket()
-{
-  int fd = check_pollfds(SERV_FWUP_FD);
-  LOG_IF(INFO, fd) << "Receive new fw-update client's connection.";
-  return fd;
-}
+  if (returnCode >= 0) {
+    if (size < PLDM_HEADER_SIZE + PLDMD_MSG_HDR_LEN) {
+      LOG(INFO) << "recv pldm package length too short.";
+      returnCode = ERR_SIZE_TOO_SHORT;
+    }
+  }
 
-int
-pldm_fd_handler::check_clients(int index)
-{
-  int pollfds_index = (int)get_count(tx_server_fds, server_fds) + index;
-  int fd = check_pollfds(pollfds_index);
-  DLOG(INFO) << "pollfds_index : " << pollfds_index;
-  DLOG_IF(INFO, fd) << "Receive data from client = " << index;
-  return fd;
+  return returnCode;
 }
 
 void
 pldm_fd_handler::do_init()
 {
-  // init tx server fd
-  init_tx_server_fd(mctpd_fd);
+  init_epoll();
+
+  // mctpd fd
+  add_fd(mctpd_fd);
 
   // init server fd
   std::string socketName;
-  socketName = "pldm-mux" + bus;
+  socketName = pldmd_socket + bus;
   init_server_fd(pldmd_fd, socketName);
   LOG(INFO) << "Create socket for clients = "
             << socketName.c_str()
             << " successfully.";
 
-  socketName = "pldm-fwup-mux" + bus;
+  socketName = pldmd_fwupdate_socket + bus;
   init_server_fd(pldmd_fwupdate_fd, socketName);
   LOG(INFO) << "Create socket for firmware update client = "
             << socketName.c_str()
             << " successfully.";
-  is_fw_update_active = false;
 
-  init_pollfds();
+  socketName = pldmd_stats_socket + bus;
+  init_server_fd(pldmd_stats_fd, socketName);
+  LOG(INFO) << "Create socket for stats client = "
+            << socketName.c_str()
+            << " successfully.";
+
   LOG(INFO) << "Create monitor for all socket successfully.";
 }
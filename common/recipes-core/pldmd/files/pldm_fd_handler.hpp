@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <unordered_map>
 #include "fd_handler.hpp"
 #include "instance_id.hpp"
 
@@ -10,31 +13,26 @@
 typedef struct pldm_client
 {
   int fd;
-  uint8_t instance_id;
   uint8_t client_type;
-  bool active;
+  uint64_t id;  // fds get reused by new clients, ids do not
 } pldm_client;
 
-typedef struct pldm_client_finder
+// A client request forwarded to mctpd, stored by the instance id it was
+// sent with, so the response goes back to that client with its own id.
+typedef struct pldm_inflight
 {
-  uint8_t iid;
-  explicit pldm_client_finder(uint8_t iid):iid(iid){}
-  bool operator() (const pldm_client& target) const { return target.instance_id==iid; }
-} pldm_client_finder;
+  uint64_t client_id;
+  int fd;
+  uint8_t client_iid;
+  std::chrono::steady_clock::time_point sent;
+} pldm_inflight;
 
 enum {
   PLDM_MSG_SUCCESS = 0,
   ERR_END_OF_FILE  = -1,
   ERR_SIZE_TOO_SHORT = -2,
-};
-
-enum
-{
-  MCTP_FD = 0,
-  SERV_FD,
-  SERV_FWUP_FD,
-  FIRST_CLIENT_INDEX,
-  DEFAULT_FD_NUM = FIRST_CLIENT_INDEX,
+  ERR_NO_INSTANCE_ID = -3,
+  ERR_EID_BUSY = -4,
 };
 
 enum {
@@ -49,46 +47,48 @@ class pldm_fd_handler : public fd_handler
     int mctpd_fd=0;
     int pldmd_fd=0;
     int pldmd_fwupdate_fd = 0;
+    int pldmd_stats_fd = 0;
 
     pldm_fd_handler(int mctpd_fd, const std::string &bus) :
     bus(bus), mctpd_fd(mctpd_fd) { do_init(); }
 
-    // pollfds handle
+    // wait for events, waking up to expire instance ids.
     int  polling();
-    void update_pollfds();
+    void expire_instance_ids();
 
     // send and recv
-    int client_send_data(int index, uint8_t * buf, size_t size);
+    int client_send_data(int fd, uint8_t * buf, size_t size);
     int send_fw_client_data(uint8_t * buf, size_t size);
-    // int send_data(int fd, uint8_t * buf, size_t buf_size);
-    int recv_data(int fd, uint8_t ** buf, size_t &size);
+    int send_client_resp(uint8_t * buf, size_t size);
+    int recv_data(int fd, std::vector<uint8_t> &buf, size_t &size);
 
     // client handle
     bool add_client(int fd, uint8_t type);
-    void pop_client(int index);
-    int get_client_fd(uint8_t iid);
-    int get_client_count(){ return get_count(clients_data); }
+    void pop_client(int fd);
+    bool is_client(int fd) { return clients.count(fd) != 0; }
+    int get_client_count(){ return clients.size(); }
     void show_clients();
-
-    // check sockets if there is an event then return fd else return 0
-    int check_mctpd_socket();
-    int check_pldmd_socket();
-    int check_pldmd_fwupdate_socket();
-    int check_clients(int index);
+    std::string stats() const;
 
   protected:
     // to distinguish client connect pldmd with
     // whether pldm-mux or pldm-fwup-mux
-    // replace fd_handler::client_fds
-    std::vector<pldm_client> clients_data = {};
-    // pldmd only support update one device at a time.
-    bool is_fw_update_active = false;
-    int fw_update_client = 0;
+    std::unordered_map<int, pldm_client> clients = {};
+    uint64_t last_client_id = 0;
+    // Each device is updated by one update client at a time, the first
+    // one sending it a request, until it disconnects.
+    std::unordered_map<uint8_t, int> fw_update_clients = {};  // eid -> fd
+
+    // instance ids are taken per request, not per client.
     pldm::InstanceId ids;
+    std::array<pldm_inflight, pldm::maxInstanceIds> inflight = {};
+    size_t inflight_count = 0;
+    uint64_t expired_count = 0;
+
     void do_init();
-    void do_pop_client(int index);
 
   private:
     const std::string pldmd_socket = "pldm-mux";
     const std::string pldmd_fwupdate_socket = "pldm-fwup-mux";
+    const std::string pldmd_stats_socket = "pldm-stats";
 };
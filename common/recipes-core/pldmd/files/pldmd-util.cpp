@@ -1,6 +1,10 @@
 #include <cstdio>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
 #include "CLI/CLI.hpp"
 
 #include <libpldm-oem/pldm.h>
@@ -131,6 +135,35 @@ static void do_get_effecter(uint8_t bus, int eid, std::vector<uint8_t>& payload)
   }
 }
 
+static void do_stats(uint8_t bus) {
+  std::string path = "pldm-stats" + std::to_string(bus);
+  int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+  if (fd < 0) {
+    std::cerr << "Failed to create the socket." << std::endl;
+    exit(1);
+  }
+
+  struct sockaddr_un addr;
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, "\0", 1);
+  memcpy(addr.sun_path+1, path.c_str(), path.length());
+  if (connect(fd, (struct sockaddr*)&addr,
+              sizeof(addr.sun_family)+path.length()+1) < 0) {
+    std::cerr << "Failed to connect to pldmd on bus " << int(bus) << std::endl;
+    close(fd);
+    exit(1);
+  }
+
+  char buf[1024];
+  ssize_t len = recv(fd, buf, sizeof(buf), 0);
+  close(fd);
+  if (len <= 0) {
+    std::cerr << "Failed to get stats." << std::endl;
+    exit(1);
+  }
+  std::cout << std::string(buf, len);
+}
+
 int main (int argc, char** argv)
 {
   // init CLI app
@@ -171,6 +204,11 @@ int main (int argc, char** argv)
   opt_get_effecterstat->add_option("data", data, "effector req value")->expected(2)->required();
   opt_get_effecterstat->callback([&]() {do_get_effecter(bus, eid, data);});
 
+  // <stats> option
+  optionDescription = "Show request queue depth and latency of pldmd";
+  auto opt_stats = app.add_subcommand("stats", optionDescription);
+  opt_stats->callback([&]() { do_stats(bus); });
+
   app.require_subcommand(/* min */ 1, /* max */ 1);
 
   // parse and execute
@@ -17,16 +17,15 @@
  */
 
 #include <iostream>
-#include <thread>
 #include <vector>
 #include <map>
 #include <string>
 #include <cstring>
+#include <cerrno>
 #include <unistd.h>
 #include <getopt.h>
 #include <sys/un.h>
 #include <sys/socket.h>
-#include <sys/poll.h>
 #include <sys/stat.h>
 #include "CLI/CLI.hpp"
 #include <glog/logging.h>
@@ -34,6 +33,7 @@
 #include <libpldm-oem/pldm.h>
 #include "instance_id.hpp"
 #include "pldm_fd_handler.hpp"
+#include "worker_pool.hpp"
 
 // #define PLDMD_MSG_HDR_LEN     2  // 2 bytes (eid + mctp message type)
 // #define PLDM_COMMON_REQ_LEN   3  // 3 bytes common field for PLDM requests
@@ -45,8 +45,11 @@
  * index 2   : pldm package
  */
 const uint8_t MCTP_MSG_TYPE_PLDM = 1;
+const size_t REQ_QUEUE_DEPTH = 64;
 bool verbose = false;
 pldm_fd_handler *handler;
+worker_pool *pool;
+uint8_t bus_id = 0;
 
 static int
 connect_to_socket (const char * path, int length)
@@ -104,33 +107,50 @@ freeBuf (uint8_t* buf)
   }
 }
 
-void req_msg_handle(int fd, uint8_t bus_id, std::vector<uint8_t> req, size_t req_size) {
-
+static void
+req_msg_handle (pldm_msg_buf* req)
+{
   uint8_t* resp = nullptr;
-  int resp_bytes;
+  int resp_bytes = 0;
 
   // handle PLDM msg
-  pldm_msg_handle(bus_id, req.data() + PLDMD_MSG_HDR_LEN, req_size - PLDMD_MSG_HDR_LEN, &resp, &resp_bytes);
+  pldm_msg_handle(bus_id, req->data.data() + PLDMD_MSG_HDR_LEN,
+                  req->size - PLDMD_MSG_HDR_LEN, &resp, &resp_bytes);
 
-  size_t buf_size = resp_bytes + PLDMD_MSG_HDR_LEN;
-  uint8_t* buf = new uint8_t [buf_size];
-
-  // copy response to buf(request)+PLDMD_MSG_HDR_LEN
+  // build response in the request buffer after PLDMD_MSG_HDR
   // so can re-use PLDMD_MSG_HDR
-  memcpy(buf, req.data(), PLDMD_MSG_HDR_LEN);
-  memcpy(buf + PLDMD_MSG_HDR_LEN, resp, resp_bytes);
+  req->size = resp_bytes + PLDMD_MSG_HDR_LEN;
+  if (req->data.size() < req->size)
+    req->data.resize(req->size);
+  if (resp_bytes > 0)
+    memcpy(req->data.data() + PLDMD_MSG_HDR_LEN, resp, resp_bytes);
 
   // send back to MCTP daemon
-  handler->send_data(fd, buf, resp_bytes + PLDMD_MSG_HDR_LEN);
+  handler->send_data(req->fd, req->data.data(), req->size);
 
   freeBuf(resp);
-  delete [] buf;
 }
 
+// Answer a request with ERROR_NOT_READY, so the requester retries later.
 static void
-mctpd_msg_handle (int fd, uint8_t *buf, size_t size)
+send_not_ready (int fd, const uint8_t* req)
 {
-  int rc = handler->recv_data(fd, &buf, size);
+  uint8_t buf[PLDMD_MSG_HDR_LEN + sizeof(pldm_msg_hdr) + 1];
+  memcpy(buf, req, PLDMD_MSG_HDR_LEN + sizeof(pldm_msg_hdr));
+
+  auto msg = reinterpret_cast<pldm_msg*>(buf + PLDMD_MSG_HDR_LEN);
+  msg->hdr.request = PLDM_RESPONSE;
+  msg->hdr.datagram = 0;
+  msg->payload[0] = PLDM_ERROR_NOT_READY;
+  handler->send_data(fd, buf, sizeof(buf));
+}
+
+static void
+mctpd_msg_handle (int fd)
+{
+  pldm_msg_buf* req = pool->get_buf();
+  size_t size = 0;
+  int rc = handler->recv_data(fd, req->data, size);
   DLOG(INFO) << "mctpd_msg_handle rc = " << rc;
 
   // MCTP daemon close socket, then PLDM daemon is useless
@@ -140,7 +160,8 @@ mctpd_msg_handle (int fd, uint8_t *buf, size_t size)
     exit(EXIT_FAILURE);
 
   // Handle message
-  } else {
+  } else if (rc >= 0) {
+    uint8_t* buf = req->data.data();
     auto msg = reinterpret_cast<pldm_msg*>(buf + PLDMD_MSG_HDR_LEN);
 
     // For firmware update socket
@@ -154,52 +175,46 @@ mctpd_msg_handle (int fd, uint8_t *buf, size_t size)
       msg->hdr.request == PLDM_ASYNC_REQUEST_NOTIFY) {
       DLOG(INFO) << "Request handle.";
 
-      uint8_t bus_id = std::stoi( handler->bus );
-      std::vector<uint8_t> req;
-
-      try {
-        req.insert(req.end(), &buf[0], &buf[size]);
-        std::thread msg_handle_thread(req_msg_handle, fd, bus_id, req, size);
-        msg_handle_thread.detach();
-      } catch (...) {
-        LOG(ERROR) << "Request handle error.";
-      }
+      req->fd = fd;
+      req->size = size;
+      if (pool->submit(req))
+        return;
+      LOG_EVERY_N(WARNING, 100) << "Request queue full, "
+                                << google::COUNTER << " requests dropped.";
+      send_not_ready(fd, buf);
 
     // For response handle
     } else if (msg->hdr.request == PLDM_RESPONSE) {
-
-      uint8_t iid = msg->hdr.instance_id;
-      int cfd = handler->get_client_fd(iid);
-      if (cfd < 0) {
-        LOG(ERROR) << "can't find client with instance id = " << (int)iid;
-      } else {
-        // Send back to client, so remove buf[0] & buf[1]
-        DLOG(INFO) << "Forward to client iid = " << (int)iid;
-        handler->send_data(cfd, buf, size);
-      }
+      handler->send_client_resp(buf, size);
     }
   }
-  freeBuf(buf);
+  pool->put_buf(req);
 }
 
 static void
-client_msg_handle (int fd, int index, uint8_t *buf, size_t size)
+client_msg_handle (int fd)
 {
-  int rc = handler->recv_data(fd, &buf, size);
+  // only used by the polling thread
+  static std::vector<uint8_t> buf;
+  size_t size = 0;
+  int rc = handler->recv_data(fd, buf, size);
+
+  // spurious wake up
+  if (rc == -EAGAIN)
+    return;
 
   // client disconnected.
   if (rc == ERR_END_OF_FILE) {
-    DLOG(INFO) << "client = " << index << " disconnect.";
-    freeBuf(buf);
-    handler->pop_client(index);
+    DLOG(INFO) << "client = " << fd << " disconnect.";
+    handler->pop_client(fd);
   // client message handle
   } else if (rc >= 0){
-    handler->client_send_data(index, buf, size);
-    freeBuf(buf);
-  } else {
-    handler->pop_client(index);
+    rc = handler->client_send_data(fd, buf.data(), size);
+    if (rc == ERR_NO_INSTANCE_ID || rc == ERR_EID_BUSY)
+      send_not_ready(fd, buf.data());
+  } else if (rc != ERR_SIZE_TOO_SHORT) {
+    handler->pop_client(fd);
   }
-
 }
 
 static void
@@ -216,44 +231,46 @@ new_client_handle(int fd, uint8_t type)
   }
 }
 
+static void
+stats_client_handle(int fd)
+{
+  int new_fd = accept4(fd, NULL, 0, SOCK_NONBLOCK);
+  if (new_fd < 0)
+    return;
+
+  std::string stats = pool->stats() + handler->stats();
+  handler->send_data(new_fd, (uint8_t*)stats.data(), stats.size());
+  close(new_fd);
+}
+
 static int
 run_daemon ()
 {
   LOG(INFO) << "Starting loop...";
-  int fd;
-  uint8_t* buf = nullptr;
-  size_t size = 0;
 
   for (;;) {
-
-    handler->update_pollfds();
-    handler->polling();
-
-    // check if there are messages from mctpd
-    fd = handler->check_mctpd_socket();
-    if (fd) {
-      mctpd_msg_handle(fd, buf, size);
-    }
-
-    // check if there are messages from connected clients
-    int client_count = handler->get_client_count();
-    for (int i = 0; i < client_count; ++i) {
-      fd = handler->check_clients(i);
-
-      if (fd) {
-        client_msg_handle(fd, i, buf, size);
+    int count = handler->polling();
+
+    for (int i = 0; i < count; ++i) {
+      int fd = handler->get_event_fd(i);
+
+      // messages from mctpd
+      if (fd == handler->mctpd_fd) {
+        mctpd_msg_handle(fd);
+      } else if (fd == handler->pldmd_fd) {
+        new_client_handle(fd, NORMAL_CLIENT);
+      } else if (fd == handler->pldmd_fwupdate_fd) {
+        LOG(INFO) << "Receive new fw-update client's connection.";
+        new_client_handle(fd, UPDATE_CLIENT);
+      } else if (fd == handler->pldmd_stats_fd) {
+        stats_client_handle(fd);
+      // messages from connected clients
+      } else if (handler->is_client(fd)) {
+        client_msg_handle(fd);
       }
     }
 
-    fd = handler->check_pldmd_socket();
-    if (fd) {
-      new_client_handle(fd, NORMAL_CLIENT);
-    }
-
-    fd = handler->check_pldmd_fwupdate_socket();
-    if (fd) {
-      new_client_handle(fd, UPDATE_CLIENT);
-    }
+    handler->expire_instance_ids();
   }
 }
 
@@ -266,6 +283,7 @@ class myFormatter : public CLI::Formatter
         cmd_table["--help"] = "";
         cmd_table["--bus"] = " <bus number>";
         cmd_table["--log"] = " <log level>";
+        cmd_table["--workers"] = " <count>";
         return cmd_table[str];
     }
 
@@ -303,6 +321,12 @@ int main (int argc, char** argv)
   option = app.add_option("-l, --log", level, optionDescription);
   option->check(CLI::Range(0, 3));
 
+  // request handling threads
+  size_t workers = 4;
+  optionDescription = "Setting number of request workers. (default = 4)";
+  option = app.add_option("-w, --workers", workers, optionDescription);
+  option->check(CLI::Range(1, 32));
+
   // parse and execute
   CLI11_PARSE(app, argc, argv);
 
@@ -328,6 +352,8 @@ int main (int argc, char** argv)
   LOG(INFO) << "Connected to mctpd_" << busNumber;
 
   // Init sock for pldm clients & run daemon
+  bus_id = std::stoi(busNumber);
+  pool = new worker_pool(workers, REQ_QUEUE_DEPTH, req_msg_handle);
   handler = new pldm_fd_handler(mctpfd, busNumber);
   if(run_daemon() < 0)
     exit(EXIT_FAILURE);
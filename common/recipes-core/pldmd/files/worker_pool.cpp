@@ -0,0 +1,125 @@
+#include "worker_pool.hpp"
+
+#include <sstream>
+#include <glog/logging.h>
+
+using namespace std::chrono;
+
+// Enough for most PLDM messages, larger ones grow their buffer once.
+const size_t DEFAULT_BUF_SIZE = 256;
+
+template <typename T>
+static void
+update_max(std::atomic<T>& max, T value)
+{
+  T cur = max.load(std::memory_order_relaxed);
+  while (value > cur &&
+         !max.compare_exchange_weak(cur, value, std::memory_order_relaxed));
+}
+
+worker_pool::worker_pool(size_t workers, size_t depth, handler_t handler) :
+handler(handler), queue(depth), bufs(depth + workers + 1), capacity(depth)
+{
+  for (auto& buf : bufs) {
+    buf.data.reserve(DEFAULT_BUF_SIZE);
+    put_buf(&buf);
+  }
+
+  sem_init(&pending, 0, 0);
+  for (size_t i = 0; i < workers; ++i)
+    threads.emplace_back(&worker_pool::run, this);
+  LOG(INFO) << "Started " << workers << " workers, queue depth = " << depth;
+}
+
+worker_pool::~worker_pool()
+{
+  stopping = true;
+  for (size_t i = 0; i < threads.size(); ++i)
+    sem_post(&pending);
+  for (auto& t : threads)
+    t.join();
+  sem_destroy(&pending);
+}
+
+pldm_msg_buf*
+worker_pool::get_buf()
+{
+  pldm_msg_buf* buf = free_bufs.load(std::memory_order_acquire);
+  while (buf != nullptr &&
+         !free_bufs.compare_exchange_weak(buf, buf->next,
+                                          std::memory_order_acquire));
+  return buf;
+}
+
+void
+worker_pool::put_buf(pldm_msg_buf* buf)
+{
+  buf->next = free_bufs.load(std::memory_order_relaxed);
+  while (!free_bufs.compare_exchange_weak(buf->next, buf,
+                                          std::memory_order_release));
+}
+
+bool
+worker_pool::submit(pldm_msg_buf* req)
+{
+  req->queued = steady_clock::now();
+  size_t cur = ++depth;
+  if (!queue.push(req)) {
+    --depth;
+    ++dropped;
+    return false;
+  }
+  update_max(max_depth, cur);
+  sem_post(&pending);
+  return true;
+}
+
+void
+worker_pool::run()
+{
+  for (;;) {
+    if (sem_wait(&pending) < 0)
+      continue;  // EINTR
+    if (stopping)
+      return;
+
+    // The request may still be being pushed by another thread.
+    pldm_msg_buf* req = nullptr;
+    while (!queue.pop(req))
+      std::this_thread::yield();
+    --depth;
+
+    auto start = steady_clock::now();
+    handler(req);
+    auto end = steady_clock::now();
+
+    uint64_t wait = duration_cast<microseconds>(start - req->queued).count();
+    uint64_t handle = duration_cast<microseconds>(end - start).count();
+    total_wait_us += wait;
+    update_max(max_wait_us, wait);
+    total_handle_us += handle;
+    update_max(max_handle_us, handle);
+    ++handled;
+
+    put_buf(req);
+  }
+}
+
+std::string
+worker_pool::stats() const
+{
+  uint64_t count = handled.load();
+  uint64_t avg_wait = count ? total_wait_us.load() / count : 0;
+  uint64_t avg_handle = count ? total_handle_us.load() / count : 0;
+  std::ostringstream os;
+
+  os << "Workers               : " << threads.size()
+     << "\nQueue depth           : " << depth.load()
+     << " (max " << max_depth.load() << ", capacity " << capacity << ")"
+     << "\nRequests handled      : " << count
+     << "\nRequests dropped      : " << dropped.load()
+     << "\nQueue wait (avg/max)  : " << avg_wait << "/" << max_wait_us.load() << " us"
+     << "\nHandle time (avg/max) : " << avg_handle << "/" << max_handle_us.load() << " us"
+     << "\n";
+  return os.str();
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <semaphore.h>
+
+/*
+ * A message received from mctpd.
+ * Requests keep their buffer until the response is sent, which is built
+ * in place after the PLDMD_MSG_HDR of the request.
+ */
+typedef struct pldm_msg_buf
+{
+  std::vector<uint8_t> data;
+  size_t size = 0;
+  int fd = -1;
+  std::chrono::steady_clock::time_point queued;
+  pldm_msg_buf* next = nullptr;
+} pldm_msg_buf;
+
+/*
+ * Bounded lock-free queue (D. Vyukov's array based queue).
+ * Any number of threads may push and pop, size must be a power of 2.
+ */
+template <typename T>
+class bounded_queue
+{
+  public:
+    explicit bounded_queue(size_t size) :
+    cells(new cell[size]), mask(size - 1)
+    {
+      for (size_t i = 0; i < size; ++i)
+        cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(T data)
+    {
+      size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+      for (;;) {
+        cell* c = &cells[pos & mask];
+        size_t seq = c->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+          if (enqueue_pos.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+            c->data = data;
+            c->seq.store(pos + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // full
+        } else {
+          pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+    bool pop(T& data)
+    {
+      size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+      for (;;) {
+        cell* c = &cells[pos & mask];
+        size_t seq = c->seq.load(std::memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+        if (diff == 0) {
+          if (dequeue_pos.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed)) {
+            data = c->data;
+            c->seq.store(pos + mask + 1, std::memory_order_release);
+            return true;
+          }
+        } else if (diff < 0) {
+          return false; // empty
+        } else {
+          pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+      }
+    }
+
+  private:
+    struct cell
+    {
+      std::atomic<size_t> seq;
+      T data;
+    };
+    std::unique_ptr<cell[]> cells;
+    const size_t mask;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+/*
+ * Fixed number of threads handling the PLDM requests from mctpd.
+ *
+ * The polling thread takes a buffer with get_buf(), receives a message in
+ * it and either submits it or gives it back with put_buf(). Workers give
+ * the buffers back once the request is handled. There are enough buffers
+ * for a full queue and all the workers, so get_buf() never fails.
+ */
+class worker_pool
+{
+  public:
+    typedef void (*handler_t)(pldm_msg_buf* req);
+
+    worker_pool(size_t workers, size_t depth, handler_t handler);
+    ~worker_pool();
+
+    pldm_msg_buf* get_buf();
+    void put_buf(pldm_msg_buf* buf);
+
+    // Queue a request. Returns false if the queue is full,
+    // then the buffer still belongs to the caller.
+    bool submit(pldm_msg_buf* req);
+
+    // Queue depth and latency counters, as text for pldmd-util.
+    std::string stats() const;
+
+  private:
+    handler_t handler;
+    bounded_queue<pldm_msg_buf*> queue;
+    sem_t pending;
+    std::atomic<bool> stopping{false};
+    std::vector<std::thread> threads;
+
+    // Popped by the polling thread only, so there is no ABA problem.
+    std::vector<pldm_msg_buf> bufs;
+    std::atomic<pldm_msg_buf*> free_bufs{nullptr};
+
+    const size_t capacity;
+    std::atomic<size_t> depth{0};
+    std::atomic<size_t> max_depth{0};
+    std::atomic<uint64_t> handled{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> total_wait_us{0};
+    std::atomic<uint64_t> max_wait_us{0};
+    std::atomic<uint64_t> total_handle_us{0};
+    std::atomic<uint64_t> max_handle_us{0};
+
+    void run();
+};
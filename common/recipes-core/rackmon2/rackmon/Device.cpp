@@ -1,8 +1,10 @@
 // Copyright 2021-present Facebook. All Rights Reserved.
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <unistd.h>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include "Log.h"
 
@@ -59,26 +61,25 @@ void Device::ioctl(unsigned long cmd, void* data) {
 }
 
 int Device::waitRead(int timeoutMs) {
-  fd_set fdset;
-  struct timeval timeout;
-  struct timeval* timeoutPtr = nullptr;
-  FD_ZERO(&fdset);
-  FD_SET(deviceFd_, &fdset);
-  if (timeoutMs > 0) {
-    timeout.tv_sec = timeoutMs / 1000;
-    timeout.tv_usec = (timeoutMs % 1000) * 1000;
-    timeoutPtr = &timeout;
-  }
-  int rc = select(deviceFd_ + 1, &fdset, nullptr, nullptr, timeoutPtr);
+  // poll() does not suffer from the FD_SETSIZE limits of select()
+  // and does not need the fd set to be rebuilt on every call.
+  struct pollfd pfd = {deviceFd_, POLLIN, 0};
+  auto start = std::chrono::steady_clock::now();
+  int rc = poll(&pfd, 1, timeoutMs > 0 ? timeoutMs : -1);
   if (rc == -1) {
-    throw std::system_error(
-        sys_error(), "select returned error for " + device_);
+    throw std::system_error(sys_error(), "poll returned error for " + device_);
   }
   if (rc == 0) {
     return 0;
   }
-  return timeoutMs > 0 ? (timeout.tv_sec * 1000) + (timeout.tv_usec / 1000)
-                       : -1;
+  if (timeoutMs <= 0) {
+    return -1;
+  }
+  int elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  // Do not return 0 (Timeout) when we did receive data.
+  return std::max(timeoutMs - elapsedMs, 1);
 }
 
 size_t Device::read(uint8_t* buf, size_t exactLen, int timeoutMs) {
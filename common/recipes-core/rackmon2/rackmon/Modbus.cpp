@@ -8,16 +8,117 @@ using nlohmann::json;
 
 namespace rackmon {
 
+namespace {
+// Adds the lifetime of the object to the provided counter.
+class BusyTimer {
+  std::atomic<uint64_t>& busyTimeUs_;
+  std::chrono::steady_clock::time_point start_ =
+      std::chrono::steady_clock::now();
+
+ public:
+  explicit BusyTimer(std::atomic<uint64_t>& busyTimeUs)
+      : busyTimeUs_(busyTimeUs) {}
+  ~BusyTimer() {
+    busyTimeUs_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start_)
+                       .count();
+  }
+};
+
+// Holds the bus for the lifetime of the object.
+class BusGrant {
+  BusArbiter& arbiter_;
+  const ModbusTime holdOff_;
+
+ public:
+  BusGrant(BusArbiter& arbiter, ModbusPriority prio, ModbusTime holdOff)
+      : arbiter_(arbiter), holdOff_(holdOff) {
+    arbiter_.acquire(prio);
+  }
+  ~BusGrant() {
+    arbiter_.release(holdOff_);
+  }
+};
+
+thread_local ModbusPriority currentPriority = ModbusPriority::BACKGROUND;
+} // namespace
+
+ModbusPriorityScope::ModbusPriorityScope(ModbusPriority prio)
+    : prev_(currentPriority) {
+  currentPriority = prio;
+}
+
+ModbusPriorityScope::~ModbusPriorityScope() {
+  currentPriority = prev_;
+}
+
+ModbusPriority ModbusPriorityScope::current() {
+  return currentPriority;
+}
+
+void BusArbiter::acquire(ModbusPriority prio) {
+  std::unique_lock lk(mutex_);
+  // Higher priorities sort first.
+  Ticket ticket{-int(prio), nextSeq_++};
+  waiters_.insert(ticket);
+  cv_.wait(lk, [this, &ticket]() {
+    return !busy_ && *waiters_.begin() == ticket;
+  });
+  waiters_.erase(waiters_.begin());
+  busy_ = true;
+  auto idleAt = idleAt_;
+  lk.unlock();
+  // We own the bus, honor the idle time requested by the
+  // previous transaction without blocking other waiters from
+  // queueing up.
+  // sleep override
+  std::this_thread::sleep_until(idleAt);
+}
+
+void BusArbiter::release(ModbusTime holdOff) {
+  {
+    std::unique_lock lk(mutex_);
+    busy_ = false;
+    idleAt_ = std::chrono::steady_clock::now() + holdOff;
+  }
+  cv_.notify_all();
+}
+
+size_t BusArbiter::numWaiters() {
+  std::unique_lock lk(mutex_);
+  return waiters_.size();
+}
+
 void Modbus::command(
     Msg& req,
     Msg& resp,
     uint32_t baudrate,
     ModbusTime timeout,
     Parity parity) {
+  ModbusPriority prio = ModbusPriorityScope::current();
+  auto waitStart = std::chrono::steady_clock::now();
+  // If the bus needs to be idle after each transaction for a given
+  // period of time, the next transaction waits it out instead of
+  // this one sleeping after it is done.
+  BusGrant grant(arbiter_, prio, minDelay_);
+  if (prio == ModbusPriority::INTERACTIVE) {
+    uint64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - waitStart)
+                          .count();
+    numInteractiveCommands_++;
+    uint64_t maxWaitUs = maxInteractiveWaitUs_.load();
+    while (waitUs > maxWaitUs &&
+           !maxInteractiveWaitUs_.compare_exchange_weak(maxWaitUs, waitUs)) {
+    }
+  }
   std::unique_lock lck(deviceMutex_);
   if (!deviceValid_) {
     throw std::runtime_error("Uninitialized");
   }
+  // Account for the time we hold the bus, including transactions
+  // which end in an exception (Timeouts being the most expensive).
+  BusyTimer busyTimer(busyTimeUs_);
+  numCommands_++;
   RACKMON_PROFILE_SCOPE(
       modbusCommand, "modbus::" + std::to_string(int(req.addr)));
   if (timeout == ModbusTime::zero()) {
@@ -38,12 +139,23 @@ void Modbus::command(
     logInfo << devicePath_ << " RX: " << resp << std::endl;
   }
   resp.decode();
-  if (minDelay_ != ModbusTime::zero()) {
-    // If the bus needs to be idle after each transaction for
-    // a given period of time, sleep here.
-    // sleep override
-    std::this_thread::sleep_for(minDelay_);
+}
+
+ModbusStats Modbus::getStats() {
+  ModbusStats stats{};
+  stats.name = devicePath_;
+  stats.present = isPresent();
+  stats.numCommands = numCommands_.load();
+  stats.busyTimeMs = busyTimeUs_.load() / 1000;
+  stats.numInteractiveCommands = numInteractiveCommands_.load();
+  stats.maxInteractiveWaitMs = maxInteractiveWaitUs_.load() / 1000;
+  stats.upTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - statsStart_)
+                       .count();
+  if (stats.upTimeMs > 0) {
+    stats.utilization = 100.0 * float(stats.busyTimeMs) / stats.upTimeMs;
   }
+  return stats;
 }
 
 std::unique_ptr<UARTDevice> Modbus::makeDevice(
@@ -111,4 +223,15 @@ void Modbus::initialize(const json& j) {
   healthCheckThread_->start();
 }
 
+void to_json(json& j, const ModbusStats& m) {
+  j["name"] = m.name;
+  j["present"] = m.present;
+  j["numCommands"] = m.numCommands;
+  j["busyTimeMs"] = m.busyTimeMs;
+  j["upTimeMs"] = m.upTimeMs;
+  j["utilization"] = m.utilization;
+  j["numInteractiveCommands"] = m.numInteractiveCommands;
+  j["maxInteractiveWaitMs"] = m.maxInteractiveWaitMs;
+}
+
 } // namespace rackmon
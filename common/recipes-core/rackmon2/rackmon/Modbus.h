@@ -2,6 +2,7 @@
 #pragma once
 #include <nlohmann/json.hpp>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -13,10 +14,72 @@
 namespace rackmon {
 
 using ModbusTime = std::chrono::milliseconds;
+
+// Bus utilization statistics of a single interface.
+struct ModbusStats {
+  std::string name{};
+  bool present = false;
+  // Number of transactions issued on the bus.
+  uint64_t numCommands = 0;
+  // Total time the bus was held by transactions.
+  uint64_t busyTimeMs = 0;
+  // Time since the statistics were started.
+  uint64_t upTimeMs = 0;
+  // Percentage of upTimeMs for which the bus was busy.
+  float utilization = 0.0;
+  // Number of transactions issued with interactive priority.
+  uint64_t numInteractiveCommands = 0;
+  // Worst time an interactive transaction waited for the bus.
+  uint64_t maxInteractiveWaitMs = 0;
+};
+void to_json(nlohmann::json& j, const ModbusStats& m);
+
+// Priority of the transactions issued by the current thread.
+// Interactive transactions (Requested by a user through the service)
+// get the bus ahead of background (monitor/scan) transactions.
+enum class ModbusPriority { BACKGROUND = 0, INTERACTIVE = 1 };
+
+// Sets the priority of transactions issued by the current thread
+// for the lifetime of the object.
+class ModbusPriorityScope {
+  const ModbusPriority prev_;
+
+ public:
+  explicit ModbusPriorityScope(ModbusPriority prio);
+  ~ModbusPriorityScope();
+  static ModbusPriority current();
+};
+
+// Grants the bus to one transaction at a time. Waiters are granted
+// the bus in the order of their priority, and in the order of their
+// arrival within the same priority. Since RS485 is half duplex, this
+// is the granularity at which interactive requests can preempt the
+// background traffic.
+class BusArbiter {
+  using Ticket = std::pair<int, uint64_t>;
+  std::mutex mutex_{};
+  std::condition_variable cv_{};
+  bool busy_ = false;
+  uint64_t nextSeq_ = 0;
+  std::set<Ticket> waiters_{};
+  // The bus has to be idle till this time.
+  std::chrono::steady_clock::time_point idleAt_{};
+
+ public:
+  // Blocks till the bus is granted to the caller.
+  void acquire(ModbusPriority prio);
+  // Releases the bus. The bus is kept idle for holdOff before it
+  // is used by the next transaction.
+  void release(ModbusTime holdOff = ModbusTime::zero());
+  // Number of transactions waiting for the bus.
+  size_t numWaiters();
+};
+
 class Modbus {
   std::string devicePath_{};
   std::unique_ptr<UARTDevice> device_ = nullptr;
   std::mutex deviceMutex_{};
+  BusArbiter arbiter_{};
   std::set<uint8_t> ignoredAddrs_ = {};
   uint32_t defaultBaudrate_ = 0;
   ModbusTime defaultTimeout_ = ModbusTime::zero();
@@ -25,6 +88,12 @@ class Modbus {
   bool debug_{false};
   std::chrono::seconds healthCheckInterval_ = std::chrono::seconds(600);
   std::unique_ptr<PollThread<Modbus>> healthCheckThread_{};
+  std::atomic<uint64_t> numCommands_{0};
+  std::atomic<uint64_t> busyTimeUs_{0};
+  std::atomic<uint64_t> numInteractiveCommands_{0};
+  std::atomic<uint64_t> maxInteractiveWaitUs_{0};
+  const std::chrono::steady_clock::time_point statsStart_ =
+      std::chrono::steady_clock::now();
 
   void healthCheck();
   bool openDevice();
@@ -70,6 +139,9 @@ class Modbus {
   virtual bool isPresent() {
     return deviceValid_.load();
   }
+
+  // Returns the bus utilization statistics of this interface.
+  ModbusStats getStats();
 };
 
 } // namespace rackmon
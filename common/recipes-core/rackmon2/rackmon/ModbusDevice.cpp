@@ -30,6 +30,18 @@ ModbusDevice::ModbusDevice(
     hdl.SpecialHandlerInfo::operator=(sp);
     specialHandlers_.push_back(hdl);
   }
+  publishSnapshot();
+}
+
+void ModbusDevice::publishSnapshot() {
+  auto snapshot = std::make_shared<std::vector<Register>>();
+  snapshot->reserve(info_.registerList.size());
+  for (const auto& reg : info_.registerList) {
+    snapshot->emplace_back(reg.back());
+  }
+  std::atomic_store(
+      &latestSnapshot_,
+      std::shared_ptr<const std::vector<Register>>(std::move(snapshot)));
 }
 
 void ModbusDevice::handleCommandFailure(std::exception& baseException) {
@@ -171,6 +183,15 @@ void ModbusDevice::forceReloadPlan() {
     RegisterStoreSpan::buildRegisterSpanList(
         reloadPlan_, reg, registerMap_.maxRegisterSpanLength);
   }
+  // Devices are usually discovered (or recovered) together and hence
+  // get their full reload at the same time. Pull the first periodic
+  // reload ahead by a slot derived from the address so subsequent
+  // reloads of different devices do not all land on the same tick.
+  time_t slot = info_.deviceAddress % kReloadJitterSlots;
+  for (auto& span : reloadPlan_) {
+    span.advanceReload(span.interval() * slot / kReloadJitterSlots);
+  }
+  publishSnapshot();
 }
 
 bool ModbusDevice::reloadRegisterSpan(
@@ -217,16 +238,33 @@ void ModbusDevice::reloadAllRegisters() {
     forceReloadPlan();
     return;
   }
+  bool reloaded = false;
   for (auto& plan : reloadPlan_) {
     // Break early, if we are entering exclusive mode
     if (exclusiveMode_) {
       break;
     }
     if (reloadRegisterSpan(plan, singleShot)) {
+      reloaded = true;
       // Release thread to allow for higher priority tasks to execute.
       std::this_thread::yield();
     }
   }
+  if (reloaded) {
+    publishSnapshot();
+  }
+}
+
+time_t ModbusDevice::nextReloadTime() {
+  if (singleShotReload_) {
+    // Everything is pending a reload.
+    return 0;
+  }
+  time_t nextTime = getCurrentTime() + RegisterDescriptor::kDefaultInterval;
+  for (const auto& span : reloadPlan_) {
+    nextTime = std::min(nextTime, span.nextReloadTime());
+  }
+  return nextTime;
 }
 
 void ModbusDevice::setActive() {
@@ -246,9 +284,19 @@ void ModbusDevice::setActive() {
 }
 
 ModbusDeviceRawData ModbusDevice::getRawData() {
-  std::shared_lock lk(infoMutex_);
-  // Makes a deep copy.
-  return info_;
+  ModbusDeviceRawData data;
+  {
+    std::shared_lock lk(infoMutex_);
+    data.ModbusDeviceInfo::operator=(info_);
+  }
+  // Makes a deep copy of the register history. Each copy only holds
+  // that register's lock, so the monitor thread is blocked for at
+  // most one register at a time.
+  data.registerList.reserve(info_.registerList.size());
+  for (const auto& reg : info_.registerList) {
+    data.registerList.emplace_back(reg);
+  }
+  return data;
 }
 
 ModbusDeviceInfo ModbusDevice::getInfo() {
@@ -256,6 +304,17 @@ ModbusDeviceInfo ModbusDevice::getInfo() {
   return info_;
 }
 
+size_t ModbusDevice::memoryUsage() const {
+  size_t usage = sizeof(*this);
+  for (const auto& reg : info_.registerList) {
+    usage += reg.memoryUsage();
+  }
+  for (const auto& reg : *std::atomic_load(&latestSnapshot_)) {
+    usage += sizeof(reg) + reg.value.capacity() * sizeof(uint16_t);
+  }
+  return usage;
+}
+
 ModbusDeviceValueData ModbusDevice::getValueData(
     const ModbusRegisterFilter& filter,
     bool latestValueOnly) const {
@@ -264,19 +323,23 @@ ModbusDeviceValueData ModbusDevice::getValueData(
     std::shared_lock lk(infoMutex_);
     data.ModbusDeviceInfo::operator=(info_);
   }
-  auto shouldPickRegister = [&filter](const RegisterStore& reg) {
-    return !filter || filter.contains(reg.regAddr()) ||
-        filter.contains(reg.name());
+  auto shouldPickRegister = [&filter](uint16_t addr, const std::string& name) {
+    return !filter || filter.contains(addr) || filter.contains(name);
   };
-  for (const auto& reg : info_.registerList) {
-    if (shouldPickRegister(reg)) {
-      if (latestValueOnly) {
-        data.registerList.emplace_back(reg.regAddr(), reg.name());
-        data.registerList.back().history.emplace_back(reg.back());
-      } else {
-        data.registerList.emplace_back(reg);
+  if (latestValueOnly) {
+    auto snapshot = std::atomic_load(&latestSnapshot_);
+    for (const auto& reg : *snapshot) {
+      if (shouldPickRegister(reg.desc.begin, reg.desc.name)) {
+        data.registerList.emplace_back(reg.desc.begin, reg.desc.name);
+        data.registerList.back().history.emplace_back(reg);
       }
     }
+    return data;
+  }
+  for (const auto& reg : info_.registerList) {
+    if (shouldPickRegister(reg.regAddr(), reg.name())) {
+      data.registerList.emplace_back(reg);
+    }
   }
   return data;
 }
@@ -303,6 +366,7 @@ void ModbusDevice::forceReloadRegisters(const ModbusRegisterFilter& filter) {
                << +span.getSpanAddress() << std::endl;
     }
   }
+  publishSnapshot();
 }
 
 static std::string commandOutput(const std::string& shell) {
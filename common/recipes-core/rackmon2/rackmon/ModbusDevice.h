@@ -3,6 +3,7 @@
 #include <nlohmann/json.hpp>
 #include <ctime>
 #include <iostream>
+#include <memory>
 #include <optional>
 #include <set>
 #include <shared_mutex>
@@ -81,6 +82,9 @@ void to_json(nlohmann::json& j, const ModbusDeviceValueData& m);
 
 class ModbusDevice {
   static constexpr uint32_t kMaxConsecutiveFailures = 10;
+  // Number of slots within an interval over which the periodic
+  // reloads of devices are spread out.
+  static constexpr time_t kReloadJitterSlots = 16;
   Modbus& interface_;
   int numCommandRetries_;
   ModbusDeviceRawData info_;
@@ -91,6 +95,13 @@ class ModbusDevice {
   const RegisterMap& registerMap_;
   std::atomic<bool> singleShotReload_{true};
   std::atomic<bool> exclusiveMode_{false};
+  // Latest value of every register (In registerList order) published
+  // after each reload. Readers of the latest values grab a reference
+  // (atomic_load) and never contend with the monitor thread.
+  std::shared_ptr<const std::vector<Register>> latestSnapshot_{};
+
+  // Publish the latest value of each register to readers.
+  void publishSnapshot();
 
   void handleCommandFailure(std::exception& baseException);
 
@@ -147,6 +158,10 @@ class ModbusDevice {
   // based on their configured reload interval.
   void reloadAllRegisters();
 
+  // Returns the earliest time at which any of the registers
+  // will be pending a reload.
+  time_t nextReloadTime();
+
   bool isActive() const {
     return info_.mode == ModbusDeviceMode::ACTIVE;
   }
@@ -170,6 +185,10 @@ class ModbusDevice {
   // Returns raw register data monitored for this device.
   ModbusDeviceRawData getRawData();
 
+  // Returns the number of bytes used by the register history of this
+  // device (Including the published latest values).
+  size_t memoryUsage() const;
+
   // Returns value formatted register data monitored for this device.
   ModbusDeviceValueData getValueData(
       const ModbusRegisterFilter& filter = {},
@@ -182,6 +201,11 @@ class ModbusDevice {
   const RegisterMap& getRegisterMap() const {
     return registerMap_;
   }
+
+  // Returns the interface the device was discovered on.
+  const Modbus& getInterface() const {
+    return interface_;
+  }
 };
 
 } // namespace rackmon
@@ -0,0 +1,58 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#include "MonitorData.h"
+
+using nlohmann::json;
+using namespace rackmon;
+
+namespace rackmonsvc {
+
+void from_json(const json& filter, ModbusDataFilter& out) {
+  if (filter.contains("deviceFilter")) {
+    const json& jdevFilter = filter["deviceFilter"];
+    if (jdevFilter.contains("addressFilter")) {
+      out.devFilter.addrFilter = jdevFilter["addressFilter"];
+    } else if (jdevFilter.contains("typeFilter")) {
+      out.devFilter.typeFilter = jdevFilter["typeFilter"];
+    } else {
+      throw std::logic_error("Device Filter needs at least one set");
+    }
+  }
+  if (filter.contains("registerFilter")) {
+    const json& jregFilter = filter["registerFilter"];
+    if (jregFilter.contains("addressFilter")) {
+      out.regFilter.addrFilter = jregFilter["addressFilter"];
+    } else if (jregFilter.contains("nameFilter")) {
+      out.regFilter.nameFilter = jregFilter["nameFilter"];
+    } else {
+      throw std::logic_error("Register Filter needs at least one set");
+    }
+  }
+  out.latestValueOnly = filter.value("latestValueOnly", false);
+}
+
+void getMonitorData(
+    const Rackmon& rackmon,
+    const json& req,
+    json& resp,
+    const std::function<void(const json&)>& streamFrame) {
+  ModbusDataFilter filter{};
+  if (req.contains("filter")) {
+    filter = req["filter"];
+  }
+  if (streamFrame) {
+    rackmon.getValueData(
+        [&streamFrame](const ModbusDeviceValueData& dev) {
+          streamFrame({{"data", json::array({dev})}});
+        },
+        filter.devFilter,
+        filter.regFilter,
+        filter.latestValueOnly);
+  } else {
+    std::vector<ModbusDeviceValueData> ret;
+    rackmon.getValueData(
+        ret, filter.devFilter, filter.regFilter, filter.latestValueOnly);
+    resp["data"] = ret;
+  }
+}
+
+} // namespace rackmonsvc
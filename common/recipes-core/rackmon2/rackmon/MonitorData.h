@@ -0,0 +1,27 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#pragma once
+#include <nlohmann/json.hpp>
+#include <functional>
+#include "Rackmon.h"
+
+namespace rackmonsvc {
+
+// The "filter" of getMonitorData, subscribe and reloadRegisters requests.
+struct ModbusDataFilter {
+  rackmon::ModbusDeviceFilter devFilter{};
+  rackmon::ModbusRegisterFilter regFilter{};
+  bool latestValueOnly = false;
+};
+
+void from_json(const nlohmann::json& filter, ModbusDataFilter& out);
+
+// Handle a getMonitorData request. If streamFrame is provided, each
+// device is sent as its own frame instead of being accumulated in
+// resp["data"].
+void getMonitorData(
+    const rackmon::Rackmon& rackmon,
+    const nlohmann::json& req,
+    nlohmann::json& resp,
+    const std::function<void(const nlohmann::json&)>& streamFrame = nullptr);
+
+} // namespace rackmonsvc
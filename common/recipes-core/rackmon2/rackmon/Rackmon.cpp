@@ -1,6 +1,8 @@
 // Copyright 2021-present Facebook. All Rights Reserved.
 #include "Rackmon.h"
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 #include "Log.h"
@@ -37,9 +39,47 @@ bool ModbusDeviceFilter::contains(const ModbusDevice& dev) const {
   return false;
 }
 
+void ReloadSchedule::schedule(uint8_t addr, time_t deadline) {
+  std::unique_lock lock(mutex_);
+  deadlines_.emplace(deadline, addr);
+  scheduled_.insert(addr);
+}
+
+std::vector<ReloadSchedule::Deadline> ReloadSchedule::popDue(
+    time_t currentTime) {
+  std::unique_lock lock(mutex_);
+  std::vector<Deadline> ret{};
+  while (!deadlines_.empty() && deadlines_.top().first <= currentTime) {
+    ret.push_back(deadlines_.top());
+    scheduled_.erase(deadlines_.top().second);
+    deadlines_.pop();
+  }
+  return ret;
+}
+
+void ReloadSchedule::recordReload(time_t delay) {
+  std::unique_lock lock(mutex_);
+  numReloads_++;
+  maxReloadDelay_ = std::max(maxReloadDelay_, delay);
+}
+
+void ReloadSchedule::clear() {
+  std::unique_lock lock(mutex_);
+  deadlines_ = {};
+  scheduled_.clear();
+}
+
+void ReloadSchedule::getStats(InterfaceStats& stats) const {
+  std::unique_lock lock(mutex_);
+  stats.numScheduled = scheduled_.size();
+  stats.numReloads = numReloads_;
+  stats.maxReloadDelay = maxReloadDelay_;
+  stats.nextReloadTime = deadlines_.empty() ? 0 : deadlines_.top().first;
+}
+
 void Rackmon::loadInterface(const nlohmann::json& config) {
   std::shared_lock lk(threadMutex_);
-  if (scanThread_ != nullptr || monitorThread_ != nullptr) {
+  if (started_) {
     throw std::runtime_error("Cannot load configuration when started");
   }
   if (!interfaces_.empty()) {
@@ -48,12 +88,14 @@ void Rackmon::loadInterface(const nlohmann::json& config) {
   for (const auto& ifaceConf : config["interfaces"]) {
     interfaces_.push_back(makeInterface());
     interfaces_.back()->initialize(ifaceConf);
+    interfaceStates_.push_back(
+        std::make_unique<InterfaceState>(*interfaces_.back()));
   }
 }
 
 void Rackmon::loadRegisterMap(const nlohmann::json& config) {
   std::shared_lock lk(threadMutex_);
-  if (scanThread_ != nullptr || monitorThread_ != nullptr) {
+  if (started_) {
     throw std::runtime_error("Cannot load configuration when started");
   }
   registerMapDB_.load(config);
@@ -65,11 +107,13 @@ void Rackmon::loadRegisterMap(const nlohmann::json& config) {
       allPossibleDevAddrs_.push_back(uint8_t(addr));
     }
   }
-  nextDeviceToProbe_ = allPossibleDevAddrs_.begin();
   monitorInterval_ = std::chrono::seconds(registerMapDB_.minMonitorInterval());
 }
 
-void Rackmon::load(const std::string& confPath, const std::string& regmapDir) {
+void Rackmon::load(
+    const std::string& confPath,
+    const std::string& regmapDir,
+    const std::string& deviceCachePath) {
   auto getJSON = [](const std::string& fileName) {
     std::ifstream ifs(fileName);
     json contents;
@@ -88,60 +132,287 @@ void Rackmon::load(const std::string& confPath, const std::string& regmapDir) {
   for (auto const& dir_entry : std::filesystem::directory_iterator{regmapDir}) {
     loadRegisterMap(getJSON(dir_entry.path().string()));
   }
+  if (!deviceCachePath.empty()) {
+    loadDeviceCache(deviceCachePath);
+  }
+}
+
+void Rackmon::loadDeviceCache(const std::string& path) {
+  deviceCachePath_ = path;
+  std::ifstream ifs(path);
+  if (!ifs.is_open()) {
+    logInfo << "No device cache at " << path << std::endl;
+    return;
+  }
+  std::vector<CachedDevice> devices{};
+  try {
+    json j;
+    ifs >> j;
+    if (j.at("version") != kDeviceCacheVersion) {
+      throw std::runtime_error("Unsupported version");
+    }
+    j.at("devices").get_to(devices);
+  } catch (std::exception& e) {
+    // The cache is only an optimization, fall back to a full scan.
+    logWarn << "Ignoring device cache " << path << ": " << e.what()
+            << std::endl;
+    return;
+  }
+  for (const auto& dev : devices) {
+    auto it = std::find_if(
+        interfaceStates_.begin(),
+        interfaceStates_.end(),
+        [&dev](const auto& state) {
+          return state->interface.name() == dev.interface;
+        });
+    if (it == interfaceStates_.end()) {
+      logWarn << "Ignoring cached device " << int(dev.deviceAddress)
+              << " on unknown interface " << dev.interface << std::endl;
+      continue;
+    }
+    (*it)->cachedDevices.push_back(dev);
+  }
+}
+
+void Rackmon::saveDeviceCache() {
+  if (deviceCachePath_.empty()) {
+    return;
+  }
+  // Hold the lock while taking the device list too, so a concurrent
+  // save from another interface never overwrites a newer device list
+  // with an older one.
+  std::unique_lock lock(deviceCacheMutex_);
+  json j;
+  j["version"] = kDeviceCacheVersion;
+  j["devices"] = json::array();
+  for (const auto& [addr, dev] : getDevices()) {
+    const RegisterMap& rmap = dev->getRegisterMap();
+    CachedDevice cached{};
+    cached.deviceAddress = addr;
+    cached.interface = dev->getInterface().name();
+    cached.deviceType = rmap.name;
+    cached.baudrate = rmap.baudrate;
+    cached.parity = rmap.parity;
+    j["devices"].push_back(cached);
+  }
+  // Write to a temporary file and rename it in place, so a crash
+  // never leaves behind a partially written cache.
+  std::string tmpPath = deviceCachePath_ + ".tmp";
+  std::ofstream ofs(tmpPath);
+  ofs << j;
+  ofs.close();
+  if (!ofs || std::rename(tmpPath.c_str(), deviceCachePath_.c_str()) != 0) {
+    logWarn << "Failed to write device cache " << deviceCachePath_
+            << std::endl;
+  }
 }
 
-bool Rackmon::probe(Modbus& interface, uint8_t addr) {
-  if (!interface.isPresent()) {
+void Rackmon::verifyCachedDevices(InterfaceState& state) {
+  if (!state.interface.isPresent()) {
+    return;
+  }
+  std::vector<CachedDevice> cached = std::move(state.cachedDevices);
+  state.cachedDevices.clear();
+  size_t numFound = 0;
+  for (const auto& dev : cached) {
+    uint8_t addr = dev.deviceAddress;
+    if (isDeviceKnown(addr)) {
+      continue;
+    }
+    // Rank the address first in scans, even if it fails to
+    // answer now.
+    {
+      std::unique_lock lock(seenAddrsMutex_);
+      seenAddrs_.insert(addr);
+    }
+    auto rmap = registerMapDB_.find(addr);
+    while (rmap != registerMapDB_.end() &&
+           ((*rmap).name != dev.deviceType ||
+            (*rmap).baudrate != dev.baudrate ||
+            (*rmap).parity != dev.parity)) {
+      ++rmap;
+    }
+    if (rmap == registerMapDB_.end()) {
+      logWarn << "Register map of cached device " << int(addr)
+              << " has changed" << std::endl;
+      continue;
+    }
+    if (probe(state, addr, *rmap, kProbeTimeout)) {
+      numFound++;
+    }
+  }
+  state.numWarmStartDevices = numFound;
+  logInfo << "Verified " << numFound << " of " << cached.size()
+          << " cached devices on " << state.interface.name() << std::endl;
+  if (numFound > 0) {
+    std::shared_lock lk(threadMutex_);
+    if (state.monitorThread) {
+      state.monitorThread->tick(true);
+    }
+  }
+}
+
+void ProbeTimer::record(ModbusTime rtt) {
+  float sample = float(rtt.count());
+  if (numSamples_ == 0) {
+    srtt_ = sample;
+    rttvar_ = sample / 2;
+  } else {
+    rttvar_ = 0.75 * rttvar_ + 0.25 * std::abs(srtt_ - sample);
+    srtt_ = 0.875 * srtt_ + 0.125 * sample;
+  }
+  if (numSamples_ < kMinSamples) {
+    numSamples_++;
+  }
+}
+
+ModbusTime ProbeTimer::timeout() const {
+  if (numSamples_ < kMinSamples) {
+    return maxTimeout_;
+  }
+  ModbusTime estimate(int64_t(srtt_ + 4 * rttvar_));
+  return std::clamp(estimate, kMinTimeout, maxTimeout_);
+}
+
+bool Rackmon::probe(
+    InterfaceState& state,
+    uint8_t addr,
+    const RegisterMap& rmap,
+    ModbusTime timeout) {
+  Modbus& interface = state.interface;
+  ProbeTimer& timer =
+      state.probeTimers.try_emplace(rmap.baudrate, kProbeTimeout).first->second;
+  std::vector<uint16_t> v(1);
+  try {
+    ReadHoldingRegistersReq req(addr, rmap.probeRegister, v.size());
+    ReadHoldingRegistersResp resp(addr, v);
+    auto begin = std::chrono::steady_clock::now();
+    interface.command(req, resp, rmap.baudrate, timeout, rmap.parity);
+    timer.record(std::chrono::duration_cast<ModbusTime>(
+        std::chrono::steady_clock::now() - begin));
+    {
+      std::unique_lock lock(seenAddrsMutex_);
+      seenAddrs_.insert(addr);
+    }
+    {
+      std::unique_lock lock(devicesMutex_);
+      // We do not support the same address on multiple
+      // interfaces. First one to find it, wins.
+      if (devices_.find(addr) != devices_.end()) {
+        logWarn << std::hex << std::setw(2) << std::setfill('0') << "Ignored "
+                << int(addr) << " on " << interface.name()
+                << " already discovered on another interface" << std::endl;
+        return false;
+      }
+      devices_[addr] = std::make_unique<ModbusDevice>(interface, addr, rmap);
+    }
+    logInfo << std::hex << std::setw(2) << std::setfill('0') << "Found "
+            << int(addr) << " on " << interface.name() << std::endl;
+    return true;
+  } catch (TimeoutException&) {
+    // Expected for unfound addresses.
+  } catch (std::exception&) {
+    // Something answered, but not correctly (CRC errors, exception
+    // responses etc). Probe it early in the next scans.
+    std::unique_lock lock(seenAddrsMutex_);
+    seenAddrs_.insert(addr);
+  }
+  return false;
+}
+
+bool Rackmon::probe(InterfaceState& state, uint8_t addr, bool fast) {
+  if (!state.interface.isPresent()) {
     return false;
   }
   for (auto it = registerMapDB_.find(addr); it != registerMapDB_.end(); ++it) {
     const auto& rmap = *it;
-    std::vector<uint16_t> v(1);
-    try {
-      ReadHoldingRegistersReq req(addr, rmap.probeRegister, v.size());
-      ReadHoldingRegistersResp resp(addr, v);
-      interface.command(req, resp, rmap.baudrate, kProbeTimeout, rmap.parity);
-      {
-        std::unique_lock lock(devicesMutex_);
-        devices_[addr] = std::make_unique<ModbusDevice>(interface, addr, rmap);
-      }
-      logInfo << std::hex << std::setw(2) << std::setfill('0') << "Found "
-              << int(addr) << " on " << interface.name() << std::endl;
+    ModbusTime timeout = kProbeTimeout;
+    if (fast) {
+      timeout = state.probeTimers.try_emplace(rmap.baudrate, kProbeTimeout)
+                    .first->second.timeout();
+    }
+    if (probe(state, addr, rmap, timeout)) {
       return true;
-    } catch (std::exception&) {
-      // Exceptions are expected for unfound addresses.
+    }
+    // Already discovered on another interface.
+    if (isDeviceKnown(addr)) {
+      return false;
     }
   }
   return false;
 }
 
-bool Rackmon::probe(uint8_t addr) {
-  // We do not support the same address
-  // on multiple interfaces.
-  return std::any_of(
-      interfaces_.begin(), interfaces_.end(), [this, addr](const auto& iface) {
-        return probe(*iface, addr);
-      });
+std::vector<uint8_t> Rackmon::getScanOrder() const {
+  // Rank each candidate by its offset within its address range.
+  // Devices are typically populated from the start of a range
+  // (First shelf/slot). Previously seen addresses rank first.
+  std::map<uint8_t, int> rank{};
+  for (const auto& rmap : registerMapDB_) {
+    for (const auto& [start, end] : rmap.applicableAddresses.range) {
+      for (int addr = start; addr <= end; ++addr) {
+        int r = addr - start + 1;
+        auto [it, inserted] = rank.try_emplace(uint8_t(addr), r);
+        if (!inserted) {
+          it->second = std::min(it->second, r);
+        }
+      }
+    }
+  }
+  {
+    std::unique_lock lock(seenAddrsMutex_);
+    for (uint8_t addr : seenAddrs_) {
+      if (auto it = rank.find(addr); it != rank.end()) {
+        it->second = 0;
+      }
+    }
+  }
+  std::vector<uint8_t> order{};
+  for (const auto& [addr, r] : rank) {
+    order.push_back(addr);
+  }
+  std::stable_sort(order.begin(), order.end(), [&rank](uint8_t a, uint8_t b) {
+    return rank.at(a) < rank.at(b);
+  });
+  return order;
+}
+
+std::map<uint8_t, ModbusDevice*> Rackmon::getDevices(
+    const Modbus& interface) const {
+  std::map<uint8_t, ModbusDevice*> ret{};
+  std::shared_lock lock(devicesMutex_);
+  for (const auto& [addr, dev] : devices_) {
+    if (&dev->getInterface() == &interface) {
+      ret[addr] = dev.get();
+    }
+  }
+  return ret;
 }
 
-std::vector<uint8_t> Rackmon::inspectDormant() {
-  std::vector<uint8_t> ret{};
+std::map<uint8_t, ModbusDevice*> Rackmon::getDevices() const {
+  std::map<uint8_t, ModbusDevice*> ret{};
   std::shared_lock lock(devicesMutex_);
-  for (const auto& it : devices_) {
-    if (it.second->isActive()) {
+  for (const auto& [addr, dev] : devices_) {
+    ret[addr] = dev.get();
+  }
+  return ret;
+}
+
+std::vector<ModbusDevice*> Rackmon::inspectDormant(const Modbus& interface) {
+  std::vector<ModbusDevice*> ret{};
+  for (const auto& [addr, dev] : getDevices(interface)) {
+    if (dev->isActive()) {
       continue;
     }
     time_t curr = getTime();
     // If its more than 300s since last activity, start probing it.
     // change to something larger if required.
-    if ((it.second->lastActive() + kDormantMinInactiveTime) < curr) {
-      const RegisterMap& rmap = it.second->getRegisterMap();
+    if ((dev->lastActive() + kDormantMinInactiveTime) < curr) {
+      const RegisterMap& rmap = dev->getRegisterMap();
       uint16_t probe = rmap.probeRegister;
       std::vector<uint16_t> v(1);
       try {
-        uint8_t addr = it.first;
-        it.second->readHoldingRegisters(probe, v);
-        ret.push_back(addr);
+        dev->readHoldingRegisters(probe, v);
+        ret.push_back(dev);
       } catch (...) {
         continue;
       }
@@ -150,21 +421,46 @@ std::vector<uint8_t> Rackmon::inspectDormant() {
   return ret;
 }
 
-void Rackmon::recoverDormant() {
-  std::vector<uint8_t> candidates = inspectDormant();
-  for (auto& addr : candidates) {
-    std::unique_lock lock(devicesMutex_);
-    devices_.at(addr)->setActive();
+void Rackmon::recoverDormant(const Modbus& interface) {
+  for (auto dev : inspectDormant(interface)) {
+    dev->setActive();
   }
 }
 
-void Rackmon::monitor() {
-  std::shared_lock lock(devicesMutex_);
-  for (const auto& dev_it : devices_) {
-    if (!dev_it.second->isActive()) {
+void Rackmon::monitor(InterfaceState& state) {
+  ReloadSchedule& schedule = state.schedule;
+  std::map<uint8_t, ModbusDevice*> devices = getDevices(state.interface);
+  time_t now = std::time(nullptr);
+  // Newly discovered or recovered devices are due right away.
+  for (const auto& [addr, dev] : devices) {
+    if (dev->isActive() && !schedule.isScheduled(addr)) {
+      schedule.schedule(addr, now);
+    }
+  }
+  time_t retryInterval = monitorInterval_.count();
+  bool reloaded = false;
+  for (const auto& [deadline, addr] : schedule.popDue(now)) {
+    ModbusDevice& dev = *devices.at(addr);
+    // Dormant devices are dropped from the schedule, they
+    // are added back when they are recovered.
+    if (!dev.isActive()) {
       continue;
     }
-    dev_it.second->reloadAllRegisters();
+    time_t currTime = std::time(nullptr);
+    schedule.recordReload(currTime - deadline);
+    dev.reloadAllRegisters();
+    reloaded = true;
+    // If some spans failed to reload, they are still due. Do not
+    // hammer the bus, retry them after the minimum interval.
+    currTime = std::time(nullptr);
+    time_t nextDeadline = dev.nextReloadTime();
+    if (nextDeadline <= currTime) {
+      nextDeadline = currTime + retryInterval;
+    }
+    schedule.schedule(addr, nextDeadline);
+  }
+  if (reloaded) {
+    notifyReload();
   }
   lastMonitorTime_ = std::time(nullptr);
 }
@@ -190,59 +486,84 @@ ModbusDevice& Rackmon::getModbusDevice(uint8_t addr) {
   return d;
 }
 
-void Rackmon::fullScan() {
-  logInfo << "Starting scan of all devices" << std::endl;
+void Rackmon::fullScan(InterfaceState& state) {
+  logInfo << "Starting scan of all devices on " << state.interface.name()
+          << std::endl;
+  auto begin = std::chrono::steady_clock::now();
   bool atLeastOne = false;
+  uint64_t numProbes = 0;
+  std::vector<uint8_t> order = getScanOrder();
   // Retry the scan loop to ensure we discover any flaky
   // devices which might have missed the first loop.
   for (int i = 0; i < kScanNumRetry; i++) {
-    for (const auto& addr : allPossibleDevAddrs_) {
+    for (const auto& addr : order) {
       if (isDeviceKnown(addr)) {
         continue;
       }
-      if (reqForceScan_.load() == false) {
+      if (state.reqForceScan.load() == false) {
         logWarn << "Full scan aborted" << std::endl;
         return;
       }
-      if (probe(addr)) {
+      numProbes++;
+      // The last pass uses the full timeout so slow devices which
+      // missed the adapted timeout are not lost.
+      if (probe(state, addr, i < kScanNumRetry - 1)) {
         atLeastOne = true;
       }
     }
   }
-  logInfo << "Finished scan of all devices" << std::endl;
+  auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - begin);
+  state.lastFullScanDurationMs = duration.count();
+  state.lastFullScanProbes = numProbes;
+  state.numFullScans++;
+  logInfo << "Finished scan of all devices on " << state.interface.name()
+          << " in " << std::dec << duration.count() << "ms" << std::endl;
   // When scan is complete, request for a monitor.
   if (atLeastOne) {
     std::shared_lock lk(threadMutex_);
-    if (monitorThread_) {
-      monitorThread_->tick(true);
+    if (state.monitorThread) {
+      state.monitorThread->tick(true);
     }
   }
-  reqForceScan_ = false;
+  state.reqForceScan = false;
 }
 
-void Rackmon::scan() {
-  // Circular iterator.
-  if (reqForceScan_.load()) {
-    fullScan();
+void Rackmon::scan(InterfaceState& state) {
+  // Devices known to the previous instance are verified first so
+  // they are monitored right away. The full scan follows in the
+  // background.
+  if (!state.cachedDevices.empty()) {
+    verifyCachedDevices(state);
+    saveDeviceCache();
+  }
+  if (state.reqForceScan.load()) {
+    fullScan(state);
+    saveDeviceCache();
+    return;
+  }
+  if (allPossibleDevAddrs_.empty()) {
     return;
   }
 
+  // Circular index.
+  uint8_t addr = allPossibleDevAddrs_[state.nextDeviceToProbe];
   // Probe for the address only if we already dont know it.
-  if (!isDeviceKnown(*nextDeviceToProbe_)) {
-    if (probe(*nextDeviceToProbe_)) {
+  if (!isDeviceKnown(addr)) {
+    if (probe(state, addr)) {
+      saveDeviceCache();
       std::shared_lock lk(threadMutex_);
-      if (monitorThread_) {
-        monitorThread_->tick(true);
+      if (state.monitorThread) {
+        state.monitorThread->tick(true);
       }
     }
     lastScanTime_ = std::time(nullptr);
   }
 
   // Try and recover dormant devices
-  recoverDormant();
-  if (++nextDeviceToProbe_ == allPossibleDevAddrs_.end()) {
-    nextDeviceToProbe_ = allPossibleDevAddrs_.begin();
-  }
+  recoverDormant(state.interface);
+  state.nextDeviceToProbe =
+      (state.nextDeviceToProbe + 1) % allPossibleDevAddrs_.size();
 }
 
 std::shared_ptr<PollThread<Rackmon>> Rackmon::makeThread(
@@ -254,16 +575,26 @@ std::shared_ptr<PollThread<Rackmon>> Rackmon::makeThread(
 void Rackmon::start(PollThreadTime interval) {
   std::unique_lock lk(threadMutex_);
   logInfo << "Start was requested" << std::endl;
-  if (scanThread_ != nullptr || monitorThread_ != nullptr) {
+  if (started_) {
     throw std::runtime_error("Already running");
   }
   for (auto& dev_it : devices_) {
     dev_it.second->setExclusiveMode(false);
   }
-  scanThread_ = makeThread(&Rackmon::scan, interval);
-  scanThread_->start();
-  monitorThread_ = makeThread(&Rackmon::monitor, monitorInterval_);
-  monitorThread_->start();
+  for (auto& state : interfaceStates_) {
+    InterfaceState* statePtr = state.get();
+    // Devices do a full reload when leaving exclusive mode, so
+    // start over with an empty schedule.
+    state->schedule.clear();
+    state->scanThread = makeThread(
+        [statePtr](Rackmon* self) { self->scan(*statePtr); }, interval);
+    state->scanThread->start();
+    state->monitorThread = makeThread(
+        [statePtr](Rackmon* self) { self->monitor(*statePtr); },
+        kMonitorScheduleTick);
+    state->monitorThread->start();
+  }
+  started_ = true;
 }
 
 void Rackmon::stop(bool forceStop) {
@@ -272,33 +603,61 @@ void Rackmon::stop(bool forceStop) {
   for (auto& dev_it : devices_) {
     dev_it.second->setExclusiveMode(true);
   }
-  if (forceStop) {
-    reqForceScan_ = false;
+  for (auto& state : interfaceStates_) {
+    if (forceStop) {
+      state->reqForceScan = false;
+    }
   }
   // TODO We probably need a timer to ensure we
   // are not waiting here forever.
-  if (monitorThread_ != nullptr) {
-    monitorThread_->stop();
-    monitorThread_ = nullptr;
+  for (auto& state : interfaceStates_) {
+    if (state->monitorThread != nullptr) {
+      state->monitorThread->stop();
+      state->monitorThread = nullptr;
+    }
+    if (state->scanThread != nullptr) {
+      state->scanThread->stop();
+      state->scanThread = nullptr;
+    }
   }
-  if (scanThread_ != nullptr) {
-    scanThread_->stop();
-    scanThread_ = nullptr;
+  started_ = false;
+}
+
+void Rackmon::tickScanThreads() {
+  std::shared_lock lk(threadMutex_);
+  if (!started_) {
+    throw std::runtime_error("Invalid scanThread state");
+  }
+  for (auto& state : interfaceStates_) {
+    state->scanThread->tick();
+  }
+}
+
+void Rackmon::tickMonitorThreads() {
+  std::shared_lock lk(threadMutex_);
+  if (!started_) {
+    throw std::runtime_error("Invalid monitorThread state");
+  }
+  for (auto& state : interfaceStates_) {
+    state->monitorThread->tick();
   }
 }
 
 void Rackmon::forceScan() {
   logInfo << "Force Scan was requested" << std::endl;
-  reqForceScan_ = true;
   std::shared_lock lk(threadMutex_);
-  if (scanThread_) {
-    scanThread_->tick(true);
+  for (auto& state : interfaceStates_) {
+    state->reqForceScan = true;
+    if (state->scanThread) {
+      state->scanThread->tick(true);
+    }
   }
 }
 
 void Rackmon::rawCmd(Request& req, Response& resp, ModbusTime timeout) {
   uint8_t addr = req.addr;
   RACKMON_PROFILE_SCOPE(raw_cmd, "rawcmd::" + std::to_string(int(req.addr)));
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
 
   getModbusDevice(addr).command(req, resp, timeout);
@@ -313,6 +672,7 @@ void Rackmon::readHoldingRegisters(
     ModbusTime timeout) {
   RACKMON_PROFILE_SCOPE(
       raw_cmd, "readRegs::" + std::to_string(int(deviceAddress)));
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
 
   getModbusDevice(deviceAddress)
@@ -326,6 +686,7 @@ void Rackmon::writeSingleRegister(
     ModbusTime timeout) {
   RACKMON_PROFILE_SCOPE(
       raw_cmd, "writeReg::" + std::to_string(int(deviceAddress)));
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
 
   getModbusDevice(deviceAddress)
@@ -339,6 +700,7 @@ void Rackmon::writeMultipleRegisters(
     ModbusTime timeout) {
   RACKMON_PROFILE_SCOPE(
       raw_cmd, "writeRegs::" + std::to_string(int(deviceAddress)));
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
 
   getModbusDevice(deviceAddress)
@@ -351,6 +713,7 @@ void Rackmon::readFileRecord(
     ModbusTime timeout) {
   RACKMON_PROFILE_SCOPE(
       raw_cmd, "ReadFile::" + std::to_string(int(deviceAddress)));
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
   getModbusDevice(deviceAddress).readFileRecord(records, timeout);
 }
@@ -366,13 +729,37 @@ std::vector<ModbusDeviceInfo> Rackmon::listDevices() const {
   return devices;
 }
 
+std::vector<InterfaceStats> Rackmon::getInterfaceStats() const {
+  std::vector<InterfaceStats> ret{};
+  for (const auto& state : interfaceStates_) {
+    InterfaceStats stats{};
+    stats.bus = state->interface.getStats();
+    state->schedule.getStats(stats);
+    stats.numFullScans = state->numFullScans;
+    stats.lastFullScanDurationMs = state->lastFullScanDurationMs;
+    stats.lastFullScanProbes = state->lastFullScanProbes;
+    stats.numWarmStartDevices = state->numWarmStartDevices;
+    for (const auto& [addr, dev] : getDevices(state->interface)) {
+      stats.numDevices++;
+      stats.historyBytes += dev->memoryUsage();
+    }
+    ret.push_back(stats);
+  }
+  return ret;
+}
+
 void Rackmon::getRawData(std::vector<ModbusDeviceRawData>& data) const {
   data.clear();
-  std::shared_lock lock(devicesMutex_);
-  std::transform(
-      devices_.begin(), devices_.end(), std::back_inserter(data), [](auto& kv) {
-        return kv.second->getRawData();
-      });
+  getRawData([&data](const ModbusDeviceRawData& dev) { data.push_back(dev); });
+}
+
+void Rackmon::getRawData(
+    const std::function<void(const ModbusDeviceRawData&)>& func) const {
+  // Devices are never removed, no need to hold the lock while the
+  // caller consumes the data.
+  for (const auto& [addr, dev] : getDevices()) {
+    func(dev->getRawData());
+  }
 }
 
 void Rackmon::getValueData(
@@ -381,11 +768,21 @@ void Rackmon::getValueData(
     const ModbusRegisterFilter& regFilter,
     bool latestValueOnly) const {
   data.clear();
-  std::shared_lock lock(devicesMutex_);
-  for (const auto& kv : devices_) {
-    const ModbusDevice& dev = *kv.second;
-    if (devFilter.contains(dev)) {
-      data.push_back(dev.getValueData(regFilter, latestValueOnly));
+  getValueData(
+      [&data](const ModbusDeviceValueData& dev) { data.push_back(dev); },
+      devFilter,
+      regFilter,
+      latestValueOnly);
+}
+
+void Rackmon::getValueData(
+    const std::function<void(const ModbusDeviceValueData&)>& func,
+    const ModbusDeviceFilter& devFilter,
+    const ModbusRegisterFilter& regFilter,
+    bool latestValueOnly) const {
+  for (const auto& [addr, dev] : getDevices()) {
+    if (devFilter.contains(*dev)) {
+      func(dev->getValueData(regFilter, latestValueOnly));
     }
   }
 }
@@ -393,6 +790,7 @@ void Rackmon::getValueData(
 void Rackmon::reload(
     const ModbusDeviceFilter& devFilter,
     const ModbusRegisterFilter& regFilter) {
+  ModbusPriorityScope priority(ModbusPriority::INTERACTIVE);
   std::shared_lock lock(devicesMutex_);
   for (const auto& kv : devices_) {
     ModbusDevice& dev = *kv.second;
@@ -401,6 +799,101 @@ void Rackmon::reload(
       dev.forceReloadRegisters(regFilter);
     }
   }
+  notifyReload();
+}
+
+void Rackmon::notifyReload() {
+  {
+    std::unique_lock lk(reloadMutex_);
+    reloadGeneration_++;
+  }
+  reloadCond_.notify_all();
+}
+
+uint64_t Rackmon::getReloadGeneration() {
+  std::unique_lock lk(reloadMutex_);
+  return reloadGeneration_;
+}
+
+uint64_t Rackmon::waitForReload(uint64_t generation, PollThreadTime timeout) {
+  std::unique_lock lk(reloadMutex_);
+  reloadCond_.wait_for(lk, timeout, [this, generation]() {
+    return reloadGeneration_ != generation;
+  });
+  return reloadGeneration_;
+}
+
+bool ValueChangeTracker::changed(
+    const RegisterValue& prev,
+    const RegisterValue& curr) const {
+  if (prev.value.index() != curr.value.index()) {
+    return true;
+  }
+  if (threshold_ > 0.0) {
+    auto delta = [](auto a, auto b) { return std::fabs(double(a) - b); };
+    if (auto* v = std::get_if<float>(&curr.value)) {
+      return delta(*v, std::get<float>(prev.value)) >= threshold_;
+    } else if (auto* v = std::get_if<int32_t>(&curr.value)) {
+      return delta(*v, std::get<int32_t>(prev.value)) >= threshold_;
+    } else if (auto* v = std::get_if<int64_t>(&curr.value)) {
+      return delta(*v, std::get<int64_t>(prev.value)) >= threshold_;
+    }
+  }
+  return prev.value != curr.value;
+}
+
+bool ValueChangeTracker::update(ModbusDeviceValueData& data) {
+  uint8_t addr = data.deviceAddress;
+  auto mode = lastMode_.find(addr);
+  bool modeChanged = mode == lastMode_.end() || mode->second != data.mode;
+  lastMode_[addr] = data.mode;
+  auto unchanged = [this, addr](const RegisterStoreValue& reg) {
+    // Registers which were never read have nothing to report.
+    if (reg.history.empty() || reg.history.back().timestamp == 0) {
+      return true;
+    }
+    const RegisterValue& curr = reg.history.back();
+    auto key = std::make_pair(addr, reg.regAddr);
+    auto it = lastReported_.find(key);
+    if (it != lastReported_.end() && !changed(it->second, curr)) {
+      return true;
+    }
+    lastReported_.insert_or_assign(key, curr);
+    return false;
+  };
+  auto& regs = data.registerList;
+  regs.erase(std::remove_if(regs.begin(), regs.end(), unchanged), regs.end());
+  return modeChanged || !regs.empty();
+}
+
+void to_json(json& j, const InterfaceStats& m) {
+  j = m.bus;
+  j["numScheduled"] = m.numScheduled;
+  j["numReloads"] = m.numReloads;
+  j["maxReloadDelay"] = m.maxReloadDelay;
+  j["nextReloadTime"] = m.nextReloadTime;
+  j["numFullScans"] = m.numFullScans;
+  j["lastFullScanDurationMs"] = m.lastFullScanDurationMs;
+  j["lastFullScanProbes"] = m.lastFullScanProbes;
+  j["numDevices"] = m.numDevices;
+  j["historyBytes"] = m.historyBytes;
+  j["numWarmStartDevices"] = m.numWarmStartDevices;
+}
+
+void to_json(json& j, const CachedDevice& m) {
+  j["devAddress"] = m.deviceAddress;
+  j["interface"] = m.interface;
+  j["deviceType"] = m.deviceType;
+  j["baudrate"] = m.baudrate;
+  j["parity"] = m.parity;
+}
+
+void from_json(const json& j, CachedDevice& m) {
+  j.at("devAddress").get_to(m.deviceAddress);
+  j.at("interface").get_to(m.interface);
+  j.at("deviceType").get_to(m.deviceType);
+  j.at("baudrate").get_to(m.baudrate);
+  j.at("parity").get_to(m.parity);
 }
 
 } // namespace rackmon
@@ -1,7 +1,9 @@
 // Copyright 2021-present Facebook. All Rights Reserved.
 #pragma once
 #include <atomic>
+#include <condition_variable>
 #include <optional>
+#include <queue>
 #include <set>
 #include <shared_mutex>
 #include <thread>
@@ -17,18 +19,159 @@ struct ModbusDeviceFilter {
   bool contains(const ModbusDevice& dev) const;
 };
 
+// Monitoring statistics of a single interface.
+struct InterfaceStats {
+  ModbusStats bus{};
+  // Number of devices with a scheduled reload on the interface.
+  size_t numScheduled = 0;
+  // Number of device reloads executed by the scheduler.
+  uint64_t numReloads = 0;
+  // Worst observed delay (seconds) between a reload being due
+  // and it being executed.
+  time_t maxReloadDelay = 0;
+  // Time of the next scheduled reload. 0 if nothing is scheduled.
+  time_t nextReloadTime = 0;
+  // Number of completed full scans.
+  uint64_t numFullScans = 0;
+  // Duration of the last completed full scan.
+  uint64_t lastFullScanDurationMs = 0;
+  // Number of probes issued by the last completed full scan.
+  uint64_t lastFullScanProbes = 0;
+  // Number of devices discovered on the interface.
+  size_t numDevices = 0;
+  // Memory used by the register history of the devices.
+  size_t historyBytes = 0;
+  // Number of devices recovered from the device cache at start.
+  size_t numWarmStartDevices = 0;
+};
+void to_json(nlohmann::json& j, const InterfaceStats& m);
+
+// Device discovered by a previous instance of rackmond. These are
+// persisted so a restart can verify and monitor them right away
+// rather than waiting for them to be found by a full scan.
+struct CachedDevice {
+  uint8_t deviceAddress = 0;
+  std::string interface{};
+  std::string deviceType{};
+  uint32_t baudrate = 0;
+  Parity parity = Parity::EVEN;
+};
+void to_json(nlohmann::json& j, const CachedDevice& m);
+void from_json(const nlohmann::json& j, CachedDevice& m);
+
+// Deadline ordered schedule of the device reloads on a single
+// interface. The deadline of each device is the earliest time
+// any of its register spans is due for a reload.
+class ReloadSchedule {
+  using Deadline = std::pair<time_t, uint8_t>;
+  std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>>
+      deadlines_{};
+  std::set<uint8_t> scheduled_{};
+  uint64_t numReloads_ = 0;
+  time_t maxReloadDelay_ = 0;
+  mutable std::mutex mutex_{};
+
+ public:
+  bool isScheduled(uint8_t addr) const {
+    std::unique_lock lock(mutex_);
+    return scheduled_.find(addr) != scheduled_.end();
+  }
+  // Schedule a reload of the device at the given time.
+  void schedule(uint8_t addr, time_t deadline);
+  // Removes and returns all devices which are due at currentTime
+  // in the order of their deadlines.
+  std::vector<Deadline> popDue(time_t currentTime);
+  // Account a reload executed delay seconds past its deadline.
+  void recordReload(time_t delay);
+  // Drop all scheduled reloads.
+  void clear();
+  void getStats(InterfaceStats& stats) const;
+};
+
+// Adapts the probe timeout from the round trip times of successful
+// probes. Modeled after TCP's retransmission timeout estimation:
+// timeout = smoothed RTT + 4 * RTT variance, bounded by [min, max].
+// Until enough samples are collected, the max timeout is used.
+class ProbeTimer {
+  static constexpr ModbusTime kMinTimeout = std::chrono::milliseconds(20);
+  static constexpr int kMinSamples = 3;
+  const ModbusTime maxTimeout_;
+  float srtt_ = 0.0;
+  float rttvar_ = 0.0;
+  int numSamples_ = 0;
+
+ public:
+  explicit ProbeTimer(ModbusTime maxTimeout) : maxTimeout_(maxTimeout) {}
+  // Account for a successful probe which took rtt.
+  void record(ModbusTime rtt);
+  // Returns the timeout to use for the next probe.
+  ModbusTime timeout() const;
+};
+
+// Tracks the register values last reported to a subscriber and
+// reduces the device data to what changed since. Numeric values
+// are only reported once they move by at least the threshold
+// from the last reported value.
+class ValueChangeTracker {
+  const float threshold_;
+  std::map<std::pair<uint8_t, uint16_t>, RegisterValue> lastReported_{};
+  std::map<uint8_t, ModbusDeviceMode> lastMode_{};
+  bool changed(const RegisterValue& prev, const RegisterValue& curr) const;
+
+ public:
+  explicit ValueChangeTracker(float threshold = 0.0) : threshold_(threshold) {}
+  // Drops the registers which did not change from data (Expects
+  // the latest value only). Returns true if anything is left to
+  // report, a change of the device mode is always reported.
+  bool update(ModbusDeviceValueData& data);
+};
+
 class Rackmon {
   static constexpr int kScanNumRetry = 3;
   static constexpr time_t kDormantMinInactiveTime = 300;
   static constexpr ModbusTime kProbeTimeout = std::chrono::milliseconds(70);
+  static constexpr int kDeviceCacheVersion = 1;
+
+  // State of a single interface. Each interface is monitored and scanned
+  // by its own pair of threads so busses are polled concurrently.
+  struct InterfaceState {
+    Modbus& interface;
+    // Reload schedule of devices discovered on this interface.
+    ReloadSchedule schedule{};
+    // Index in allPossibleDevAddrs_ of the next address to probe.
+    size_t nextDeviceToProbe = 0;
+    // As an optimization, devices are normally scanned one by one
+    // This allows someone to initiate a forced full scan.
+    // This mimicks a restart of rackmond.
+    std::atomic<bool> reqForceScan = true;
+    // Probe timeouts adapted to the bus, one per baudrate.
+    std::map<uint32_t, ProbeTimer> probeTimers{};
+    // Full scan metrics.
+    std::atomic<uint64_t> numFullScans = 0;
+    std::atomic<uint64_t> lastFullScanDurationMs = 0;
+    std::atomic<uint64_t> lastFullScanProbes = 0;
+    // Devices from the device cache yet to be verified.
+    std::vector<CachedDevice> cachedDevices{};
+    std::atomic<size_t> numWarmStartDevices = 0;
+    std::shared_ptr<PollThread<Rackmon>> monitorThread{};
+    std::shared_ptr<PollThread<Rackmon>> scanThread{};
+    explicit InterfaceState(Modbus& iface) : interface(iface) {}
+  };
+
   std::shared_mutex threadMutex_{};
-  std::shared_ptr<PollThread<Rackmon>> monitorThread_;
-  std::shared_ptr<PollThread<Rackmon>> scanThread_;
+  // True when the monitor/scan threads are running.
+  bool started_ = false;
   // Has to be before defining active or dormant devices
   // to ensure users get destroyed before the interface.
   std::vector<std::unique_ptr<Modbus>> interfaces_{};
+  std::vector<std::unique_ptr<InterfaceState>> interfaceStates_{};
   RegisterMapDatabase registerMapDB_{};
 
+  // Protects devices_. Devices are only ever added to devices_
+  // (Never removed or replaced) while the threads are running.
+  // Hence, workers may hold on to a device after dropping the
+  // lock. This keeps the lock from being held across bus
+  // transactions so interfaces do not contend with each other.
   mutable std::shared_mutex devicesMutex_{};
 
   // These devices discovered on actively monitored busses
@@ -38,33 +181,66 @@ class Rackmon {
   // loaded register maps. A majority of these are not expected
   // to exist, but are candidates for a scan.
   std::vector<uint8_t> allPossibleDevAddrs_{};
-  std::vector<uint8_t>::iterator nextDeviceToProbe_{};
 
-  // As an optimization, devices are normally scanned one by one
-  // This allows someone to initiate a forced full scan.
-  // This mimicks a restart of rackmond.
-  std::atomic<bool> reqForceScan_ = true;
+  // Addresses which have responded on any interface. These are
+  // the most likely to be present and are probed first.
+  mutable std::mutex seenAddrsMutex_{};
+  std::set<uint8_t> seenAddrs_{};
 
   // Timestamps of last scan
-  time_t lastScanTime_;
-  time_t lastMonitorTime_;
-
-  // Interval at which we will monitor all the discovered
-  // devices.
+  std::atomic<time_t> lastScanTime_ = 0;
+  std::atomic<time_t> lastMonitorTime_ = 0;
+
+  // Incremented every time registers are reloaded. Allows for
+  // subscribers to wait for new values instead of polling.
+  std::mutex reloadMutex_{};
+  std::condition_variable reloadCond_{};
+  uint64_t reloadGeneration_ = 0;
+  void notifyReload();
+
+  // File the discovered devices are persisted to. Empty if the
+  // device cache is disabled.
+  std::string deviceCachePath_{};
+  std::mutex deviceCacheMutex_{};
+
+  // Minimum interval of all registers. Devices with registers which
+  // failed to reload are retried after this interval.
   PollThreadTime monitorInterval_ = std::chrono::minutes(3);
 
-  // Probe an interface for the presence of the address.
-  bool probe(Modbus& interface, uint8_t addr);
+  // Resolution of the monitor schedule. The monitor thread wakes up
+  // at this interval to reload devices whose deadline has passed.
+  static constexpr PollThreadTime kMonitorScheduleTick =
+      std::chrono::seconds(1);
+
+  // Probe an interface for the presence of the address. A fast
+  // probe uses the timeout adapted to the interface instead of
+  // kProbeTimeout.
+  bool probe(InterfaceState& state, uint8_t addr, bool fast = false);
 
-  // Probe for the presence of an address
-  bool probe(uint8_t addr);
+  // Probe an interface for the presence of the address with the
+  // given register map.
+  bool probe(
+      InterfaceState& state,
+      uint8_t addr,
+      const RegisterMap& rmap,
+      ModbusTime timeout);
+
+  // Returns the unique scan candidates ordered by the likelihood
+  // of a device being present at the address.
+  std::vector<uint8_t> getScanOrder() const;
 
   // --------- Private Methods --------
 
+  // Returns the devices discovered on the given interface.
+  std::map<uint8_t, ModbusDevice*> getDevices(const Modbus& interface) const;
+
+  // Returns all discovered devices.
+  std::map<uint8_t, ModbusDevice*> getDevices() const;
+
   // probe dormant devices and return recovered devices.
-  std::vector<uint8_t> inspectDormant();
+  std::vector<ModbusDevice*> inspectDormant(const Modbus& interface);
   // Try and recover dormant devices.
-  void recoverDormant();
+  void recoverDormant(const Modbus& interface);
 
   virtual time_t getTime() {
     return std::time(nullptr);
@@ -72,32 +248,39 @@ class Rackmon {
 
   bool isDeviceKnown(uint8_t);
 
-  // Monitor loop. Blocks forever as long as req_stop is true.
-  void monitor();
+  // Monitor loop of an interface. Reloads the devices which are
+  // due as per the reload schedule of the interface.
+  void monitor(InterfaceState& state);
+
+  // Scan all possible devices on the interface. Skips
+  // active/dormant devices.
+  void fullScan(InterfaceState& state);
+
+  // Scan loop of an interface.
+  void scan(InterfaceState& state);
 
-  // Scan all possible devices. Skips active/dormant devices.
-  void fullScan();
+  // Read the device cache and queue the devices for verification
+  // on their interfaces.
+  void loadDeviceCache(const std::string& path);
 
-  // Scan loop. Blocks forever as long as req_stop is true.
-  void scan();
+  // Write out the currently discovered devices to the device cache.
+  void saveDeviceCache();
+
+  // Probe the devices found in the device cache with a single probe
+  // each, before any full scan of the interface.
+  void verifyCachedDevices(InterfaceState& state);
 
  protected:
   // Return the device given address.
   ModbusDevice& getModbusDevice(uint8_t addr);
 
-  PollThread<Rackmon>& getScanThread() {
-    if (!scanThread_) {
-      throw std::runtime_error("Invalid scanThread state");
-    }
-    return *scanThread_;
-  }
+  // Tick the scan threads of all interfaces and wait for them
+  // to complete a pass.
+  void tickScanThreads();
 
-  PollThread<Rackmon>& getMonitorThread() {
-    if (!monitorThread_) {
-      throw std::runtime_error("Invalid monitorThread state");
-    }
-    return *monitorThread_;
-  }
+  // Tick the monitor threads of all interfaces and wait for them
+  // to complete a pass.
+  void tickMonitorThreads();
 
   virtual std::unique_ptr<Modbus> makeInterface() {
     return std::make_unique<Modbus>();
@@ -118,8 +301,13 @@ class Rackmon {
   void loadRegisterMap(const nlohmann::json& config);
 
   // Load configuration, preferable before starting, but can be
-  // done at any time, but this is a one time only.
-  void load(const std::string& confPath, const std::string& regmapDir);
+  // done at any time, but this is a one time only. If provided,
+  // discovered devices are persisted to deviceCachePath and the
+  // devices found there are verified first on start.
+  void load(
+      const std::string& confPath,
+      const std::string& regmapDir,
+      const std::string& deviceCachePath = "");
 
   // Create a worker thread
   virtual std::shared_ptr<PollThread<Rackmon>> makeThread(
@@ -167,9 +355,18 @@ class Rackmon {
   // Get status of devices
   std::vector<ModbusDeviceInfo> listDevices() const;
 
+  // Get the bus utilization and scheduling statistics of
+  // each interface.
+  std::vector<InterfaceStats> getInterfaceStats() const;
+
   // Get monitored data
   void getRawData(std::vector<ModbusDeviceRawData>& data) const;
 
+  // Get monitored data one device at a time. Allows for the caller
+  // to stream out the data without accumulating all of it.
+  void getRawData(
+      const std::function<void(const ModbusDeviceRawData&)>& func) const;
+
   // Get value data
   void getValueData(
       std::vector<ModbusDeviceValueData>& data,
@@ -177,9 +374,23 @@ class Rackmon {
       const ModbusRegisterFilter& regFilter = {},
       bool latestValueOnly = false) const;
 
+  // Get value data one device at a time.
+  void getValueData(
+      const std::function<void(const ModbusDeviceValueData&)>& func,
+      const ModbusDeviceFilter& devFilter = {},
+      const ModbusRegisterFilter& regFilter = {},
+      bool latestValueOnly = false) const;
+
   void reload(
       const ModbusDeviceFilter& devFilter,
       const ModbusRegisterFilter& regFilter);
+
+  // Returns the current reload generation.
+  uint64_t getReloadGeneration();
+
+  // Wait for up to timeout for registers to be reloaded after the
+  // given generation. Returns the current reload generation.
+  uint64_t waitForReload(uint64_t generation, PollThreadTime timeout);
 };
 
 } // namespace rackmon
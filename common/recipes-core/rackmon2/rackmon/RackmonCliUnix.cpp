@@ -1,6 +1,7 @@
 // Copyright 2021-present Facebook. All Rights Reserved.
 #include <CLI/CLI.hpp>
 #include <nlohmann/json.hpp>
+#include "ResponseFormat.h"
 #include "UnixSock.h"
 #if (defined(__llvm__) && (__clang_major__ < 9)) || \
     (!defined(__llvm__) && (__GNUC__ < 8))
@@ -21,6 +22,42 @@ class RackmonClient : public UnixClient {
   RackmonClient() : UnixClient("/var/run/rackmond.sock") {}
 };
 
+// Encoding of the responses requested from rackmond (--encoding).
+static std::string encoding_s = "json";
+
+static json request(json req) {
+  ResponseFormat encoding = json(encoding_s).get<ResponseFormat>();
+  req["format"] = encoding;
+  RackmonClient cli;
+  std::string req_s = req.dump();
+  std::vector<char> resp =
+      cli.request(std::vector<char>(req_s.begin(), req_s.end()));
+  return decodeResponse(resp, encoding);
+}
+
+// Request per-device data streamed one device per frame. func
+// is invoked with the data of each frame. Returns the final frame
+// which contains the status.
+static json request_stream(
+    json req,
+    const std::function<void(json&)>& func) {
+  ResponseFormat encoding = json(encoding_s).get<ResponseFormat>();
+  req["format"] = encoding;
+  req["stream"] = true;
+  json status;
+  RackmonClient cli;
+  cli.request(req.dump(), [&](const std::vector<char>& frame) {
+    json j = decodeResponse(frame, encoding);
+    if (j.contains("status")) {
+      status = j;
+      return false;
+    }
+    func(j["data"]);
+    return true;
+  });
+  return status;
+}
+
 static void print_json(json& j) {
   std::string status;
   json data = j["data"];
@@ -166,6 +203,8 @@ static void print_text(const std::string& req_s, json& j) {
       print_nested(j["data"]);
     else if (req_s == "listModbusDevices")
       print_table(j["data"]);
+    else if (req_s == "getInterfaceStats")
+      print_table(j["data"]);
     else if (req_s == "raw")
       print_hexstring(j["data"]);
   } else {
@@ -187,9 +226,7 @@ do_raw_cmd(const std::string& req_s, int timeout, int resp_len, bool json_fmt) {
   req["response_length"] = resp_len;
   if (timeout != 0)
     req["timeout"] = timeout;
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   if (json_fmt)
     print_json(resp_j);
   else
@@ -210,9 +247,7 @@ static void do_read_cmd(
   if (timeout != 0) {
     req["timeout"] = timeout;
   }
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   if (json_fmt) {
     print_json(resp_j);
     return;
@@ -249,9 +284,7 @@ static void do_read_file_cmd(
   req["records"][0]["fileNum"] = fileNum;
   req["records"][0]["recordNum"] = recordNum;
   req["records"][0]["dataSize"] = dataSize;
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   if (json_fmt) {
     print_json(resp_j);
     return;
@@ -292,9 +325,7 @@ static void do_write_cmd(
   if (timeout != 0) {
     req["timeout"] = timeout;
   }
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   if (json_fmt) {
     print_json(resp_j);
     return;
@@ -307,9 +338,7 @@ static void do_write_cmd(
 static void do_cmd(const std::string& type, bool json_fmt) {
   json req;
   req["type"] = type;
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   if (json_fmt)
     print_json(resp_j);
   else
@@ -323,7 +352,8 @@ static void do_data_cmd(
     std::vector<std::string>& deviceTypeFilter,
     std::vector<int>& regFilter,
     std::vector<std::string>& regNameFilter,
-    bool latestOnly) {
+    bool latestOnly,
+    bool stream) {
   json req;
   req["type"] = type;
   if (deviceFilter.size()) {
@@ -337,15 +367,66 @@ static void do_data_cmd(
     req["filter"]["registerFilter"]["nameFilter"] = regNameFilter;
   }
   req["filter"]["latestValueOnly"] = latestOnly;
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  if (stream) {
+    // Print each device as it is received. With JSON output, each
+    // line is the JSON list of devices received in a frame.
+    json resp_j = request_stream(req, [&](json& data) {
+      if (json_fmt)
+        std::cout << data.dump() << std::endl;
+      else if (type == "getMonitorData")
+        print_value_data(data);
+      else
+        print_nested(data);
+    });
+    std::string status;
+    resp_j.at("status").get_to(status);
+    if (status != "SUCCESS") {
+      std::cerr << "FAILURE: " << status << std::endl;
+      exit(1);
+    }
+    return;
+  }
+  json resp_j = request(req);
   if (json_fmt)
     print_json(resp_j);
   else
     print_text(type, resp_j);
 }
 
+static void do_subscribe_cmd(
+    bool json_fmt,
+    const std::vector<int>& deviceFilter,
+    const std::vector<std::string>& deviceTypeFilter,
+    const std::vector<int>& regFilter,
+    const std::vector<std::string>& regNameFilter,
+    float threshold) {
+  json req;
+  req["type"] = "subscribe";
+  if (deviceFilter.size()) {
+    req["filter"]["deviceFilter"]["addressFilter"] = deviceFilter;
+  } else if (deviceTypeFilter.size()) {
+    req["filter"]["deviceFilter"]["typeFilter"] = deviceTypeFilter;
+  }
+  if (regFilter.size()) {
+    req["filter"]["registerFilter"]["addressFilter"] = regFilter;
+  } else if (regNameFilter.size()) {
+    req["filter"]["registerFilter"]["nameFilter"] = regNameFilter;
+  }
+  req["threshold"] = threshold;
+  // Runs till rackmond goes away or fails the subscription.
+  json resp_j = request_stream(req, [&](json& data) {
+    // Skip heartbeats.
+    if (data.empty())
+      return;
+    if (json_fmt)
+      std::cout << data.dump() << std::endl;
+    else
+      print_value_data(data);
+  });
+  std::cerr << "FAILURE: " << resp_j.value("status", "UNKNOWN") << std::endl;
+  exit(1);
+}
+
 static void do_reload_cmd(
     const std::vector<int>& deviceFilter,
     const std::vector<std::string>& deviceTypeFilter,
@@ -363,18 +444,14 @@ static void do_reload_cmd(
   } else if (regNameFilter.size()) {
     req["filter"]["registerFilter"]["nameFilter"] = regNameFilter;
   }
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   std::cout << resp_j.at("status") << std::endl;
 }
 
 static void do_rackmonstatus() {
   json req;
   req["type"] = "listModbusDevices";
-  RackmonClient cli;
-  std::string resp = cli.request(req.dump());
-  json resp_j = json::parse(resp);
+  json resp_j = request(req);
   for (const auto& ent : resp_j["data"]) {
     std::cout << "PSU addr " << std::hex << std::setw(2) << std::setfill('0')
               << int(ent["devAddress"]);
@@ -402,6 +479,9 @@ int main(int argc, const char** argv) {
   // Allow flags/options to fallthrough from subcommands.
   app.fallthrough();
   app.add_flag("-j,--json", json_fmt, "JSON output instead of text");
+  app.add_option(
+         "--encoding", encoding_s, "Encoding of the responses from rackmond")
+      ->check(CLI::IsMember({"json", "cbor", "msgpack"}));
 
   // Raw command
   int raw_cmd_timeout = 0;
@@ -495,6 +575,11 @@ int main(int argc, const char** argv) {
     do_cmd("listModbusDevices", json_fmt);
   });
 
+  // Interface statistics command
+  app.add_subcommand(
+         "interfaces", "Return bus utilization statistics of each interface")
+      ->callback([&]() { do_cmd("getInterfaceStats", json_fmt); });
+
   // Status command
   app.add_subcommand(
          "legacy_list",
@@ -508,6 +593,7 @@ int main(int argc, const char** argv) {
   std::vector<std::string> deviceTypeFilter{};
   std::vector<std::string> regNameFilter{};
   bool latestOnly = false;
+  bool stream = false;
   auto data = app.add_subcommand("data", "Return detailed monitoring data");
   data->callback([&]() {
     do_data_cmd(
@@ -517,7 +603,8 @@ int main(int argc, const char** argv) {
         deviceTypeFilter,
         regFilter,
         regNameFilter,
-        latestOnly);
+        latestOnly,
+        stream);
   });
   data->add_option("-f,--format", format, "Format the data")
       ->check(CLI::IsMember({"raw", "value"}));
@@ -539,6 +626,8 @@ int main(int argc, const char** argv) {
       "--latest",
       latestOnly,
       "Returns only the latest stored value for a given register");
+  data->add_flag(
+      "--stream", stream, "Receive and print the data one device at a time");
 
   auto reload = app.add_subcommand("reload", "Reload requested registers");
   reload->callback([&]() {
@@ -559,6 +648,37 @@ int main(int argc, const char** argv) {
       regNameFilter,
       "Return values of provided register names only");
 
+  float threshold = 0.0;
+  auto subscribe = app.add_subcommand(
+      "subscribe", "Print register values as they change");
+  subscribe->callback([&]() {
+    do_subscribe_cmd(
+        json_fmt,
+        deviceFilter,
+        deviceTypeFilter,
+        regFilter,
+        regNameFilter,
+        threshold);
+  });
+  subscribe->add_option(
+      "--reg-addr", regFilter, "Return values of provided registers only");
+  subscribe->add_option(
+      "--dev-addr",
+      deviceFilter,
+      "Return values of provided device addresses only");
+  subscribe->add_option(
+      "--dev-type",
+      deviceTypeFilter,
+      "Return values of provided devices of the given type only");
+  subscribe->add_option(
+      "--reg-name",
+      regNameFilter,
+      "Return values of provided register names only");
+  subscribe->add_option(
+      "--threshold",
+      threshold,
+      "Minimum change of numeric values to be reported");
+
   // Pause command
   app.add_subcommand("pause", "Pause monitoring")->callback([&]() {
     do_cmd("pause", json_fmt);
@@ -3,7 +3,9 @@
 #include <sys/file.h>
 #include <unistd.h>
 #include "Log.h"
+#include "MonitorData.h"
 #include "Rackmon.h"
+#include "ResponseFormat.h"
 #include "UnixSock.h"
 
 using nlohmann::json;
@@ -15,10 +17,27 @@ class RackmonUNIXSocketService : public UnixService {
   // The configuration file paths.
   const std::string kRackmonConfigurationPath = "/etc/rackmon.conf";
   const std::string kRackmonRegmapDirPath = "/etc/rackmon.d";
+  // Devices discovered are persisted here for a warm start when
+  // rackmond is restarted. Not kept across reboots on purpose.
+  const std::string kRackmonDeviceCachePath = "/tmp/rackmond_devices.json";
+  // Default interval at which an idle subscription is sent an
+  // empty update to detect clients which have gone away.
+  static constexpr int kSubscribeHeartbeatInterval = 10;
   Rackmon rackmond_{};
 
-  // Handle commands with the JSON format.
-  void executeJSONCommand(const json& req, json& resp);
+  // Stream the register values which changed after each reload
+  // till the client disconnects.
+  void subscribe(
+      const json& req,
+      const std::function<void(const json&)>& streamFrame);
+
+  // Handle commands with the JSON format. If streamFrame is provided,
+  // commands returning per-device data send each device as its own
+  // frame instead of accumulating it in resp.
+  void executeJSONCommand(
+      const json& req,
+      json& resp,
+      const std::function<void(const json&)>& streamFrame = nullptr);
   void handleJSONCommand(
       std::unique_ptr<json> reqPtr,
       std::unique_ptr<UnixSock> cli);
@@ -36,37 +55,55 @@ class RackmonUNIXSocketService : public UnixService {
   void deinitialize() override;
 };
 
-struct ModbusDataFilter {
-  ModbusDeviceFilter devFilter{};
-  ModbusRegisterFilter regFilter{};
-  bool latestValueOnly = false;
+// Thrown when a streamed frame could not be sent to the client.
+struct ClientDisconnected : public std::runtime_error {
+  explicit ClientDisconnected(const std::string& what)
+      : std::runtime_error(what) {}
 };
 
-void from_json(const json& filter, ModbusDataFilter& out) {
-  if (filter.contains("deviceFilter")) {
-    const json& jdevFilter = filter["deviceFilter"];
-    if (jdevFilter.contains("addressFilter")) {
-      out.devFilter.addrFilter = jdevFilter["addressFilter"];
-    } else if (jdevFilter.contains("typeFilter")) {
-      out.devFilter.typeFilter = jdevFilter["typeFilter"];
-    } else {
-      throw std::logic_error("Device Filter needs at least one set");
-    }
+void RackmonUNIXSocketService::subscribe(
+    const json& req,
+    const std::function<void(const json&)>& streamFrame) {
+  ModbusDataFilter filter{};
+  if (req.contains("filter")) {
+    filter = req["filter"];
   }
-  if (filter.contains("registerFilter")) {
-    const json& jregFilter = filter["registerFilter"];
-    if (jregFilter.contains("addressFilter")) {
-      out.regFilter.addrFilter = jregFilter["addressFilter"];
-    } else if (jregFilter.contains("nameFilter")) {
-      out.regFilter.nameFilter = jregFilter["nameFilter"];
-    } else {
-      throw std::logic_error("Register Filter needs at least one set");
+  ValueChangeTracker tracker(req.value("threshold", 0.0f));
+  PollThreadTime heartbeat(
+      req.value("heartbeatInterval", kSubscribeHeartbeatInterval));
+  if (heartbeat.count() <= 0) {
+    throw std::logic_error("heartbeatInterval needs to be positive");
+  }
+  uint64_t generation = rackmond_.getReloadGeneration();
+  // The first update carries all the selected registers, the
+  // following ones only what changed.
+  while (true) {
+    json frame = {{"generation", generation}, {"data", json::array()}};
+    rackmond_.getValueData(
+        [&tracker, &frame](const ModbusDeviceValueData& dev) {
+          ModbusDeviceValueData delta = dev;
+          if (tracker.update(delta)) {
+            frame["data"].push_back(delta);
+          }
+        },
+        filter.devFilter,
+        filter.regFilter,
+        true);
+    if (!frame["data"].empty()) {
+      streamFrame(frame);
     }
+    uint64_t next = rackmond_.waitForReload(generation, heartbeat);
+    if (next == generation) {
+      streamFrame({{"generation", generation}, {"data", json::array()}});
+    }
+    generation = next;
   }
-  out.latestValueOnly = filter.value("latestValueOnly", false);
 }
 
-void RackmonUNIXSocketService::executeJSONCommand(const json& req, json& resp) {
+void RackmonUNIXSocketService::executeJSONCommand(
+    const json& req,
+    json& resp,
+    const std::function<void(const json&)>& streamFrame) {
   std::string cmd;
   req.at("type").get_to(cmd);
   if (cmd == "raw") {
@@ -83,6 +120,8 @@ void RackmonUNIXSocketService::executeJSONCommand(const json& req, json& resp) {
     }
   } else if (cmd == "listModbusDevices") {
     resp["data"] = rackmond_.listDevices();
+  } else if (cmd == "getInterfaceStats") {
+    resp["data"] = rackmond_.getInterfaceStats();
 
   } else if (cmd == "readHoldingRegisters") {
     uint8_t devAddress = req["devAddress"];
@@ -111,9 +150,15 @@ void RackmonUNIXSocketService::executeJSONCommand(const json& req, json& resp) {
     rackmond_.readFileRecord(devAddress, records, timeout);
     resp["data"] = records;
   } else if (cmd == "getMonitorDataRaw") {
-    std::vector<ModbusDeviceRawData> ret;
-    rackmond_.getRawData(ret);
-    resp["data"] = ret;
+    if (streamFrame) {
+      rackmond_.getRawData([&streamFrame](const ModbusDeviceRawData& dev) {
+        streamFrame({{"data", json::array({dev})}});
+      });
+    } else {
+      std::vector<ModbusDeviceRawData> ret;
+      rackmond_.getRawData(ret);
+      resp["data"] = ret;
+    }
   } else if (cmd == "pause") {
     rackmond_.stop();
   } else if (cmd == "resume") {
@@ -121,14 +166,12 @@ void RackmonUNIXSocketService::executeJSONCommand(const json& req, json& resp) {
   } else if (cmd == "rescan") {
     rackmond_.forceScan();
   } else if (cmd == "getMonitorData") {
-    ModbusDataFilter filter{};
-    if (req.contains("filter")) {
-      filter = req["filter"];
+    getMonitorData(rackmond_, req, resp, streamFrame);
+  } else if (cmd == "subscribe") {
+    if (!streamFrame) {
+      throw std::logic_error("subscribe requires a streamed response");
     }
-    std::vector<ModbusDeviceValueData> ret;
-    rackmond_.getValueData(
-        ret, filter.devFilter, filter.regFilter, filter.latestValueOnly);
-    resp["data"] = ret;
+    subscribe(req, streamFrame);
   } else if (cmd == "reloadRegisters") {
     ModbusDataFilter filter{};
     if (req.contains("filter")) {
@@ -162,13 +205,33 @@ void RackmonUNIXSocketService::handleJSONCommand(
              << std::endl;
   };
   json resp;
+  // Unknown formats fall back to JSON.
+  ResponseFormat format = req.value("format", ResponseFormat::JSON);
+  // Clients opting in to streaming get the per-device data as
+  // individual frames, followed by a final frame with the status.
+  // Subscriptions are always streamed.
+  std::function<void(const json&)> streamFrame = nullptr;
+  if (req.value("stream", false) || req["type"] == "subscribe") {
+    streamFrame = [&cli, format](const json& frame) {
+      try {
+        cli->send(encodeResponse(frame, format));
+      } catch (std::system_error& e) {
+        throw ClientDisconnected(e.what());
+      }
+    };
+  }
 
   // Handle the JSON command and this is where all the
   // exceptions we have been ignoring all the way from
   // Device to Rackmon is going to come to roost. Convert
   // each exception to an error code.
   try {
-    executeJSONCommand(req, resp);
+    executeJSONCommand(req, resp, streamFrame);
+  } catch (ClientDisconnected& e) {
+    // Nobody to send the status to.
+    logInfo << "Client of " << req["type"] << " went away: " << e.what()
+            << std::endl;
+    return;
   } catch (CRCError& e) {
     resp["status"] = "ERR_BAD_CRC";
     print_msg(e);
@@ -195,9 +258,7 @@ void RackmonUNIXSocketService::handleJSONCommand(
   }
 
   try {
-    std::string resp_s =
-        resp.dump(-1, ' ', false, json::error_handler_t::replace);
-    cli->send(resp_s.c_str(), resp_s.length());
+    cli->send(encodeResponse(resp, format));
   } catch (std::exception& e) {
     logError << "Unable to send response: " << e.what() << std::endl;
   }
@@ -205,7 +266,10 @@ void RackmonUNIXSocketService::handleJSONCommand(
 
 void RackmonUNIXSocketService::initialize(int argc, char** argv) {
   logInfo << "Loading configuration" << std::endl;
-  rackmond_.load(kRackmonConfigurationPath, kRackmonRegmapDirPath);
+  rackmond_.load(
+      kRackmonConfigurationPath,
+      kRackmonRegmapDirPath,
+      kRackmonDeviceCachePath);
   logInfo << "Starting rackmon threads" << std::endl;
   rackmond_.start();
   UnixService::initialize(argc, argv);
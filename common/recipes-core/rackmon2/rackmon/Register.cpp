@@ -192,12 +192,16 @@ Register::operator RegisterValue() const {
 }
 
 RegisterStore::RegisterStore(const RegisterDescriptor& desc)
-    : desc_(desc), regAddr_(desc.begin), history_(desc.keep, Register(desc)) {}
+    : desc_(desc),
+      regAddr_(desc.begin),
+      timestamps_(desc.keep, 0),
+      words_(size_t(desc.keep) * desc.length, 0) {}
 
 RegisterStore::RegisterStore(const RegisterStore& other)
     : desc_(other.desc_), regAddr_(other.regAddr_) {
   std::unique_lock lk(other.historyMutex_);
-  history_ = other.history_;
+  timestamps_ = other.timestamps_;
+  words_ = other.words_;
   enabled_ = other.enabled_;
   idx_ = other.idx_;
 }
@@ -222,44 +226,61 @@ std::vector<uint16_t>::iterator RegisterStore::setRegister(
     std::vector<uint16_t>::iterator end,
     time_t reloadTime) {
   std::unique_lock lk(historyMutex_);
-  auto& reg = front();
-  size_t size = reg.value.size();
-  if ((reg.value.size() + start) > end) {
+  size_t size = desc_.length;
+  if ((start + size) > end) {
     throw std::out_of_range("Source not large enough to set register");
   }
-  std::copy(start, start + size, reg.value.begin());
-  reg.timestamp = reloadTime;
+  std::copy(start, start + size, words_.begin() + idx_ * size);
+  timestamps_[idx_] = reloadTime;
   ++(*this);
   return start + size;
 }
 
-Register& RegisterStore::back() {
+Register RegisterStore::at(size_t slot) const {
+  Register reg(desc_);
+  auto begin = words_.begin() + slot * desc_.length;
+  std::copy(begin, begin + desc_.length, reg.value.begin());
+  reg.timestamp = timestamps_[slot];
+  return reg;
+}
+
+Register RegisterStore::back() const {
   std::unique_lock lk(historyMutex_);
-  return idx_ == 0 ? history_.back() : history_[idx_ - 1];
+  return at(backSlot());
 }
 
-const Register& RegisterStore::back() const {
+uint32_t RegisterStore::backTimestamp() const {
   std::unique_lock lk(historyMutex_);
-  return idx_ == 0 ? history_.back() : history_[idx_ - 1];
+  return timestamps_[backSlot()];
 }
 
-Register& RegisterStore::front() {
+Register RegisterStore::front() const {
   std::unique_lock lk(historyMutex_);
-  return history_[idx_];
+  return at(idx_);
 }
 
 void RegisterStore::operator++() {
   std::unique_lock lk(historyMutex_);
-  idx_ = (idx_ + 1) % history_.size();
+  idx_ = (idx_ + 1) % timestamps_.size();
+}
+
+size_t RegisterStore::memoryUsage() const {
+  std::unique_lock lk(historyMutex_);
+  return sizeof(*this) + timestamps_.capacity() * sizeof(uint32_t) +
+      words_.capacity() * sizeof(uint16_t);
 }
 
 RegisterStore::operator RegisterStoreValue() const {
   std::unique_lock lk(historyMutex_);
   RegisterStoreValue ret(regAddr_, desc_.name);
-  for (const auto& reg : history_) {
-    if (reg) {
-      ret.history.emplace_back(reg);
+  std::vector<uint16_t> value(desc_.length);
+  for (size_t slot = 0; slot < timestamps_.size(); slot++) {
+    if (timestamps_[slot] == 0) {
+      continue;
     }
+    auto begin = words_.begin() + slot * desc_.length;
+    std::copy(begin, begin + desc_.length, value.begin());
+    ret.history.emplace_back(value, desc_, timestamps_[slot]);
   }
   return ret;
 }
@@ -269,7 +290,7 @@ RegisterStoreSpan::RegisterStoreSpan(RegisterStore* reg)
       interval_(reg->interval()),
       span_(reg->length(), 0),
       registers_{reg},
-      timestamp_(reg->back().timestamp) {}
+      timestamp_(reg->backTimestamp()) {}
 
 bool RegisterStoreSpan::addRegister(RegisterStore* reg, size_t maxSpanLength) {
   if (reg->interval() != interval_) {
@@ -290,6 +311,14 @@ bool RegisterStoreSpan::reloadPending(time_t currentTime) {
   return timestamp_ == 0 || (timestamp_ + interval_) <= currentTime;
 }
 
+void RegisterStoreSpan::advanceReload(time_t offset) {
+  if (timestamp_ == 0) {
+    // Already due.
+    return;
+  }
+  timestamp_ -= std::min(offset, interval_);
+}
+
 std::vector<uint16_t>& RegisterStoreSpan::beginReloadSpan() {
   return span_;
 }
@@ -391,10 +420,6 @@ NLOHMANN_JSON_SERIALIZE_ENUM(
         {RegisterValueType::LONG, "LONG"},
     })
 
-NLOHMANN_JSON_SERIALIZE_ENUM(
-    Parity,
-    {{Parity::EVEN, "EVEN"}, {Parity::ODD, "ODD"}, {Parity::NONE, "NONE"}})
-
 void from_json(const json& j, RegisterDescriptor& i) {
   j.at("begin").get_to(i.begin);
   j.at("length").get_to(i.length);
@@ -479,9 +504,9 @@ void to_json(json& j, const RegisterStore& m) {
   std::unique_lock lk(m.historyMutex_);
   j["begin"] = m.regAddr_;
   j["readings"] = {};
-  for (const auto& reg : m.history_) {
-    if (reg) {
-      j["readings"].emplace_back(reg);
+  for (size_t slot = 0; slot < m.timestamps_.size(); slot++) {
+    if (m.timestamps_[slot] != 0) {
+      j["readings"].emplace_back(m.at(slot));
     }
   }
 }
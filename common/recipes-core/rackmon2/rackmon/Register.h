@@ -188,15 +188,26 @@ struct RegisterStore {
   // Address of the register.
   uint16_t regAddr_;
   // History of the register contents to keep. This is utilized as
-  // a circular buffer with idx pointing to the current slot to
-  // write.
-  std::vector<Register> history_;
+  // a fixed capacity circular buffer with idx pointing to the current
+  // slot to write. The samples are stored as a struct of arrays:
+  // timestamps_ holds the timestamp of each slot and words_ holds
+  // the contents of slot i at [i * length, (i + 1) * length). Thus
+  // storing a sample never allocates.
+  std::vector<uint32_t> timestamps_;
+  std::vector<uint16_t> words_;
   int32_t idx_ = 0;
   mutable std::recursive_mutex historyMutex_{};
   // Allows for us to disable individual registers if the device
   // does not support it.
   bool enabled_ = true;
 
+  // Materializes the sample at the given slot.
+  Register at(size_t slot) const;
+  // Returns the slot of the last written value.
+  size_t backSlot() const {
+    return idx_ == 0 ? timestamps_.size() - 1 : idx_ - 1;
+  }
+
  public:
   explicit RegisterStore(const RegisterDescriptor& desc);
   RegisterStore(const RegisterStore& other);
@@ -206,17 +217,20 @@ struct RegisterStore {
   void disable();
   void enable();
 
+  // Stores the value at front, and advances the front.
   std::vector<uint16_t>::iterator setRegister(
       std::vector<uint16_t>::iterator start,
       std::vector<uint16_t>::iterator end,
       time_t reloadTime = std::time(nullptr));
 
-  // Returns a reference to the last written value (Back of the list)
-  Register& back();
-  const Register& back() const;
+  // Returns a copy of the last written value (Back of the list)
+  Register back() const;
 
-  // Returns the front (Next to write) reference
-  Register& front();
+  // Returns the timestamp of the last written value.
+  uint32_t backTimestamp() const;
+
+  // Returns a copy of the front (Next to write)
+  Register front() const;
 
   // Advances the front.
   void operator++();
@@ -242,6 +256,9 @@ struct RegisterStore {
     return desc_.interval;
   }
 
+  // Returns the number of bytes used by this store and its history.
+  size_t memoryUsage() const;
+
   // Returns a string formatted representation of the historical record.
   operator std::string() const;
 
@@ -276,6 +293,17 @@ class RegisterStoreSpan {
     return span_.size();
   }
   bool reloadPending(time_t currentTime);
+  // Returns the time at which the span is next due for a reload.
+  time_t nextReloadTime() const {
+    return timestamp_ + interval_;
+  }
+  // Pulls the next reload of the span ahead by offset seconds (Bounded
+  // by the interval). Used to spread out reloads of spans which were
+  // all read at the same time.
+  void advanceReload(time_t offset);
+  time_t interval() const {
+    return interval_;
+  }
   static bool buildRegisterSpanList(
       std::vector<RegisterStoreSpan>& list,
       RegisterStore& reg,
@@ -313,6 +341,10 @@ struct AddrRange {
   bool contains(uint8_t) const;
 };
 
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    Parity,
+    {{Parity::EVEN, "EVEN"}, {Parity::ODD, "ODD"}, {Parity::NONE, "NONE"}})
+
 // Container of an entire register map. This is the memory
 // representation of each JSON register map descriptors
 // at /etc/rackmon.d.
@@ -0,0 +1,48 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#pragma once
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+namespace rackmonsvc {
+
+// Encoding of the responses sent on the UNIX socket. Requests are
+// always JSON, the client requests the encoding of the response
+// with the "format" field of the request (Defaults to JSON).
+enum class ResponseFormat { JSON, CBOR, MSGPACK };
+
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    ResponseFormat,
+    {{ResponseFormat::JSON, "json"},
+     {ResponseFormat::CBOR, "cbor"},
+     {ResponseFormat::MSGPACK, "msgpack"}})
+
+inline std::vector<char> encodeResponse(
+    const nlohmann::json& j,
+    ResponseFormat format) {
+  if (format == ResponseFormat::CBOR) {
+    std::vector<char> ret{};
+    nlohmann::json::to_cbor(j, ret);
+    return ret;
+  } else if (format == ResponseFormat::MSGPACK) {
+    std::vector<char> ret{};
+    nlohmann::json::to_msgpack(j, ret);
+    return ret;
+  }
+  std::string s =
+      j.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+  return std::vector<char>(s.begin(), s.end());
+}
+
+inline nlohmann::json decodeResponse(
+    const std::vector<char>& buf,
+    ResponseFormat format) {
+  if (format == ResponseFormat::CBOR) {
+    return nlohmann::json::from_cbor(buf);
+  } else if (format == ResponseFormat::MSGPACK) {
+    return nlohmann::json::from_msgpack(buf);
+  }
+  return nlohmann::json::parse(buf);
+}
+
+} // namespace rackmonsvc
@@ -5,6 +5,7 @@
 #include <unistd.h>
 #include <atomic>
 #include <cstring>
+#include <functional>
 #include <list>
 #include <memory>
 #include <mutex>
@@ -109,6 +110,17 @@ class UnixClient {
     sock_.recv(resp);
     return resp;
   }
+  // Send the request and receive a response streamed as multiple
+  // frames. func is invoked with each frame till it returns false.
+  void request(
+      const std::string& req,
+      const std::function<bool(const std::vector<char>&)>& func) {
+    sock_.send(req.data(), req.size());
+    std::vector<char> frame;
+    do {
+      sock_.recv(frame);
+    } while (func(frame));
+  }
 };
 
 } // namespace rackmonsvc
@@ -149,14 +149,29 @@ class RackmonInterface:
         return {"type": "listModbusDevices"}
 
     @classmethod
-    def _data(cls, raw, dataFilter=None):
+    def _data(cls, raw, dataFilter=None, stream=False):
         if raw:
-            return {"type": "getMonitorDataRaw"}
-        req = {"type": "getMonitorData"}
-        if dataFilter is not None:
-            req = {**req, **dataFilter}
+            req = {"type": "getMonitorDataRaw"}
+        else:
+            req = {"type": "getMonitorData"}
+            if dataFilter is not None:
+                req = {**req, **dataFilter}
+        if stream:
+            req["stream"] = True
         return req
 
+    @classmethod
+    def _collect(cls, frames):
+        # Streamed responses carry the data of a device per frame
+        # followed by a final frame with the status.
+        data = []
+        for frame in frames:
+            if "status" in frame:
+                frame["data"] = data
+                return frame
+            data += frame["data"]
+        raise ModbusUnknownError()
+
     @classmethod
     def _reload(cls, dataFilter, sync):
         req = {"type": "reloadRegisters"}
@@ -197,16 +212,17 @@ class RackmonInterface:
         return out if len(out) > 1 else out[0]
 
     @classmethod
-    def _execute(cls, cmd, decodeJson=True):
+    def _frames(cls, cmd, timeout=30):
+        # Send the request and yield each frame of the response
+        # till the caller stops iterating.
         request = json.dumps(cmd).encode()
         if not os.path.exists("/var/run/rackmond.sock"):
             raise ModbusException()
         client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
-        client.settimeout(30)
+        client.settimeout(timeout)
         client.connect("/var/run/rackmond.sock")
         req_header = struct.pack("@L", len(request))
         client.sendall(req_header + request)
-        response = bytes()
 
         def recvExact(num):
             data = bytes()
@@ -223,13 +239,47 @@ class RackmonInterface:
                 data += chunk
             return data
 
-        (data_len,) = struct.unpack("@L", recvExact(4))
-        response = recvExact(data_len)
-        client.close()
+        try:
+            while True:
+                (data_len,) = struct.unpack("@L", recvExact(4))
+                yield recvExact(data_len)
+        finally:
+            client.close()
+
+    @classmethod
+    def _execute(cls, cmd, decodeJson=True):
+        frames = cls._frames(cmd)
+        try:
+            if decodeJson and cmd.get("stream", False):
+                return cls._collect(json.loads(f.decode()) for f in frames)
+            response = next(frames)
+        finally:
+            frames.close()
         if decodeJson:
             return json.loads(response.decode())
         return response.decode()
 
+    @classmethod
+    def _subscribe(cls, dataFilter, threshold, heartbeat):
+        req = {"type": "subscribe", "heartbeatInterval": heartbeat}
+        if dataFilter is not None:
+            req = {**req, **dataFilter}
+        if threshold > 0:
+            req["threshold"] = threshold
+        return req
+
+    @classmethod
+    def _updates(cls, frames):
+        # Subscriptions stream a frame with the devices which changed
+        # after each reload. Frames with no data are heartbeats. A
+        # frame with a status ends the subscription.
+        for frame in frames:
+            if "status" in frame:
+                cls._check(frame)
+                raise ModbusUnknownError()
+            if len(frame["data"]) > 0:
+                yield frame["data"]
+
     @classmethod
     def _do(cls, f, *args, **kwargs):
         cmd = f(*args, **kwargs)
@@ -261,13 +311,27 @@ class RackmonInterface:
         return result["data"]
 
     @classmethod
-    def data(cls, raw=True, dataFilter=None, decodeJson=True):
+    def data(cls, raw=True, dataFilter=None, decodeJson=True, stream=False):
         if decodeJson:
-            result = cls._do(cls._data, raw, dataFilter)
+            result = cls._do(cls._data, raw, dataFilter, stream)
             return result["data"]
         cmd = cls._data(raw, dataFilter)
         return cls._execute(cmd, False)
 
+    @classmethod
+    def subscribe(cls, dataFilter=None, threshold=0, heartbeat=10):
+        """
+        Generator of the devices with the registers whose value changed
+        since the previous update. The first update contains all the
+        registers selected by the filter.
+        """
+        cmd = cls._subscribe(dataFilter, threshold, heartbeat)
+        frames = cls._frames(cmd, 3 * heartbeat)
+        try:
+            yield from cls._updates(json.loads(f.decode()) for f in frames)
+        finally:
+            frames.close()
+
     @classmethod
     def get(cls, dev, reg, reload=False):
         dataFilter = cls._register_filter(dev, reg)
@@ -336,13 +400,27 @@ class RackmonAsyncInterface(RackmonInterface):
         return result["data"]
 
     @classmethod
-    async def data(cls, raw=True, dataFilter=None, decodeJson=True):
+    async def data(cls, raw=True, dataFilter=None, decodeJson=True, stream=False):
         if decodeJson:
-            result = await cls._do(cls._data, raw, dataFilter)
+            result = await cls._do(cls._data, raw, dataFilter, stream)
             return result["data"]
         cmd = cls._data(raw, dataFilter)
         return await cls._execute(cmd, False)
 
+    @classmethod
+    async def subscribe(cls, dataFilter=None, threshold=0, heartbeat=10):
+        # Drive the blocking subscription from the executor.
+        loop = asyncio.get_event_loop()
+        updates = RackmonInterface.subscribe(dataFilter, threshold, heartbeat)
+        try:
+            while True:
+                data = await loop.run_in_executor(None, next, updates, None)
+                if data is None:
+                    return
+                yield data
+        finally:
+            updates.close()
+
     @classmethod
     async def get(cls, dev, reg, reload=False):
         dataFilter = cls._register_filter(dev, reg)
@@ -2,6 +2,7 @@
 #include "Modbus.h"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 using namespace std;
 using namespace testing;
@@ -221,3 +222,56 @@ TEST_F(ModbusTest, TestFlakyIntfRecover) {
   bus.tick(); // T4
   ASSERT_TRUE(bus.isPresent());
 }
+
+TEST(BusArbiterTest, InteractivePreemptsBackground) {
+  BusArbiter arbiter;
+  std::mutex mutex;
+  std::vector<int> order;
+  auto transaction = [&](int id, ModbusPriority prio) {
+    arbiter.acquire(prio);
+    {
+      std::unique_lock lk(mutex);
+      order.push_back(id);
+    }
+    arbiter.release();
+  };
+  auto waitForWaiters = [&arbiter](size_t num) {
+    while (arbiter.numWaiters() != num) {
+      std::this_thread::yield();
+    }
+  };
+  // Hold the bus while the others queue up.
+  arbiter.acquire(ModbusPriority::BACKGROUND);
+  std::thread t1(transaction, 1, ModbusPriority::BACKGROUND);
+  waitForWaiters(1);
+  std::thread t2(transaction, 2, ModbusPriority::BACKGROUND);
+  waitForWaiters(2);
+  std::thread t3(transaction, 3, ModbusPriority::INTERACTIVE);
+  waitForWaiters(3);
+  arbiter.release();
+  t1.join();
+  t2.join();
+  t3.join();
+  // Interactive goes first, background in the order of arrival.
+  ASSERT_EQ(order, std::vector<int>({3, 1, 2}));
+}
+
+TEST(BusArbiterTest, HoldOff) {
+  BusArbiter arbiter;
+  arbiter.acquire(ModbusPriority::BACKGROUND);
+  arbiter.release(std::chrono::milliseconds(50));
+  auto start = std::chrono::steady_clock::now();
+  arbiter.acquire(ModbusPriority::INTERACTIVE);
+  ASSERT_GE(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(45));
+  arbiter.release();
+}
+
+TEST(ModbusPriorityScopeTest, Nesting) {
+  ASSERT_EQ(ModbusPriorityScope::current(), ModbusPriority::BACKGROUND);
+  {
+    ModbusPriorityScope scope(ModbusPriority::INTERACTIVE);
+    ASSERT_EQ(ModbusPriorityScope::current(), ModbusPriority::INTERACTIVE);
+  }
+  ASSERT_EQ(ModbusPriorityScope::current(), ModbusPriority::BACKGROUND);
+}
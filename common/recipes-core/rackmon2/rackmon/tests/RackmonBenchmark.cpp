@@ -0,0 +1,266 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include "MonitorData.h"
+#include "Rackmon.h"
+#include "ResponseFormat.h"
+#include "SimulatedBus.h"
+#include "TempDir.h"
+#include "UnixSock.h"
+
+using namespace std::literals;
+using namespace rackmon;
+using namespace rackmonsvc;
+using nlohmann::json;
+
+// End to end benchmarks of rackmon against a simulated RS485 bus
+// (SimulatedBus). Environment:
+//   RACKMON_REGMAP_DIR: Register maps to benchmark (/etc/rackmon.d).
+//   RACKMON_BENCH_REGMAP: Register map of the simulated devices
+//     (orv3_psu.json).
+//   RACKMON_BENCH_DEVICES: Number of simulated devices (128).
+//   RACKMON_BENCH_LINE_TIME: If set, the simulated devices take as
+//     long to respond as a real bus would.
+
+namespace {
+
+constexpr int kNumLatencySamples = 10;
+constexpr int kNumSweeps = 3;
+constexpr uint8_t kFirstDeviceAddress = 128;
+
+std::string getEnv(const char* name, const std::string& def) {
+  const char* val = std::getenv(name);
+  return val ? std::string(val) : def;
+}
+
+std::string regmapDir() {
+  return getEnv("RACKMON_REGMAP_DIR", "/etc/rackmon.d");
+}
+
+json readJSON(const std::string& path) {
+  std::ifstream ifs(path);
+  json j;
+  ifs >> j;
+  return j;
+}
+
+template <typename Func>
+std::chrono::microseconds timeIt(Func func) {
+  auto begin = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - begin);
+}
+
+class BenchRackmon : public Rackmon {
+ public:
+  void scanTick() {
+    tickScanThreads();
+  }
+};
+
+// Serves getMonitorData with the handler of RackmonSvcUnix.
+class BenchService : public UnixService {
+  const Rackmon& rackmon_;
+  void handleRequest(const std::vector<char>& buf, std::unique_ptr<UnixSock> cli)
+      override {
+    json req = json::parse(buf);
+    ResponseFormat format = req.value("format", ResponseFormat::JSON);
+    json resp;
+    getMonitorData(rackmon_, req, resp);
+    resp["status"] = "SUCCESS";
+    cli->send(encodeResponse(resp, format));
+  }
+
+ public:
+  BenchService(const std::string& path, const Rackmon& rackmon)
+      : UnixService(path), rackmon_(rackmon) {}
+};
+
+class RackmonBenchmark : public ::testing::Test {
+ protected:
+  TempDirectory mapDir_{};
+  TempDirectory confDir_{};
+  std::string regmapName_{};
+  json regmap_{};
+  std::set<uint8_t> addrs_{};
+  std::unique_ptr<SimulatedBus> bus_{};
+
+  void SetUp() override {
+    regmapName_ = getEnv("RACKMON_BENCH_REGMAP", "orv3_psu.json");
+    std::string path = regmapDir() + "/" + regmapName_;
+    if (!std::ifstream(path).good()) {
+      GTEST_SKIP() << "Register map not found: " << path;
+    }
+    size_t numDevices = std::stoul(getEnv("RACKMON_BENCH_DEVICES", "128"));
+    numDevices = std::min<size_t>(numDevices, 256 - kFirstDeviceAddress);
+    for (size_t i = 0; i < numDevices; i++) {
+      addrs_.insert(uint8_t(kFirstDeviceAddress + i));
+    }
+    // Same register map, just covering all the simulated devices.
+    regmap_ = readJSON(path);
+    regmap_["address_range"] = {
+        {kFirstDeviceAddress, kFirstDeviceAddress + numDevices - 1}};
+    std::ofstream(mapDir_.path() + "/" + regmapName_) << regmap_;
+
+    uint32_t baudrate = regmap_["baudrate"];
+    bus_ = std::make_unique<SimulatedBus>(
+        addrs_, baudrate, std::getenv("RACKMON_BENCH_LINE_TIME") != nullptr);
+    json conf;
+    conf["interfaces"] = json::array(
+        {{{"device_path", bus_->path()}, {"baudrate", baudrate}}});
+    std::ofstream(confDir_.path() + "/rackmon.conf") << conf;
+  }
+
+  void report(
+      const std::string& what,
+      std::chrono::microseconds elapsed,
+      const SimulatedBus::Stats& stats) {
+    std::cout << std::left << std::setw(14) << what << std::right
+              << std::setw(10) << elapsed.count() / 1000 << "ms "
+              << std::setw(6) << stats.numRequests << " requests "
+              << std::setw(6) << stats.numRequests - stats.numResponses
+              << " timeouts " << std::setw(8) << stats.numBytes
+              << " bytes, wire time " << bus_->wireTime().count() / 1000
+              << "ms" << std::endl;
+  }
+};
+
+} // namespace
+
+TEST(RegisterSpanBenchmark, SpanEfficiency) {
+  std::string dir = regmapDir();
+  if (!std::filesystem::is_directory(dir)) {
+    GTEST_SKIP() << "Register maps not found: " << dir;
+  }
+  std::cout << std::left << std::setw(24) << "Register map" << std::right
+            << std::setw(6) << "regs" << std::setw(6) << "spans"
+            << std::setw(8) << "words" << std::setw(10) << "regs/txn"
+            << std::setw(12) << "sweep(ms)" << std::endl;
+  std::vector<std::string> paths{};
+  for (const auto& entry : std::filesystem::directory_iterator{dir}) {
+    if (entry.path().extension() == ".json") {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  for (const auto& path : paths) {
+    RegisterMapDatabase db;
+    db.load(readJSON(path));
+    const RegisterMap& rmap = *db.regmaps.back();
+    std::vector<RegisterStore> stores{};
+    stores.reserve(rmap.registerDescriptors.size());
+    for (const auto& [addr, desc] : rmap.registerDescriptors) {
+      stores.emplace_back(desc);
+    }
+    std::vector<RegisterStoreSpan> spans{};
+    size_t numWords = 0;
+    for (auto& store : stores) {
+      ASSERT_TRUE(RegisterStoreSpan::buildRegisterSpanList(
+          spans, store, rmap.maxRegisterSpanLength));
+      numWords += store.length();
+    }
+    // Each span is a read holding registers transaction: 8 byte
+    // request, 5 byte + data response. 11 bits per character and
+    // a 3.5 character gap between frames.
+    size_t numChars = 0;
+    for (const auto& span : spans) {
+      numChars += 8 + 5 + 2 * span.length() + 7;
+    }
+    double sweepMs = 1000.0 * numChars * 11 / rmap.baudrate;
+    std::cout << std::left << std::setw(24) << rmap.name << std::right
+              << std::setw(6) << stores.size() << std::setw(6) << spans.size()
+              << std::setw(8) << numWords << std::setw(10) << std::fixed
+              << std::setprecision(1) << double(stores.size()) / spans.size()
+              << std::setw(12) << sweepMs << std::endl;
+    EXPECT_LE(spans.size(), stores.size());
+  }
+}
+
+TEST_F(RackmonBenchmark, ScanMonitorAndServe) {
+  std::cout << "Simulated rack: " << addrs_.size() << " x " << regmapName_
+            << " @ " << regmap_["baudrate"] << " baud" << std::endl;
+  BenchRackmon mon;
+  mon.load(confDir_.path() + "/rackmon.conf", mapDir_.path());
+
+  // Full scan. The first pass of the scan thread is a full scan,
+  // a tick waits for the pass after that.
+  bus_->resetStats();
+  auto scanTime = timeIt([&mon]() {
+    mon.start();
+    mon.scanTick();
+  });
+  mon.stop();
+  std::vector<InterfaceStats> stats = mon.getInterfaceStats();
+  ASSERT_EQ(stats.size(), 1);
+  EXPECT_EQ(stats[0].numFullScans, 1);
+  ASSERT_EQ(mon.listDevices().size(), addrs_.size());
+  std::cout << "Full scan took " << stats[0].lastFullScanDurationMs << "ms with "
+            << stats[0].lastFullScanProbes << " probes" << std::endl;
+  report("scan", scanTime, bus_->getStats());
+
+  // Forced reloads (reloadRegisters) of every register of every
+  // device, regardless of their intervals, unlike the passes of the
+  // monitor thread. Also builds up the history served below.
+  for (int i = 0; i < kNumSweeps; i++) {
+    bus_->resetStats();
+    auto sweepTime = timeIt([&mon]() { mon.reload({}, {}); });
+    report("forced reload", sweepTime, bus_->getStats());
+    auto sweepStats = bus_->getStats();
+    EXPECT_EQ(sweepStats.numRequests, sweepStats.numResponses);
+  }
+
+  // Latency of getMonitorData on the UNIX socket, full rack.
+  std::string sockPath = confDir_.path() + "/rackmond.sock";
+  BenchService svc(sockPath, mon);
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  bool ready = false;
+  std::thread tid([&]() {
+    svc.initialize(0, nullptr);
+    {
+      std::unique_lock lk(mutex);
+      ready = true;
+    }
+    cv.notify_one();
+    svc.doLoop();
+    svc.deinitialize();
+  });
+  {
+    std::unique_lock lk(mutex);
+    cv.wait(lk, [&ready]() { return ready; });
+  }
+  for (auto format : {ResponseFormat::JSON, ResponseFormat::CBOR}) {
+    for (bool latest : {false, true}) {
+      json req = {
+          {"type", "getMonitorData"},
+          {"format", format},
+          {"filter", {{"latestValueOnly", latest}}}};
+      std::string req_s = req.dump();
+      std::vector<std::chrono::microseconds> samples{};
+      size_t respSize = 0;
+      for (int i = 0; i < kNumLatencySamples; i++) {
+        samples.push_back(timeIt([&]() {
+          UnixClient cli(sockPath);
+          std::vector<char> resp =
+              cli.request(std::vector<char>(req_s.begin(), req_s.end()));
+          respSize = resp.size();
+        }));
+      }
+      std::sort(samples.begin(), samples.end());
+      std::cout << "getMonitorData " << json(format).get<std::string>()
+                << (latest ? " latest" : " history") << ": " << respSize
+                << " bytes, p50 " << samples[samples.size() / 2].count()
+                << "us, max " << samples.back().count() << "us" << std::endl;
+    }
+  }
+  svc.requestExit();
+  tid.join();
+}
@@ -94,10 +94,10 @@ class MockRackmon : public Rackmon {
     return getRegisterMapDatabase();
   }
   void scanTick() {
-    getScanThread().tick();
+    tickScanThreads();
   }
   void monitorTick() {
-    getMonitorThread().tick();
+    tickMonitorThreads();
   }
 };
 
@@ -311,6 +311,7 @@ TEST_F(RackmonTest, BasicScanFoundOneMon) {
       .Times(1)
       .WillOnce(Return(ByMove(make_modbus(161, 4))));
   mon.load(r_conf, r_test_dir);
+  uint64_t generation = mon.getReloadGeneration();
   mon.start();
 
   // Fake that a tick has elapsed on scan's pollthread.
@@ -323,6 +324,19 @@ TEST_F(RackmonTest, BasicScanFoundOneMon) {
   // Fake that a tick has elapsed on monitor's pollthread.
   mon.monitorTick();
   mon.stop(false);
+  // Subscribers are woken up by the reload.
+  EXPECT_GT(mon.waitForReload(generation, 0s), generation);
+  std::vector<InterfaceStats> stats = mon.getInterfaceStats();
+  ASSERT_EQ(stats.size(), 1);
+  EXPECT_EQ(stats[0].numScheduled, 1);
+  EXPECT_GE(stats[0].numReloads, 1);
+  EXPECT_EQ(stats[0].numFullScans, 1);
+  // 160, 161, 162 on the first pass. 160 and 162 on the two retries.
+  EXPECT_EQ(stats[0].lastFullScanProbes, 7);
+  // Next reload is due within one interval.
+  EXPECT_LE(
+      stats[0].nextReloadTime,
+      std::time(nullptr) + RegisterDescriptor::kDefaultInterval);
   std::vector<ModbusDeviceValueData> data;
   mon.getValueData(data);
   EXPECT_EQ(data.size(), 1);
@@ -370,6 +384,142 @@ TEST_F(RackmonTest, BasicScanFoundOneMon) {
   EXPECT_EQ(data[0].registerList.size(), 0);
 }
 
+TEST_F(RackmonTest, WarmStart) {
+  TempDirectory cacheDir{};
+  std::string cachePath = cacheDir.path() + "/devices.json";
+  {
+    MockRackmon mon;
+    EXPECT_CALL(mon, makeInterface())
+        .Times(1)
+        .WillOnce(Return(ByMove(make_modbus(161, 4))));
+    mon.load(r_conf, r_test_dir, cachePath);
+    mon.start();
+    mon.scanTick();
+    mon.stop(false);
+    ASSERT_EQ(mon.listDevices().size(), 1);
+    EXPECT_EQ(mon.getInterfaceStats()[0].numWarmStartDevices, 0);
+  }
+  std::ifstream ifs(cachePath);
+  json cache;
+  ifs >> cache;
+  ASSERT_EQ(cache["devices"].size(), 1);
+  EXPECT_EQ(cache["devices"][0]["devAddress"], 161);
+  EXPECT_EQ(cache["devices"][0]["deviceType"], "orv2_psu");
+  EXPECT_EQ(cache["devices"][0]["baudrate"], 19200);
+  EXPECT_EQ(cache["devices"][0]["parity"], "EVEN");
+
+  // A restart verifies the cached device before the full scan.
+  MockRackmon mon;
+  EXPECT_CALL(mon, makeInterface())
+      .Times(1)
+      .WillOnce(Return(ByMove(make_modbus(161, 4))));
+  mon.load(r_conf, r_test_dir, cachePath);
+  mon.start();
+  mon.scanTick();
+  mon.stop(false);
+  ASSERT_EQ(mon.listDevices().size(), 1);
+  std::vector<InterfaceStats> stats = mon.getInterfaceStats();
+  ASSERT_EQ(stats.size(), 1);
+  EXPECT_EQ(stats[0].numWarmStartDevices, 1);
+  EXPECT_EQ(stats[0].numFullScans, 1);
+  // 161 is already known, 160 and 162 probed on all three passes.
+  EXPECT_EQ(stats[0].lastFullScanProbes, 6);
+}
+
+TEST_F(RackmonTest, CorruptDeviceCache) {
+  TempDirectory cacheDir{};
+  std::string cachePath = cacheDir.path() + "/devices.json";
+  std::ofstream ofs(cachePath);
+  ofs << "{\"version\": 1, \"devices\": [{\"devAddress\": 161}]}";
+  ofs.close();
+  MockRackmon mon;
+  EXPECT_CALL(mon, makeInterface())
+      .Times(1)
+      .WillOnce(Return(ByMove(make_modbus(161, 4))));
+  // Falls back to a full scan.
+  mon.load(r_conf, r_test_dir, cachePath);
+  mon.start();
+  mon.scanTick();
+  mon.stop(false);
+  ASSERT_EQ(mon.listDevices().size(), 1);
+  EXPECT_EQ(mon.getInterfaceStats()[0].numWarmStartDevices, 0);
+  EXPECT_EQ(mon.getInterfaceStats()[0].lastFullScanProbes, 7);
+}
+
+TEST_F(RackmonTest, MultipleInterfaces) {
+  MockRackmon mon;
+  auto make_iface = [](uint8_t exp_addr) {
+    std::unique_ptr<Mock3Modbus> ptr =
+        std::make_unique<Mock3Modbus>(exp_addr, 160, 162, 19200);
+    EXPECT_CALL(*ptr, initialize(_)).Times(1);
+    EXPECT_CALL(*ptr, isPresent()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*ptr, command(_, _, _, _, _)).Times(AtLeast(2));
+    std::unique_ptr<Modbus> ptr2 = std::move(ptr);
+    return ptr2;
+  };
+  // Each interface has a single device on it. Each
+  // interface is scanned and monitored by its own threads.
+  EXPECT_CALL(mon, makeInterface())
+      .Times(2)
+      .WillOnce(Return(ByMove(make_iface(160))))
+      .WillOnce(Return(ByMove(make_iface(162))));
+  json ifaceConfig = R"({
+    "interfaces": [
+      {
+        "device_path": "/tmp/blah1",
+        "baudrate": 19200
+      },
+      {
+        "device_path": "/tmp/blah2",
+        "baudrate": 19200
+      }
+    ]
+  })"_json;
+  json regmapConfig = R"({
+    "name": "orv2_psu",
+    "address_range": [[160, 162]],
+    "probe_register": 104,
+    "baudrate": 19200,
+    "registers": [
+      {
+        "begin": 0,
+        "length": 8,
+        "format": "STRING",
+        "name": "MFG_MODEL"
+      }
+    ]
+  })"_json;
+  mon.loadInterface(ifaceConfig);
+  mon.loadRegisterMap(regmapConfig);
+  mon.start();
+  mon.scanTick();
+  mon.monitorTick();
+  mon.stop();
+
+  std::vector<ModbusDeviceInfo> devs = mon.listDevices();
+  ASSERT_EQ(devs.size(), 2);
+  EXPECT_EQ(devs[0].deviceAddress, 160);
+  EXPECT_EQ(devs[0].mode, ModbusDeviceMode::ACTIVE);
+  EXPECT_EQ(devs[1].deviceAddress, 162);
+  EXPECT_EQ(devs[1].mode, ModbusDeviceMode::ACTIVE);
+
+  std::vector<InterfaceStats> stats = mon.getInterfaceStats();
+  ASSERT_EQ(stats.size(), 2);
+  EXPECT_EQ(stats[0].numScheduled, 1);
+  EXPECT_EQ(stats[1].numScheduled, 1);
+
+  std::vector<ModbusDeviceValueData> data;
+  mon.getValueData(data);
+  ASSERT_EQ(data.size(), 2);
+  for (const auto& dev : data) {
+    ASSERT_EQ(dev.registerList.size(), 1);
+    ASSERT_EQ(dev.registerList[0].history.size(), 1);
+    EXPECT_EQ(
+        std::get<std::string>(dev.registerList[0].history[0].value),
+        "abcdefghijklmnop");
+  }
+}
+
 TEST_F(RackmonTest, DormantRecovery) {
   std::atomic<bool> commandTimeout{false};
   MockRackmon mon;
@@ -459,3 +609,115 @@ TEST_F(RackmonTest, DormantRecovery) {
   EXPECT_EQ(devs.size(), 1);
   EXPECT_EQ(devs[0].mode, ModbusDeviceMode::ACTIVE);
 }
+
+TEST(ReloadScheduleTest, DeadlineOrder) {
+  ReloadSchedule sched;
+  sched.schedule(0xa0, 100);
+  sched.schedule(0xa1, 50);
+  sched.schedule(0xa2, 150);
+  EXPECT_TRUE(sched.isScheduled(0xa0));
+  EXPECT_TRUE(sched.isScheduled(0xa1));
+  EXPECT_TRUE(sched.isScheduled(0xa2));
+  EXPECT_FALSE(sched.isScheduled(0xa3));
+
+  EXPECT_EQ(sched.popDue(10).size(), 0);
+  auto due = sched.popDue(120);
+  ASSERT_EQ(due.size(), 2);
+  EXPECT_EQ(due[0].first, 50);
+  EXPECT_EQ(due[0].second, 0xa1);
+  EXPECT_EQ(due[1].first, 100);
+  EXPECT_EQ(due[1].second, 0xa0);
+  EXPECT_FALSE(sched.isScheduled(0xa0));
+  EXPECT_FALSE(sched.isScheduled(0xa1));
+  EXPECT_TRUE(sched.isScheduled(0xa2));
+
+  sched.recordReload(70);
+  sched.recordReload(20);
+  InterfaceStats stats{};
+  sched.getStats(stats);
+  EXPECT_EQ(stats.numScheduled, 1);
+  EXPECT_EQ(stats.numReloads, 2);
+  EXPECT_EQ(stats.maxReloadDelay, 70);
+  EXPECT_EQ(stats.nextReloadTime, 150);
+
+  sched.clear();
+  sched.getStats(stats);
+  EXPECT_EQ(stats.numScheduled, 0);
+  EXPECT_EQ(stats.nextReloadTime, 0);
+  EXPECT_EQ(sched.popDue(1000).size(), 0);
+}
+
+TEST(ProbeTimerTest, AdaptTimeout) {
+  ProbeTimer timer(std::chrono::milliseconds(70));
+  // Not enough samples, use the max.
+  EXPECT_EQ(timer.timeout(), std::chrono::milliseconds(70));
+  timer.record(std::chrono::milliseconds(2));
+  timer.record(std::chrono::milliseconds(2));
+  EXPECT_EQ(timer.timeout(), std::chrono::milliseconds(70));
+  timer.record(std::chrono::milliseconds(2));
+  // Fast and consistent responses, bounded by the min.
+  EXPECT_EQ(timer.timeout(), std::chrono::milliseconds(20));
+  // Slow responses increase the timeout, bounded by the max.
+  for (int i = 0; i < 10; i++) {
+    timer.record(std::chrono::milliseconds(30));
+  }
+  EXPECT_GT(timer.timeout(), std::chrono::milliseconds(30));
+  EXPECT_LE(timer.timeout(), std::chrono::milliseconds(70));
+  for (int i = 0; i < 10; i++) {
+    timer.record(std::chrono::milliseconds(100));
+  }
+  EXPECT_EQ(timer.timeout(), std::chrono::milliseconds(70));
+}
+
+TEST(ValueChangeTrackerTest, ReportChanges) {
+  auto makeData = [](float power, const std::string& model) {
+    ModbusDeviceValueData data;
+    data.deviceAddress = 161;
+    RegisterValue powerVal, modelVal;
+    powerVal.type = RegisterValueType::FLOAT;
+    powerVal.value = power;
+    powerVal.timestamp = 1;
+    modelVal.type = RegisterValueType::STRING;
+    modelVal.value = model;
+    modelVal.timestamp = 1;
+    data.registerList.emplace_back(0x10, "POWER");
+    data.registerList.back().history.push_back(powerVal);
+    data.registerList.emplace_back(0x20, "MODEL");
+    data.registerList.back().history.push_back(modelVal);
+    // Never read, nothing to report.
+    data.registerList.emplace_back(0x30, "UNREAD");
+    data.registerList.back().history.emplace_back();
+    return data;
+  };
+  ValueChangeTracker tracker(1.0);
+
+  // Everything is new on the first update.
+  ModbusDeviceValueData data = makeData(100.0, "abcd");
+  ASSERT_TRUE(tracker.update(data));
+  ASSERT_EQ(data.registerList.size(), 2);
+  EXPECT_EQ(data.registerList[0].name, "POWER");
+  EXPECT_EQ(data.registerList[1].name, "MODEL");
+
+  // Nothing changed (Within the threshold).
+  data = makeData(100.5, "abcd");
+  ASSERT_FALSE(tracker.update(data));
+  ASSERT_EQ(data.registerList.size(), 0);
+
+  // Moved beyond the threshold from the last reported value.
+  data = makeData(101.2, "abcd");
+  ASSERT_TRUE(tracker.update(data));
+  ASSERT_EQ(data.registerList.size(), 1);
+  EXPECT_EQ(data.registerList[0].name, "POWER");
+
+  // Non-numeric values are reported on any change.
+  data = makeData(101.2, "abce");
+  ASSERT_TRUE(tracker.update(data));
+  ASSERT_EQ(data.registerList.size(), 1);
+  EXPECT_EQ(data.registerList[0].name, "MODEL");
+
+  // Mode changes are always reported.
+  data = makeData(101.2, "abce");
+  data.mode = ModbusDeviceMode::DORMANT;
+  ASSERT_TRUE(tracker.update(data));
+  ASSERT_EQ(data.registerList.size(), 0);
+}
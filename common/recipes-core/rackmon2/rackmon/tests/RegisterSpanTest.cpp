@@ -100,3 +100,22 @@ TEST_F(RegisterSpanTest, smallSpanListTest) {
   ASSERT_EQ(spanList[3].getSpanAddress(), 19);
   ASSERT_EQ(spanList[3].length(), 1);
 }
+
+TEST_F(RegisterSpanTest, nextReloadTime) {
+  RegisterStoreSpan span(&regs[2]);
+  // Never read, so it is due right away.
+  ASSERT_EQ(span.nextReloadTime(), 2);
+  span.advanceReload(1);
+  ASSERT_EQ(span.nextReloadTime(), 2);
+
+  span.endReloadSpan(1000);
+  ASSERT_EQ(span.nextReloadTime(), 1002);
+  ASSERT_FALSE(span.reloadPending(1001));
+  span.advanceReload(1);
+  ASSERT_EQ(span.nextReloadTime(), 1001);
+  ASSERT_TRUE(span.reloadPending(1001));
+  // Cannot pull it ahead more than one interval.
+  span.endReloadSpan(1000);
+  span.advanceReload(100);
+  ASSERT_EQ(span.nextReloadTime(), 1000);
+}
@@ -0,0 +1,123 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
+#include "Register.h"
+
+using namespace std;
+using namespace rackmon;
+
+namespace {
+
+// Approximate book-keeping overhead of a heap allocation (glibc).
+constexpr size_t kMallocOverhead = 16;
+
+// Rack sized workload: 128 devices each with 200 registers.
+constexpr size_t kNumDevices = 128;
+constexpr size_t kNumRegisters = 200;
+constexpr uint16_t kRegisterLength = 4;
+constexpr uint16_t kKeep = 6;
+constexpr int kNumReloads = 20;
+
+// Replica of the previous history layout for comparison: a vector
+// of samples each owning its own vector of words.
+struct LegacyRegisterStore {
+  struct Sample {
+    const RegisterDescriptor& desc;
+    std::vector<uint16_t> value;
+    uint32_t timestamp = 0;
+  };
+  std::vector<Sample> history;
+  int32_t idx = 0;
+  explicit LegacyRegisterStore(const RegisterDescriptor& desc)
+      : history(desc.keep, Sample{desc, std::vector<uint16_t>(desc.length)}) {}
+  void setRegister(const std::vector<uint16_t>& value, uint32_t tstamp) {
+    auto& sample = history[idx];
+    std::copy(value.begin(), value.end(), sample.value.begin());
+    sample.timestamp = tstamp;
+    idx = (idx + 1) % history.size();
+  }
+  size_t memoryUsage() const {
+    size_t usage = sizeof(*this) + kMallocOverhead +
+        history.capacity() * sizeof(Sample);
+    for (const auto& sample : history) {
+      usage += kMallocOverhead + sample.value.capacity() * sizeof(uint16_t);
+    }
+    return usage;
+  }
+};
+
+template <typename Func>
+std::chrono::microseconds timeIt(Func func) {
+  auto begin = std::chrono::steady_clock::now();
+  func();
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - begin);
+}
+
+} // namespace
+
+TEST(RegisterStoreBenchmark, FootprintAndReload) {
+  RegisterDescriptor desc{
+      0,
+      kRegisterLength,
+      "BENCH",
+      kKeep,
+      false,
+      RegisterEndian::BIG,
+      RegisterValueType::HEX,
+      0};
+  std::vector<uint16_t> value(kRegisterLength, 0x1234);
+  size_t numStores = kNumDevices * kNumRegisters;
+
+  std::vector<LegacyRegisterStore> legacy;
+  std::vector<RegisterStore> ring;
+  auto legacyBuild = timeIt([&]() {
+    legacy.reserve(numStores);
+    for (size_t i = 0; i < numStores; i++) {
+      legacy.emplace_back(desc);
+    }
+  });
+  auto ringBuild = timeIt([&]() {
+    ring.reserve(numStores);
+    for (size_t i = 0; i < numStores; i++) {
+      ring.emplace_back(desc);
+    }
+  });
+
+  auto legacyReload = timeIt([&]() {
+    for (int t = 1; t <= kNumReloads; t++) {
+      for (auto& reg : legacy) {
+        reg.setRegister(value, t);
+      }
+    }
+  });
+  auto ringReload = timeIt([&]() {
+    for (int t = 1; t <= kNumReloads; t++) {
+      for (auto& reg : ring) {
+        reg.setRegister(value.begin(), value.end(), t);
+      }
+    }
+  });
+
+  size_t legacyBytes = 0, ringBytes = 0;
+  for (const auto& reg : legacy) {
+    legacyBytes += reg.memoryUsage();
+  }
+  for (const auto& reg : ring) {
+    // Two allocations per store (timestamps and words).
+    ringBytes += reg.memoryUsage() + 2 * kMallocOverhead;
+  }
+
+  std::cout << "Stores: " << numStores << " keep: " << kKeep
+            << " length: " << kRegisterLength << '\n'
+            << "  legacy: " << legacyBytes << " bytes, "
+            << numStores * (kKeep + 1) << " allocations, build "
+            << legacyBuild.count() << "us, reload " << legacyReload.count()
+            << "us\n"
+            << "  ring:   " << ringBytes << " bytes, " << numStores * 2
+            << " allocations, build " << ringBuild.count() << "us, reload "
+            << ringReload.count() << "us" << std::endl;
+  EXPECT_LT(ringBytes, legacyBytes);
+  EXPECT_EQ(ring.back().backTimestamp(), kNumReloads);
+}
@@ -88,9 +88,8 @@ TEST(RegisterStoreTest, BasicOperation) {
   RegisterStore reg(desc);
   for (uint16_t i = 0; i < 5; i++) {
     EXPECT_EQ(reg.front(), false);
-    reg.front().value = {0x0001, i};
-    reg.front().timestamp = i + 1;
-    ++reg;
+    std::vector<uint16_t> value{0x0001, i};
+    reg.setRegister(value.begin(), value.end(), i + 1);
   }
   for (uint16_t i = 0; i < 5; i++) {
     EXPECT_EQ(reg.front(), true);
@@ -120,9 +119,8 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.name, "HELLO");
   EXPECT_EQ(val.history.size(), 0);
 
-  reg.front().value = std::vector<uint16_t>({0x3031, 0x3233}); // "0123"
-  reg.front().timestamp = 0x1234;
-  ++reg;
+  std::vector<uint16_t> value1{0x3031, 0x3233}; // "0123"
+  reg.setRegister(value1.begin(), value1.end(), 0x1234);
   val = reg;
   EXPECT_EQ(val.regAddr, 0);
   EXPECT_EQ(val.name, "HELLO");
@@ -130,9 +128,8 @@ TEST(RegisterStoreTest, DataRetrievalConversions) {
   EXPECT_EQ(val.history[0].type, RegisterValueType::STRING);
   EXPECT_EQ(std::get<std::string>(val.history[0].value), "0123");
 
-  reg.front().value = std::vector<uint16_t>({0x3132, 0x3334}); // "1234"
-  reg.front().timestamp = 0x1234;
-  ++reg;
+  std::vector<uint16_t> value2{0x3132, 0x3334}; // "1234"
+  reg.setRegister(value2.begin(), value2.end(), 0x1234);
   val = reg;
   EXPECT_EQ(val.regAddr, 0);
   EXPECT_EQ(val.name, "HELLO");
@@ -224,3 +221,27 @@ TEST(RegisterStoreTest, setRegisterTest) {
   EXPECT_EQ(val.history[0].timestamp, 4);
   EXPECT_EQ(val.history[1].timestamp, 5);
 }
+
+TEST(RegisterStoreTest, MemoryUsage) {
+  RegisterDescriptor desc{
+      0,
+      8,
+      "HELLO",
+      10,
+      false,
+      RegisterEndian::BIG,
+      RegisterValueType::STRING,
+      0};
+  RegisterStore reg(desc);
+  size_t usage = reg.memoryUsage();
+  EXPECT_GE(usage, sizeof(RegisterStore) + 10 * (8 * 2 + 4));
+  // Storing samples does not grow the store.
+  std::vector<uint16_t> value(8, 0x3031);
+  for (uint32_t i = 1; i <= 25; i++) {
+    reg.setRegister(value.begin(), value.end(), i);
+  }
+  EXPECT_EQ(reg.memoryUsage(), usage);
+  EXPECT_EQ(reg.backTimestamp(), 25);
+  RegisterStoreValue val = reg;
+  EXPECT_EQ(val.history.size(), 10);
+}
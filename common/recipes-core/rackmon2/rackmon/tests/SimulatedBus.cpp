@@ -0,0 +1,190 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#include "SimulatedBus.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <system_error>
+
+namespace rackmon {
+
+namespace {
+constexpr uint8_t kReadHoldingRegisters = 0x3;
+constexpr uint8_t kWriteSingleRegister = 0x6;
+constexpr uint8_t kWriteMultipleRegisters = 0x10;
+constexpr int kPollIntervalMs = 100;
+// Start, 8 data bits, parity and stop.
+constexpr uint64_t kBitsPerChar = 11;
+} // namespace
+
+SimulatedBus::SimulatedBus(
+    const std::set<uint8_t>& addrs,
+    uint32_t baudrate,
+    bool simulateLineTime)
+    : addrs_(addrs), baudrate_(baudrate), simulateLineTime_(simulateLineTime) {
+  masterFd_ = posix_openpt(O_RDWR | O_NOCTTY);
+  if (masterFd_ < 0 || grantpt(masterFd_) != 0 || unlockpt(masterFd_) != 0) {
+    throw std::system_error(
+        std::error_code(errno, std::generic_category()), "pty");
+  }
+  path_ = ptsname(masterFd_);
+  slaveFd_ = open(path_.c_str(), O_RDWR | O_NOCTTY);
+  if (slaveFd_ < 0) {
+    throw std::system_error(
+        std::error_code(errno, std::generic_category()), path_);
+  }
+  struct termios tio {};
+  tcgetattr(slaveFd_, &tio);
+  cfmakeraw(&tio);
+  tcsetattr(slaveFd_, TCSANOW, &tio);
+  thread_ = std::thread(&SimulatedBus::serve, this);
+}
+
+SimulatedBus::~SimulatedBus() {
+  running_ = false;
+  thread_.join();
+  close(slaveFd_);
+  close(masterFd_);
+}
+
+SimulatedBus::Stats SimulatedBus::getStats() const {
+  Stats stats{};
+  stats.numRequests = numRequests_.load();
+  stats.numResponses = numResponses_.load();
+  stats.numBytes = numBytes_.load();
+  return stats;
+}
+
+void SimulatedBus::resetStats() {
+  numRequests_ = 0;
+  numResponses_ = 0;
+  numBytes_ = 0;
+}
+
+std::chrono::microseconds SimulatedBus::wireTime(
+    uint64_t numBytes,
+    uint64_t numFrames) const {
+  // 3.5 characters of silence delimit frames.
+  uint64_t bits = numBytes * kBitsPerChar + numFrames * kBitsPerChar * 7 / 2;
+  return std::chrono::microseconds(bits * 1000000 / baudrate_);
+}
+
+std::chrono::microseconds SimulatedBus::wireTime() const {
+  return wireTime(numBytes_.load(), numRequests_ + numResponses_);
+}
+
+bool SimulatedBus::readExact(uint8_t* buf, size_t len) {
+  while (len > 0) {
+    struct pollfd pfd = {masterFd_, POLLIN, 0};
+    int rc = poll(&pfd, 1, kPollIntervalMs);
+    if (!running_) {
+      return false;
+    }
+    if (rc <= 0) {
+      continue;
+    }
+    ssize_t n = read(masterFd_, buf, len);
+    if (n <= 0) {
+      continue;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool SimulatedBus::readRequest(Msg& req) {
+  // Address and function code.
+  req.len = 2;
+  if (!readExact(req.raw.data(), 2)) {
+    return false;
+  }
+  size_t remaining = 0;
+  switch (req.raw[1]) {
+    case kReadHoldingRegisters:
+    case kWriteSingleRegister:
+      // Register address, count/value and CRC.
+      remaining = 6;
+      break;
+    case kWriteMultipleRegisters:
+      // Register address, count and byte count. Followed by the
+      // values and CRC.
+      if (!readExact(req.raw.data() + req.len, 5)) {
+        return false;
+      }
+      req.len += 5;
+      remaining = req.raw[6] + 2;
+      break;
+    default:
+      // Not simulated. Drop whatever is pending and let the
+      // request time out.
+      tcflush(slaveFd_, TCOFLUSH);
+      return true;
+  }
+  if (req.len + remaining > req.raw.size()) {
+    return true;
+  }
+  if (!readExact(req.raw.data() + req.len, remaining)) {
+    return false;
+  }
+  req.len += remaining;
+  return true;
+}
+
+bool SimulatedBus::handleRequest(const Msg& req, Msg& resp) {
+  if (req.len < 4 || addrs_.find(req.addr) == addrs_.end()) {
+    return false;
+  }
+  Msg msg = req;
+  try {
+    Encoder::decode(msg);
+  } catch (std::exception&) {
+    return false;
+  }
+  resp.clear();
+  resp << msg.raw[0] << msg.raw[1];
+  if (msg.raw[1] == kReadHoldingRegisters) {
+    uint16_t regAddr = msg.raw[2] << 8 | msg.raw[3];
+    uint16_t count = msg.raw[4] << 8 | msg.raw[5];
+    resp << uint8_t(count * 2);
+    for (uint16_t i = 0; i < count; i++) {
+      resp << uint16_t(msg.addr << 8 | ((regAddr + i) & 0xff));
+    }
+  } else if (msg.raw[1] == kWriteSingleRegister) {
+    // Echo the request.
+    resp = msg;
+  } else {
+    // Register address and count.
+    std::copy(msg.raw.begin() + 2, msg.raw.begin() + 6, resp.raw.begin() + 2);
+    resp.len = 6;
+  }
+  Encoder::finalize(resp);
+  return true;
+}
+
+void SimulatedBus::serve() {
+  Msg req, resp;
+  while (running_) {
+    if (!readRequest(req)) {
+      break;
+    }
+    numRequests_++;
+    numBytes_ += req.len;
+    bool answer = handleRequest(req, resp);
+    if (simulateLineTime_) {
+      std::this_thread::sleep_for(
+          wireTime(req.len + (answer ? resp.len : 0), answer ? 2 : 1));
+    }
+    if (!answer) {
+      continue;
+    }
+    numResponses_++;
+    numBytes_ += resp.len;
+    if (write(masterFd_, resp.raw.data(), resp.len) != ssize_t(resp.len)) {
+      break;
+    }
+  }
+}
+
+} // namespace rackmon
@@ -0,0 +1,75 @@
+// Copyright 2021-present Facebook. All Rights Reserved.
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <string>
+#include <thread>
+#include "Msg.h"
+
+namespace rackmon {
+
+// A farm of simulated Modbus devices behind a pseudo terminal. rackmon
+// talks to the slave end of the pty exactly as it would to a UART
+// while the farm answers requests addressed to its devices on the
+// master end. Requests to other addresses go unanswered (Timeout).
+// Holding registers read back as (device address << 8 | register).
+class SimulatedBus {
+ public:
+  struct Stats {
+    uint64_t numRequests = 0;
+    uint64_t numResponses = 0;
+    // Characters transferred in both directions.
+    uint64_t numBytes = 0;
+  };
+
+  SimulatedBus(
+      const std::set<uint8_t>& addrs,
+      uint32_t baudrate,
+      bool simulateLineTime = false);
+  ~SimulatedBus();
+
+  // Path of the device rackmon should open.
+  const std::string& path() const {
+    return path_;
+  }
+
+  Stats getStats() const;
+  void resetStats();
+
+  // Time the traffic seen so far would have occupied an RS485 bus
+  // at the baudrate (11 bits per character and a 3.5 character
+  // silence between frames).
+  std::chrono::microseconds wireTime() const;
+
+ private:
+  const std::set<uint8_t> addrs_;
+  const uint32_t baudrate_;
+  // Delay responses by the wire time of the transaction.
+  const bool simulateLineTime_;
+  int masterFd_ = -1;
+  // The slave end is kept open so the master does not see a
+  // hangup while rackmon (re)opens the device.
+  int slaveFd_ = -1;
+  std::string path_{};
+  std::atomic<bool> running_{true};
+  std::atomic<uint64_t> numRequests_{0};
+  std::atomic<uint64_t> numResponses_{0};
+  std::atomic<uint64_t> numBytes_{0};
+  std::thread thread_{};
+
+  std::chrono::microseconds wireTime(uint64_t numBytes, uint64_t numFrames)
+      const;
+  // Reads exactly len bytes. Returns false if the bus is
+  // shutting down.
+  bool readExact(uint8_t* buf, size_t len);
+  // Reads the next request, returns false if the bus is
+  // shutting down.
+  bool readRequest(Msg& req);
+  // Builds the response of a request. Returns false if the
+  // request should not be answered.
+  bool handleRequest(const Msg& req, Msg& resp);
+  void serve();
+};
+
+} // namespace rackmon
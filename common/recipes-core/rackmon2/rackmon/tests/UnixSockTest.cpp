@@ -4,6 +4,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include "ResponseFormat.h"
 
 using namespace rackmonsvc;
 
@@ -13,6 +14,12 @@ class TestService : public UnixService {
   void handleRequest(
       const std::vector<char>& req,
       std::unique_ptr<UnixSock> cli) override {
+    if (std::string(req.begin(), req.end()) == "stream") {
+      for (std::string frame : {"one", "two", "end"}) {
+        cli->send(frame.data(), frame.size());
+      }
+      return;
+    }
     std::vector<char> resp(req);
     std::reverse(resp.begin(), resp.end());
     cli->send(resp);
@@ -47,6 +54,13 @@ TEST(UnixSockTest, BasicLoopback) {
   ASSERT_EQ(ptr->request("hello world"), "dlrow olleh");
   ptr = std::make_unique<TestClient>();
   ASSERT_EQ(ptr->request("test"), "tset");
+  ptr = std::make_unique<TestClient>();
+  std::vector<std::string> frames{};
+  ptr->request("stream", [&frames](const std::vector<char>& frame) {
+    frames.emplace_back(frame.begin(), frame.end());
+    return frames.back() != "end";
+  });
+  ASSERT_EQ(frames, std::vector<std::string>({"one", "two", "end"}));
   svc.requestExit();
   tid.join();
 }
@@ -72,3 +86,17 @@ TEST(UnixSockTest, BasicTERM) {
   svc.requestExit();
   tid.join();
 }
+
+TEST(ResponseFormatTest, EncodeDecode) {
+  nlohmann::json j = {{"status", "SUCCESS"}, {"data", {1, 2, 3}}};
+  for (auto format :
+       {ResponseFormat::JSON, ResponseFormat::CBOR, ResponseFormat::MSGPACK}) {
+    std::vector<char> buf = encodeResponse(j, format);
+    ASSERT_EQ(decodeResponse(buf, format), j);
+  }
+  std::vector<char> buf = encodeResponse(j, ResponseFormat::JSON);
+  ASSERT_EQ(std::string(buf.begin(), buf.end()), j.dump());
+  ASSERT_LT(encodeResponse(j, ResponseFormat::CBOR).size(), buf.size());
+  nlohmann::json req = {{"format", "msgpack"}};
+  ASSERT_EQ(req["format"].get<ResponseFormat>(), ResponseFormat::MSGPACK);
+}
@@ -305,6 +305,62 @@ class PyrmdSyncTest(unittest.TestCase):
             False,
         )
 
+    def test_monitor_data_stream(self, sync_exec, async_exec):
+        exp_resp = {"status": "SUCCESS", "data": [{"addr": 1}]}
+        exp_req = {"type": "getMonitorData", "stream": True}
+        exp_ret = [{"addr": 1}]
+        self.do_cmd(
+            sync_exec,
+            async_exec,
+            exp_req,
+            exp_resp,
+            exp_ret,
+            pyrmd.RackmonInterface.data,
+            pyrmd.RackmonAsyncInterface.data,
+            False,
+            None,
+            True,
+            True,
+        )
+
+    def test_collect_stream(self, sync_exec, async_exec):
+        frames = [
+            {"data": [{"addr": 1}]},
+            {"data": [{"addr": 2}]},
+            {"status": "SUCCESS"},
+        ]
+        resp = pyrmd.RackmonInterface._collect(iter(frames))
+        self.assertEqual(resp["status"], "SUCCESS")
+        self.assertEqual(resp["data"], [{"addr": 1}, {"addr": 2}])
+        self.assertRaises(
+            pyrmd.ModbusUnknownError,
+            pyrmd.RackmonInterface._collect,
+            iter(frames[:1]),
+        )
+
+    def test_subscribe_request(self, sync_exec, async_exec):
+        dataFilter = pyrmd.RackmonInterface._register_filter(161, "POWER")
+        req = pyrmd.RackmonInterface._subscribe(dataFilter, 0.5, 10)
+        self.assertEqual(req["type"], "subscribe")
+        self.assertEqual(req["threshold"], 0.5)
+        self.assertEqual(req["heartbeatInterval"], 10)
+        self.assertEqual(req["filter"], dataFilter["filter"])
+        req = pyrmd.RackmonInterface._subscribe(None, 0, 5)
+        self.assertEqual(req, {"type": "subscribe", "heartbeatInterval": 5})
+
+    def test_subscribe_updates(self, sync_exec, async_exec):
+        frames = [
+            {"generation": 1, "data": [{"addr": 1}, {"addr": 2}]},
+            {"generation": 1, "data": []},
+            {"generation": 2, "data": [{"addr": 2}]},
+            {"status": "ERR_IO_FAILURE"},
+        ]
+        updates = pyrmd.RackmonInterface._updates(iter(frames))
+        self.assertEqual(next(updates), [{"addr": 1}, {"addr": 2}])
+        # Heartbeats are skipped.
+        self.assertEqual(next(updates), [{"addr": 2}])
+        self.assertRaises(pyrmd.ModbusException, next, updates)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -2,6 +2,7 @@
  * Copyright 2020-present Facebook. All Rights Reserved.
  */
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <array>
 #include <iostream>
@@ -35,13 +36,17 @@ static void create_dir(const FileHandle::path& dir) {
 }
 
 
-static FileHandle::path get_key_path(const std::string& key, region r) {
+FileHandle::path FileHandle::key_path(const std::string& key, region r) {
   FileHandle::path p = r == region::persist ? kv_store : cache_store;
 
-  auto key_path = p / key;
+  return p / key;
+}
+
+static FileHandle::path get_key_path(const std::string& key, region r) {
+  auto key_path = FileHandle::key_path(key, r);
   create_dir(key_path.parent_path());
 
-  return p / key;
+  return key_path;
 }
 
 
@@ -72,6 +77,23 @@ void FileHandle::open_and_lock(const std::string& key, region r) {
         std::error_code(errno, std::system_category()));
   }
   locked = true;
+
+  // Persistent keys are replaced by rename (see commit()), and keys of any
+  // region may be removed (del, or set_multi undoing the keys it created).
+  // If that happened while waiting for the lock we hold a file no longer
+  // reachable by the key, start over.
+  {
+    struct stat opened, current;
+    if (fstat(fileno(fp), &opened) != 0 ||
+        ::stat(fpath.c_str(), &current) != 0 ||
+        opened.st_ino != current.st_ino || opened.st_dev != current.st_dev) {
+      flock(fileno(fp), LOCK_UN);
+      locked = false;
+      fclose(fp);
+      fp = nullptr;
+      open_and_lock<method>(key, r);
+    }
+  }
 }
 
 // explicit instantiations
@@ -130,6 +152,52 @@ void FileHandle::write(std::string value) {
   }
 }
 
+struct stat FileHandle::status() {
+  struct stat st;
+
+  if (fstat(fileno(fp), &st) != 0) {
+    throw fs::filesystem_error(
+        "kv: error calling fstat", fpath,
+        std::error_code(errno, std::system_category()));
+  }
+
+  return st;
+}
+
+void FileHandle::stage(const std::string& value) {
+  auto tmp = fpath.parent_path() / ("." + fpath.filename().string() + ".tmp");
+
+  FILE* tfp = fopen(tmp.c_str(), "w");
+  if (!tfp) {
+    throw fs::filesystem_error(
+        "kv: error opening file", tmp,
+        std::error_code(errno, std::system_category()));
+  }
+  staged = tmp;
+
+  auto bytes = fwrite(value.data(), 1, value.size(), tfp);
+  bool ok = (bytes == value.size()) && (fflush(tfp) == 0) &&
+            (fsync(fileno(tfp)) == 0);
+  auto err = (bytes == value.size()) ? errno : ENOSPC;
+  fclose(tfp);
+
+  if (!ok) {
+    throw fs::filesystem_error(
+        "kv: error writing to file", tmp,
+        std::error_code(err, std::system_category()));
+  }
+}
+
+void FileHandle::commit() {
+  fs::rename(staged, fpath);
+  staged.clear();
+}
+
+void FileHandle::unlink() {
+  std::error_code ec;
+  fs::remove(fpath, ec);
+}
+
 void FileHandle::remove(const std::string& key, region r)
 {
   //If a file is passed as key and it exists, remove it.
@@ -158,4 +226,29 @@ void FileHandle::remove(const std::string& key, region r)
   }
 }
 
+RegionLock::RegionLock(region r, bool exclusive) {
+  FileHandle::path p = r == region::persist ? kv_store : cache_store;
+  create_dir(p);
+
+  fd = open(p.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    throw fs::filesystem_error(
+        "kv: error opening directory", p,
+        std::error_code(errno, std::system_category()));
+  }
+
+  if (flock(fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+    auto err = errno;
+    close(fd);
+    throw fs::filesystem_error(
+        "kv: error calling flock", p,
+        std::error_code(err, std::system_category()));
+  }
+}
+
+RegionLock::~RegionLock() {
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
 } // namespace kv
@@ -15,6 +15,7 @@ namespace std
 #endif
 #include <string>
 #include <sys/file.h>
+#include <sys/stat.h>
 
 #include "kv.hpp"
 
@@ -31,6 +32,10 @@ class FileHandle
     FileHandle() {};
 
     ~FileHandle() {
+      if (!staged.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(staged, ec);
+      }
       if (fp) {
         if (locked) {
           flock(fileno(fp), LOCK_UN);
@@ -47,6 +52,21 @@ class FileHandle
     void write(std::string value);
     static void remove(const std::string& key, region r);
 
+    /* Path of the file backing key, without creating its directory. */
+    static path key_path(const std::string& key, region r);
+
+    /* fstat() of the open file. */
+    struct stat status();
+
+    /* Write value to a temporary file next to the key file; commit()
+     * then renames it over the key file, so the key is never seen
+     * partially written.  Uncommitted files are removed on destruction. */
+    void stage(const std::string& value);
+    void commit();
+
+    /* Remove the (locked) key file. */
+    void unlink();
+
     FileHandle(const FileHandle&) = delete;
     FileHandle(FileHandle&&) = delete;
     FileHandle& operator=(const FileHandle&) = delete;
@@ -60,8 +80,29 @@ class FileHandle
 
     FILE* fp = nullptr;
     path fpath = {};
+    path staged = {};
     bool present = false;
     bool locked = false;
 };
 
+/* Lock over a whole region, taken by the batch operations so that
+ * readers of a group of keys never see it half updated.  Single key
+ * operations only lock their own file. */
+class RegionLock
+{
+  public:
+
+    RegionLock(region r, bool exclusive);
+    ~RegionLock();
+
+    RegionLock(const RegionLock&) = delete;
+    RegionLock(RegionLock&&) = delete;
+    RegionLock& operator=(const RegionLock&) = delete;
+    RegionLock& operator=(RegionLock&&) = delete;
+
+  private:
+
+    int fd = -1;
+};
+
 } // namespace kv
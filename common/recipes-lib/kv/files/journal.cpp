@@ -0,0 +1,393 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "journal.hpp"
+#include "fileops.hpp"
+#include "log.hpp"
+
+namespace fs = std::filesystem;
+
+namespace kv
+{
+
+/* Path of the journal, next to (not in) the persistent region so kv::del
+ * regexes and directory listings never see it. */
+#ifndef __TEST__
+constexpr auto journal_path = "/mnt/data/kv_store.journal";
+#else
+constexpr auto journal_path = "./test/persist.journal";
+#endif
+
+/* Compaction limits. */
+constexpr uint64_t journal_max_size = 64 * 1024;
+constexpr uint32_t journal_max_age = 600; // seconds
+
+constexpr uint32_t frame_magic = 0x314a564b; // "KVJ1"
+
+/* Every frame is a header followed by len bytes of records, each being
+ * the key and value lengths (uint16_t) followed by the key and value. */
+struct frame_header
+{
+  uint32_t magic;
+  uint32_t crc;
+  uint32_t len;
+  uint32_t time;
+};
+
+static uint32_t crc32(const char* data, size_t len)
+{
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ uint8_t(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xffffffff;
+}
+
+using record_callback =
+    std::function<void(const std::string& key, const std::string& value)>;
+
+/* Parse the frames in buf, returns the length of the valid ones. */
+static size_t parse_frames(const std::vector<char>& buf,
+                           const record_callback& cb, uint32_t* first_time)
+{
+  size_t pos = 0;
+  while (buf.size() - pos >= sizeof(frame_header)) {
+    frame_header hdr;
+    memcpy(&hdr, buf.data() + pos, sizeof(hdr));
+    auto payload = buf.data() + pos + sizeof(hdr);
+    if (hdr.magic != frame_magic ||
+        hdr.len > buf.size() - pos - sizeof(hdr) ||
+        crc32(payload, hdr.len) != hdr.crc) {
+      break;
+    }
+
+    for (size_t off = 0; off + 4 <= hdr.len; ) {
+      uint16_t klen, vlen;
+      memcpy(&klen, payload + off, 2);
+      memcpy(&vlen, payload + off + 2, 2);
+      off += 4;
+      if (off + klen + vlen > hdr.len) {
+        break;
+      }
+      cb(std::string(payload + off, klen),
+         std::string(payload + off + klen, vlen));
+      off += klen + vlen;
+    }
+
+    if (first_time && *first_time == 0) {
+      *first_time = hdr.time;
+    }
+    pos += sizeof(hdr) + hdr.len;
+  }
+  return pos;
+}
+
+static std::vector<char> read_from(int fd, uint64_t offset, uint64_t end)
+{
+  std::vector<char> buf(end > offset ? end - offset : 0);
+  size_t done = 0;
+  while (done < buf.size()) {
+    auto n = pread(fd, buf.data() + done, buf.size() - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      throw fs::filesystem_error(
+          "kv: error reading journal", journal_path,
+          std::error_code(n < 0 ? errno : EIO, std::system_category()));
+    }
+    done += n;
+  }
+  return buf;
+}
+
+Journal& Journal::instance()
+{
+  static Journal journal;
+  return journal;
+}
+
+std::string Journal::path()
+{
+  return journal_path;
+}
+
+Journal::~Journal()
+{
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+/* Lock the current journal file and bring the index up to date with it. */
+void Journal::lock(int operation)
+{
+  struct stat opened, current;
+
+  for (;;) {
+    // Children of a fork need a file (and so a lock) of their own.
+    if (fd >= 0 && owner != getpid()) {
+      close(fd);
+      fd = -1;
+    }
+    if (fd < 0) {
+      fs::create_directories(fs::path(journal_path).parent_path());
+      fd = open(journal_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (fd < 0) {
+        throw fs::filesystem_error(
+            "kv: error opening journal", journal_path,
+            std::error_code(errno, std::system_category()));
+      }
+      owner = getpid();
+    }
+
+    if (flock(fd, operation) != 0) {
+      throw fs::filesystem_error(
+          "kv: error calling flock", journal_path,
+          std::error_code(errno, std::system_category()));
+    }
+
+    // Compaction replaces the file, start over if that happened while
+    // waiting for the lock.
+    if (fstat(fd, &opened) == 0 && ::stat(journal_path, &current) == 0 &&
+        opened.st_ino == current.st_ino) {
+      break;
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+    fd = -1;
+  }
+
+  if (opened.st_ino != ino || uint64_t(opened.st_size) < parsed) {
+    ino = opened.st_ino;
+    parsed = 0;
+    started = 0;
+    index.clear();
+  }
+  size = opened.st_size;
+  if (size > parsed) {
+    auto buf = read_from(fd, parsed, size);
+    parsed += parse_frames(buf,
+        [this](const std::string& key, const std::string& value) {
+          index[key] = value;
+        }, &started);
+  }
+}
+
+void Journal::unlock()
+{
+  if (fd >= 0) {
+    flock(fd, LOCK_UN);
+  }
+}
+
+bool Journal::get(const std::string& key, std::string& value)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  lock(LOCK_SH);
+
+  auto it = index.find(key);
+  bool found = it != index.end();
+  if (found) {
+    value = it->second;
+  }
+
+  unlock();
+  return found;
+}
+
+void Journal::append(const std::map<std::string, std::string>& values,
+                     bool require_create)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  lock(LOCK_EX);
+
+  try {
+    std::string payload;
+    std::map<std::string, std::string> changed;
+    for (const auto& [key, value] : values) {
+      bool present = true;
+      std::string current;
+      auto it = index.find(key);
+      if (it != index.end()) {
+        current = it->second;
+      } else if (fs::exists(FileHandle::key_path(key, region::persist))) {
+        FileHandle fp;
+        fp.open_and_lock<FileHandle::access::read>(key, region::persist);
+        current = fp.read();
+      } else {
+        present = false;
+      }
+
+      if (present && require_create) {
+        throw key_already_exists("kv_set: key " + key + " already exists");
+      }
+      // Like kv::set, skip values which did not change.
+      if (present && current == value) {
+        continue;
+      }
+
+      uint16_t lens[2] = { uint16_t(key.size()), uint16_t(value.size()) };
+      payload.append(reinterpret_cast<const char*>(lens), sizeof(lens));
+      payload += key;
+      payload += value;
+      changed[key] = value;
+    }
+
+    if (!payload.empty()) {
+      frame_header hdr = { frame_magic, crc32(payload.data(), payload.size()),
+                           uint32_t(payload.size()), uint32_t(time(nullptr)) };
+      std::string frame(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+      frame += payload;
+
+      // Drop a frame torn by a crash, it would hide this one.
+      if (size > parsed && ftruncate(fd, parsed) != 0) {
+        throw fs::filesystem_error(
+            "kv: error calling ftruncate", journal_path,
+            std::error_code(errno, std::system_category()));
+      }
+      auto n = pwrite(fd, frame.data(), frame.size(), parsed);
+      if (n != ssize_t(frame.size())) {
+        throw fs::filesystem_error(
+            "kv: error writing journal", journal_path,
+            std::error_code(n < 0 ? errno : ENOSPC, std::system_category()));
+      }
+
+      for (const auto& [key, value] : changed) {
+        index[key] = value;
+      }
+      parsed += frame.size();
+      size = parsed;
+      if (started == 0) {
+        started = hdr.time;
+      }
+    }
+
+    if (parsed > journal_max_size ||
+        (started != 0 && uint32_t(time(nullptr)) - started > journal_max_age)) {
+      compact_locked();
+    }
+  } catch (...) {
+    unlock();
+    throw;
+  }
+  unlock();
+}
+
+void Journal::compact_locked(const std::string* remove_key)
+{
+  for (const auto& [key, value] : index) {
+    FileHandle fp;
+    fp.open_and_lock<FileHandle::access::write>(key, region::persist);
+    if (!fp.was_present() || fp.read() != value) {
+      fp.stage(value);
+      fp.commit();
+    }
+  }
+
+  // Still holding the lock of the old journal, so nobody can set the
+  // key again in between.
+  if (remove_key) {
+    FileHandle::remove(*remove_key, region::persist);
+  }
+
+  // Replace the journal with an empty one; whoever waits for the lock of
+  // the old one will notice and move on to the new one.
+  auto tmp = std::string(journal_path) + ".tmp";
+  int tfd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (tfd < 0) {
+    throw fs::filesystem_error(
+        "kv: error creating journal", tmp,
+        std::error_code(errno, std::system_category()));
+  }
+  close(tfd);
+  fs::rename(tmp, journal_path);
+
+  flock(fd, LOCK_UN);
+  close(fd);
+  fd = -1;
+  ino = 0;
+  parsed = 0;
+  size = 0;
+  started = 0;
+  index.clear();
+}
+
+void Journal::compact()
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  lock(LOCK_EX);
+
+  try {
+    if (parsed > 0) {
+      compact_locked();
+    }
+  } catch (...) {
+    unlock();
+    throw;
+  }
+  unlock();
+}
+
+void Journal::remove(const std::string& key)
+{
+  std::lock_guard<std::mutex> guard(mutex);
+  lock(LOCK_EX);
+
+  try {
+    compact_locked(&key);
+  } catch (...) {
+    unlock();
+    throw;
+  }
+  unlock();
+}
+
+void Journal::changes(uint64_t& ino, uint64_t& offset, const key_callback& cb)
+{
+  int jfd = open(journal_path, O_RDONLY | O_CLOEXEC);
+  if (jfd < 0) {
+    return;
+  }
+
+  struct stat st;
+  if (flock(jfd, LOCK_SH) == 0 && fstat(jfd, &st) == 0) {
+    if (uint64_t(st.st_ino) != ino || uint64_t(st.st_size) < offset) {
+      ino = st.st_ino;
+      offset = 0;
+    }
+    try {
+      auto buf = read_from(jfd, offset, st.st_size);
+      offset += parse_frames(buf,
+          [&cb](const std::string& key, const std::string&) { cb(key); },
+          nullptr);
+    } catch (std::exception& e) {
+      KV_WARN("kv: %s", e.what());
+    }
+  }
+  close(jfd);
+}
+
+} // namespace kv
@@ -0,0 +1,100 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+
+#include <sys/types.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "kv.hpp"
+
+namespace kv
+{
+
+/* Built with -Dpersist-journal: persistent writes go to the journal. */
+#ifdef KV_PERSIST_JOURNAL
+constexpr bool journal_enabled = true;
+#else
+constexpr bool journal_enabled = false;
+#endif
+
+/* Append-only journal in front of the persistent region.  Each set (or
+ * set_multi) appends one checksummed frame instead of rewriting key files
+ * on flash, and reads consult the journal before the key files.  Once the
+ * journal grows past a size or age limit it is compacted: the latest value
+ * of every key is written to its key file (once, however often the key
+ * was set) and the journal is replaced by an empty one.
+ *
+ * A frame torn by a crash fails its checksum and is dropped, together
+ * with anything after it; whole frames are replayed by the next reader.
+ * Compaction is idempotent, so a crash in the middle of it is harmless.
+ *
+ * Key files of keys in the journal are stale until compaction, so this
+ * is only for platforms where nothing reads /mnt/data/kv_store directly
+ * (flush() can be used before handing the files to someone else). */
+class Journal
+{
+  public:
+
+    using key_callback = std::function<void(const std::string& key)>;
+
+    static Journal& instance();
+
+    /* Latest value of key in the journal.  Returns false if the journal
+     * has no record of it: the key file is current then. */
+    bool get(const std::string& key, std::string& value);
+
+    /* Append the values which differ from the current ones in one frame.
+     * With require_create nothing is written if any key exists. */
+    void append(const std::map<std::string, std::string>& values,
+                bool require_create);
+
+    /* Remove the key (a regex like kv::del), compacting the journal under
+     * the same lock. */
+    void remove(const std::string& key);
+
+    /* Write everything to the key files and empty the journal. */
+    void compact();
+
+    /* Report the keys of frames appended since the previous call with the
+     * same cursor (ino, offset), which start out as 0. */
+    static void changes(uint64_t& ino, uint64_t& offset,
+                        const key_callback& cb);
+
+    static std::string path();
+
+    Journal(const Journal&) = delete;
+    Journal(Journal&&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    Journal& operator=(Journal&&) = delete;
+
+  private:
+
+    Journal() = default;
+    ~Journal();
+
+    void lock(int operation);
+    void unlock();
+    // Write the index to the key files, remove remove_key (a regex) if
+    // given, and start an empty journal.
+    void compact_locked(const std::string* remove_key = nullptr);
+
+    int fd = -1;
+    pid_t owner = 0;
+    uint64_t ino = 0;
+    // End of the last valid frame, everything before is in index.
+    uint64_t parsed = 0;
+    // Size of the file, beyond parsed if the last frame was torn.
+    uint64_t size = 0;
+    // Time of the first frame.
+    uint32_t started = 0;
+    std::map<std::string, std::string> index;
+    std::mutex mutex;
+};
+
+} // namespace kv
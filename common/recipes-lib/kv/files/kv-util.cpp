@@ -1,3 +1,4 @@
+#include <poll.h>
 #include <iostream>
 #include <string>
 #include "kv.hpp"
@@ -11,6 +12,11 @@ void usage(const char* exe_name) {
          "        set <key> <value> <type|>*\n"
          "    del:\n"
          "        del <key> <type|>*\n"
+         "    flush:\n"
+         "        Write journaled persistent keys to their files.\n"
+         "    watch:\n"
+         "        watch <prefix> <type|>*\n"
+         "        Print keys starting with prefix as they change.\n"
          "\n"
          "    valid types:\n"
          "        persistent - use the persistent kv store.\n"
@@ -87,6 +93,44 @@ int cmd_del(int argc, const char** argv) {
   return 0;
 }
 
+/** Handle 'flush' subcommand. */
+int cmd_flush() {
+  try {
+    kv::flush();
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/** Handle 'watch' subcommand. */
+int cmd_watch(int argc, const char** argv) {
+  if (argc <= pos_key) {
+    // Not enough args.
+    usage(argv[pos_exe]);
+    return 1;
+  }
+
+  // Parse flags
+  auto r = region(argc <= pos_get_flag ? "" : argv[pos_get_flag]);
+
+  try {
+    kv::watch w;
+    w.add(argv[pos_key], r);
+
+    struct pollfd pfd = {w.fd(), POLLIN, 0};
+    while (poll(&pfd, 1, -1) >= 0) {
+      w.dispatch([](const std::string& key, kv::region) {
+        std::cout << key << std::endl;
+      });
+    }
+  } catch (std::exception& e) {
+    std::cerr << argv[pos_key] << " Error: " << e.what() << std::endl;
+  }
+  return 1;
+}
+
 /** Handle 'set' subcommand. */
 int cmd_set(int argc, const char** argv) {
   if (argc < pos_set_value) {
@@ -119,6 +163,10 @@ int main(int argc, const char** argv) {
       return cmd_del(argc, argv);
     } else if (std::string("set") == argv[pos_cmd]) {
       return cmd_set(argc, argv);
+    } else if (std::string("flush") == argv[pos_cmd]) {
+      return cmd_flush();
+    } else if (std::string("watch") == argv[pos_cmd]) {
+      return cmd_watch(argc, argv);
     } else if (std::string("help") == argv[pos_cmd]) {
       usage(argv[pos_exe]);
       return 0;
@@ -5,47 +5,64 @@
 #include <syslog.h>
 #include <limits>
 #include <iostream>
+#include <memory>
 
 #include "kv.hpp"
 #include "fileops.hpp"
+#include "journal.hpp"
+#include "shmcache.hpp"
 #include "log.hpp"
 
 using namespace kv;
 
 /*
-*  set key::value
-*  len is the size of value. If 0, it is assumed value is
-*      a string and strlen() is used to determine the length.
-*  flags is bitmask of options.
+*  Check the size of a value passed to kv_set.
+*  A len of 0 means value is a string, the length of which is returned.
 *
-*  return 0 on success, negative error code on failure.
+*  return 0 on success, -1 with errno set on failure.
 */
-int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
-  if (key == nullptr || value == nullptr) {
-    errno = EINVAL;
-    return -1;
-  }
-
+static int check_value_len(const char *value, size_t *len) {
   /* Length of zero implies we should treat it like a string. */
-  if (len == 0) {
+  if (*len == 0) {
     /* The typical buffer allocated is exactly MAX_VALUE_LEN bytes, so we
      * cannot go past this when calculating strlen. */
-    len = strnlen(value, MAX_VALUE_LEN);
+    *len = strnlen(value, MAX_VALUE_LEN);
 
     /* Unfortunately, this means we do not know if the buffer was null
      * terminated at value[MAX_VALUE_LEN] or missing a null terminator
      * (and we cannot look at it without possibly exceeding the buffer).
      * Assume it is missing and give E2BIG error. */
-    if (len >= MAX_VALUE_LEN) {
+    if (*len >= MAX_VALUE_LEN) {
       errno = E2BIG;
       return -1;
     }
   }
-  if (len > MAX_VALUE_LEN) {
+  if (*len > MAX_VALUE_LEN) {
     errno = E2BIG;
     return -1;
   }
 
+  return 0;
+}
+
+/*
+*  set key::value
+*  len is the size of value. If 0, it is assumed value is
+*      a string and strlen() is used to determine the length.
+*  flags is bitmask of options.
+*
+*  return 0 on success, negative error code on failure.
+*/
+int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
+  if (key == nullptr || value == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (check_value_len(value, &len) != 0) {
+    return -1;
+  }
+
   try {
     std::string data{value, value + len};
     auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
@@ -67,6 +84,33 @@ int kv_set(const char *key, const char *value, size_t len, unsigned int flags) {
   return 0;
 }
 
+/*
+*  Copy a value read for key to the caller's buffer, which is
+*  MAX_VALUE_LEN bytes.  If len is NULL the value is treated as a string.
+*/
+static void copy_value(const char *key, const std::string& result,
+                       char *value, size_t *len) {
+  auto bytes = result.size();
+
+  // result is required to be less than or equal to 'MAX_VALUE_LEN' and
+  // value is required to have enough space to store at least that, so
+  // this copy is always safe.
+  std::copy(std::begin(result), std::end(result), value);
+
+  // Update length variable.
+  if (len != nullptr)
+    *len = bytes;
+  // If no length was given, treat it as a string.  Ensure we have a null
+  // terminator.
+  else if ((bytes + 1) < max_len)
+    value[bytes] = '\0';
+  else if (value[max_len - 1] != '\0') {
+    KV_WARN("kv_get: truncating string-type value for key %s with length %zd",
+        key, bytes);
+    value[max_len - 1] = '\0';
+  }
+}
+
 /*
 *  get key::value
 *  len is the return size of value. If NULL then this information
@@ -84,25 +128,7 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags) {
   try {
     auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
     auto result = kv::get(key, r);
-    auto bytes = result.size();
-
-    // result is required to be less than or equal to 'MAX_VALUE_LEN' and
-    // value is required to have enough space to store at least that, so
-    // this copy is always safe.
-    std::copy(std::begin(result), std::end(result), value);
-
-    // Update length variable.
-    if (len != nullptr)
-      *len = bytes;
-    // If no length was given, treat it as a string.  Ensure we have a null
-    // terminator.
-    else if ((bytes + 1) < max_len)
-      value[bytes] = '\0';
-    else if (value[max_len - 1] != '\0') {
-      KV_WARN("kv_get: truncating string-type value for key %s with length %zd",
-          key, bytes);
-      value[max_len - 1] = '\0';
-    }
+    copy_value(key, result, value, len);
   } catch (std::filesystem::filesystem_error& e) {
     // Eat no-such-file errors and just return a -1.
     // Too many callers try to look up kv-entries for entries that haven't
@@ -143,11 +169,105 @@ int kv_del(const char *key, unsigned int flags)
   return 0;
 }
 
+/*
+*  get a group of keys.
+*  values[i] receives the value of keys[i], see kv_get.
+*
+*  return 0 on success, negative error code on failure.
+*/
+int kv_get_multi(const char **keys, char **values, size_t *lens,
+                 size_t count, unsigned int flags) {
+  if (keys == nullptr || values == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    std::vector<std::string> k;
+    for (size_t i = 0; i < count; ++i) {
+      if (keys[i] == nullptr || values[i] == nullptr) {
+        errno = EINVAL;
+        return -1;
+      }
+      k.emplace_back(keys[i]);
+    }
+
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    auto results = kv::get_multi(k, r);
+
+    for (size_t i = 0; i < count; ++i) {
+      copy_value(keys[i], results[i], values[i],
+                 lens != nullptr ? &lens[i] : nullptr);
+    }
+  } catch (std::filesystem::filesystem_error& e) {
+    errno = e.code().value();
+    if (e.code().value() == ENOENT) {
+      return -1;
+    }
+
+    KV_WARN("kv_get_multi: %s", e.what());
+    return -1;
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_get_multi: %s", e.what());
+    return -1;
+  }
+
+  return 0;
+}
+
+/*
+*  set a group of keys::values as one transaction.
+*  lens[i] is the size of values[i], see kv_set.  If lens is NULL all
+*      values are strings.
+*
+*  return 0 on success, negative error code on failure.
+*/
+int kv_set_multi(const char **keys, const char **values, const size_t *lens,
+                 size_t count, unsigned int flags) {
+  if (keys == nullptr || values == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  try {
+    std::map<std::string, std::string> data;
+    for (size_t i = 0; i < count; ++i) {
+      if (keys[i] == nullptr || values[i] == nullptr) {
+        errno = EINVAL;
+        return -1;
+      }
+      size_t len = lens != nullptr ? lens[i] : 0;
+      if (check_value_len(values[i], &len) != 0) {
+        return -1;
+      }
+      data[keys[i]] = std::string{values[i], values[i] + len};
+    }
+
+    auto r = (flags & KV_FPERSIST) ? region::persist : region::temp;
+    kv::set_multi(data, r, flags & KV_FCREATE);
+
+  } catch (kv::key_already_exists& e) {
+    errno = EEXIST;
+    return -1;
+  } catch (std::exception& e) {
+    errno = EIO;
+    KV_WARN("kv_set_multi: %s", e.what());
+    return -1;
+  }
+
+  return 0;
+}
+
 namespace kv {
 
 void set(const std::string& key, const std::string& value,
          region r, bool require_create)
 {
+  if (journal_enabled && r == region::persist) {
+    Journal::instance().append({{key, value}}, require_create);
+    return;
+  }
 
   FileHandle fp;
   fp.open_and_lock<FileHandle::access::write>(key, r);
@@ -164,20 +284,126 @@ void set(const std::string& key, const std::string& value,
   }
 
   fp.write(value);
+
+  // Update the cache while the file is still locked, so concurrent
+  // setters update it in the same order as the file.
+  if (r == region::temp) {
+    ShmCache::instance().put(key, value, file_version::of(fp.status()));
+  }
 }
 
 std::string get(const std::string& key, region r)
 {
+  std::string value;
+  if (r == region::temp &&
+      ShmCache::instance().get(key, FileHandle::key_path(key, r), value)) {
+    return value;
+  }
+  if (journal_enabled && r == region::persist &&
+      Journal::instance().get(key, value)) {
+    return value;
+  }
+
   FileHandle fp;
   fp.open_and_lock<FileHandle::access::read>(key, r);
 
-  return fp.read();
+  if (r != region::temp) {
+    return fp.read();
+  }
+
+  // Writers outside the library do not take the lock, only cache the
+  // value if the file did not change while reading it.
+  auto ver = file_version::of(fp.status());
+  value = fp.read();
+  if (file_version::of(fp.status()) == ver) {
+    ShmCache::instance().put(key, value, ver);
+  }
+  return value;
 }
 
 void del(const std::string& key, region r)
 {
+  if (journal_enabled && r == region::persist) {
+    Journal::instance().remove(key);
+    return;
+  }
+
   FileHandle::remove(key, r);
 }
 
+void flush()
+{
+  if (journal_enabled) {
+    Journal::instance().compact();
+  }
+}
+
+std::vector<std::string> get_multi(const std::vector<std::string>& keys,
+                                   region r)
+{
+  RegionLock lock(r, false);
+
+  std::vector<std::string> values;
+  for (const auto& key : keys) {
+    values.push_back(get(key, r));
+  }
+  return values;
+}
+
+void set_multi(const std::map<std::string, std::string>& values,
+               region r, bool require_create)
+{
+  RegionLock lock(r, true);
+
+  // A journal frame is atomic by itself.
+  if (journal_enabled && r == region::persist) {
+    Journal::instance().append(values, require_create);
+    return;
+  }
+
+  // Lock every key first (in key order, which the map provides), so no
+  // value is written unless the whole batch can be.
+  std::vector<std::unique_ptr<FileHandle>> files;
+  for (const auto& [key, value] : values) {
+    auto& fp = files.emplace_back(std::make_unique<FileHandle>());
+    fp->open_and_lock<FileHandle::access::write>(key, r);
+
+    if (fp->was_present() && require_create) {
+      // Opening for write created the missing keys locked so far.
+      for (auto& f : files) {
+        if (!f->was_present()) {
+          f->unlink();
+        }
+      }
+      throw key_already_exists("kv_set: key " + key + " already exists");
+    }
+  }
+
+  if (r == region::temp) {
+    auto fp = files.begin();
+    for (const auto& [key, value] : values) {
+      (*fp)->write(value);
+      ShmCache::instance().put(key, value, file_version::of((*fp)->status()));
+      ++fp;
+    }
+    return;
+  }
+
+  // Stage everything before replacing any key, so running out of space
+  // leaves the old values in place.
+  std::vector<FileHandle*> changed;
+  auto fp = files.begin();
+  for (const auto& [key, value] : values) {
+    if (!(*fp)->was_present() || (*fp)->read() != value) {
+      (*fp)->stage(value);
+      changed.push_back(fp->get());
+    }
+    ++fp;
+  }
+  for (auto f : changed) {
+    f->commit();
+  }
+}
+
 
 } // namespace kv
@@ -30,6 +30,31 @@ int kv_get(const char *key, char *value, size_t *len, unsigned int flags);
 int kv_set(const char *key, const char *value, size_t len, unsigned int flags);
 int kv_del(const char *key, unsigned int flags);
 
+/* Batch versions of kv_get/kv_set operating on count keys at once.
+ * Values and lengths follow the same rules as for the single key calls
+ * (lens may be NULL for strings; each values[i] of kv_get_multi needs
+ * MAX_VALUE_LEN bytes).  Readers using kv_get_multi never see a batch of
+ * kv_set_multi half applied, and persistent keys are each replaced
+ * atomically.  With KV_FCREATE nothing is written if any key exists. */
+int kv_get_multi(const char **keys, char **values, size_t *lens,
+                 size_t count, unsigned int flags);
+int kv_set_multi(const char **keys, const char **values, const size_t *lens,
+                 size_t count, unsigned int flags);
+
+/* Change notification.  kv_watch_open() returns a descriptor which
+ * becomes readable (poll/select) when a key under one of the prefixes
+ * added with kv_watch_add() may have changed.  kv_watch_dispatch() then
+ * calls cb for each such key, without blocking, and returns the number
+ * of keys reported.  flags of the callback tell the region of the key.
+ * The callback may use the other watches and close its own, but must
+ * not kv_watch_add() or kv_watch_dispatch() the watch it is called for. */
+typedef void (*kv_watch_cb)(const char *key, unsigned int flags, void *arg);
+
+int kv_watch_open(void);
+int kv_watch_add(int fd, const char *prefix, unsigned int flags);
+int kv_watch_dispatch(int fd, kv_watch_cb cb, void *arg);
+int kv_watch_close(int fd);
+
 #ifdef __cplusplus
 }
 #endif
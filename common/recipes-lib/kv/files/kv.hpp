@@ -3,8 +3,11 @@
 /* SPDX-License-Identifier: GPL-2.0-or-later
  * Copyright 2020-present Facebook. All Rights Reserved.
  */
+#include <functional>
+#include <map>
 #include <stdexcept>
 #include <string>
+#include <vector>
 #if (__GNUC__ < 8)
 #include <experimental/filesystem>
 namespace std {
@@ -26,6 +29,56 @@ void set(const std::string& key, const std::string& value,
     region r = region::temp, bool require_create = false);
 void del(const std::string& key, region r = region::temp);
 
+/* Write persistent values still held in the journal (if the library was
+ * built with one) to their key files. */
+void flush();
+
+/* Read/write a group of keys as one transaction (see kv_get_multi). */
+std::vector<std::string> get_multi(const std::vector<std::string>& keys,
+    region r = region::temp);
+void set_multi(const std::map<std::string, std::string>& values,
+    region r = region::temp, bool require_create = false);
+
+/* Notifies changes of keys under a set of prefixes, instead of polling
+ * them.  fd() becomes readable when a watched key may have changed;
+ * dispatch() then calls cb with each such key.  Keys which were deleted
+ * are reported as well, cb has to look them up to tell. */
+class watch {
+  public:
+    using callback = std::function<void(const std::string& key, region r)>;
+
+    watch();
+    ~watch();
+
+    /* Watch keys starting with prefix. */
+    void add(const std::string& prefix, region r = region::temp);
+
+    int fd() const { return ifd; }
+
+    /* Handle pending notifications without blocking.  Returns the
+     * number of keys reported. */
+    size_t dispatch(const callback& cb);
+
+    watch(const watch&) = delete;
+    watch(watch&&) = delete;
+    watch& operator=(const watch&) = delete;
+    watch& operator=(watch&&) = delete;
+
+  private:
+    struct dir { std::string key; region r; };
+
+    bool relevant(const std::string& key, region r) const;
+    void add_dir(const std::string& key, region r, const callback* cb);
+
+    int ifd = -1;
+    std::map<int, dir> dirs;
+    // Directory of the persistent journal and the position read up to.
+    int journal_wd = -1;
+    uint64_t journal_ino = 0;
+    uint64_t journal_offset = 0;
+    std::vector<std::pair<std::string, region>> prefixes;
+};
+
 struct key_already_exists : public std::filesystem::filesystem_error {
   explicit key_already_exists(const std::string& msg)
       : std::filesystem::filesystem_error(
@@ -88,3 +88,43 @@ def kv_del(key, flags=0):
     ret = lkv_hndl.kv_del(key_c, ctypes.c_uint(flags))
     if ret != 0:
         _handle_error()
+
+
+def kv_get_multi(keys, flags=0, binary=False):
+    """Read a group of keys as one transaction, returns a dict."""
+    count = len(keys)
+    keys_c = (ctypes.c_char_p * count)(*[k.encode() for k in keys])
+    buffers = [ctypes.create_string_buffer(256) for _ in keys]
+    values_c = (ctypes.c_char_p * count)(
+        *[ctypes.cast(b, ctypes.c_char_p) for b in buffers]
+    )
+    lengths = (ctypes.c_size_t * count)()
+    ret = lkv_hndl.kv_get_multi(
+        keys_c, values_c, lengths, ctypes.c_size_t(count), ctypes.c_uint(flags)
+    )
+    if ret != 0:
+        _handle_error()
+    result = {}
+    for key, buf, length in zip(keys, buffers, lengths):
+        value = buf.raw[:length]
+        result[key] = value if binary else value.split(b"\0", 1)[0].decode()
+    return result
+
+
+def kv_set_multi(values, flags=0):
+    """Write a dict of keys and values as one transaction."""
+    count = len(values)
+    keys_c = (ctypes.c_char_p * count)()
+    values_c = (ctypes.c_char_p * count)()
+    lengths = (ctypes.c_size_t * count)()
+    for i, (key, value) in enumerate(values.items()):
+        if not isinstance(value, (bytes, bytearray)):
+            value = value.encode()
+        keys_c[i] = key.encode()
+        values_c[i] = bytes(value)
+        lengths[i] = len(value)
+    ret = lkv_hndl.kv_set_multi(
+        keys_c, values_c, lengths, ctypes.c_size_t(count), ctypes.c_uint(flags)
+    )
+    if ret != 0:
+        _handle_error()
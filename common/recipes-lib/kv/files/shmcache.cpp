@@ -0,0 +1,290 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "shmcache.hpp"
+#include "log.hpp"
+
+namespace kv
+{
+
+/* Path of the shared segment. */
+#ifndef __TEST__
+constexpr auto shm_path = "/dev/shm/kv_cache";
+#else
+constexpr auto shm_path = "./test/kv_cache";
+#endif
+
+constexpr uint32_t shm_magic = 0x6b766330; // "kvc0"
+constexpr uint32_t shm_version = 1;
+constexpr uint32_t num_slots = 1024;
+constexpr uint32_t probe_len = 4;
+constexpr int max_read_attempts = 16;
+
+struct ShmCache::header
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_slots;
+  // Round robin victim when a probe window is full.
+  uint32_t next_victim;
+};
+
+struct ShmCache::slot
+{
+  // Odd while the slot is being written.
+  std::atomic<uint32_t> seq;
+  uint16_t key_len;
+  uint16_t value_len;
+  file_version ver;
+  char key[MAX_KEY_PATH_LEN];
+  char value[MAX_VALUE_LEN];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+    "seqlock must be usable across processes");
+
+file_version file_version::of(const struct stat& st)
+{
+  file_version v;
+  v.ino = st.st_ino;
+  v.size = st.st_size;
+  v.mtime_ns = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  v.ctime_ns = int64_t(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+  return v;
+}
+
+bool file_version::operator==(const file_version& other) const
+{
+  return ino == other.ino && size == other.size &&
+         mtime_ns == other.mtime_ns && ctime_ns == other.ctime_ns;
+}
+
+static uint32_t hash_key(const std::string& key)
+{
+  // FNV-1a
+  uint32_t h = 2166136261u;
+  for (unsigned char c : key) {
+    h = (h ^ c) * 16777619u;
+  }
+  return h;
+}
+
+ShmCache& ShmCache::instance()
+{
+  static ShmCache cache;
+  return cache;
+}
+
+ShmCache::ShmCache()
+{
+  map_len = sizeof(header) + num_slots * sizeof(slot);
+
+  struct timespec res;
+  if (clock_getres(CLOCK_REALTIME_COARSE, &res) == 0) {
+    racy_ns = std::max<int64_t>(
+        racy_ns, 2 * (int64_t(res.tv_sec) * 1000000000 + res.tv_nsec));
+  }
+
+#ifdef __TEST__
+  mkdir("./test", 0755);
+#endif
+  fd = open(shm_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    KV_WARN("kv: cannot open %s: %s", shm_path, strerror(errno));
+    return;
+  }
+
+  // Whoever gets here first sizes and formats the segment.
+  struct stat st;
+  bool ok = flock(fd, LOCK_EX) == 0 && fstat(fd, &st) == 0;
+  if (ok && st.st_size == 0) {
+    ok = ftruncate(fd, map_len) == 0;
+    st.st_size = map_len;
+  }
+  void* addr = MAP_FAILED;
+  // A segment of another size was left behind by a library with a
+  // different layout; mapping it could fault past its end.
+  if (ok && size_t(st.st_size) == map_len) {
+    addr = mmap(nullptr, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (addr != MAP_FAILED) {
+    hdr = static_cast<header*>(addr);
+    if (hdr->magic == 0) {
+      hdr->version = shm_version;
+      hdr->num_slots = num_slots;
+      hdr->magic = shm_magic;
+    }
+  }
+  flock(fd, LOCK_UN);
+
+  if (addr == MAP_FAILED) {
+    KV_WARN("kv: cannot map %s", shm_path);
+    hdr = nullptr;
+  } else if (hdr->magic != shm_magic || hdr->version != shm_version ||
+             hdr->num_slots != num_slots) {
+    KV_WARN("kv: ignoring incompatible cache %s", shm_path);
+    munmap(addr, map_len);
+    hdr = nullptr;
+  } else {
+    slots = reinterpret_cast<slot*>(hdr + 1);
+    owner = getpid();
+    return;
+  }
+  close(fd);
+  fd = -1;
+}
+
+ShmCache::~ShmCache()
+{
+  if (hdr) {
+    munmap(hdr, map_len);
+  }
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+bool ShmCache::read_slot(const slot& s, std::string& key, std::string& value,
+                         file_version& ver) const
+{
+  char k[MAX_KEY_PATH_LEN];
+  char v[MAX_VALUE_LEN];
+
+  for (int attempt = 0; attempt < max_read_attempts; ++attempt) {
+    uint32_t seq = s.seq.load(std::memory_order_acquire);
+    if (seq & 1) {
+      continue;
+    }
+
+    // Lengths are clamped since a concurrent writer may be changing them.
+    size_t key_len = std::min<size_t>(s.key_len, sizeof(k));
+    size_t value_len = std::min<size_t>(s.value_len, sizeof(v));
+    ver = s.ver;
+    memcpy(k, s.key, key_len);
+    memcpy(v, s.value, value_len);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s.seq.load(std::memory_order_relaxed) == seq) {
+      key.assign(k, key_len);
+      value.assign(v, value_len);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ShmCache::write_slot(slot& s, const std::string& key,
+                          const std::string& value, const file_version& ver)
+{
+  // A writer which died mid-update leaves the sequence odd; it is
+  // simply completed by this update.
+  uint32_t seq = s.seq.load(std::memory_order_relaxed);
+  seq |= 1;
+  s.seq.store(seq, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  s.key_len = key.size();
+  s.value_len = value.size();
+  s.ver = ver;
+  memcpy(s.key, key.data(), key.size());
+  memcpy(s.value, value.data(), value.size());
+
+  s.seq.store(seq + 1, std::memory_order_release);
+}
+
+bool ShmCache::get(const std::string& key, const std::string& fpath,
+                   std::string& value)
+{
+  if (!slots || key.empty() || key.size() > MAX_KEY_PATH_LEN) {
+    return false;
+  }
+
+  auto h = hash_key(key);
+  std::string k;
+  file_version ver;
+  for (uint32_t i = 0; i < probe_len; ++i) {
+    if (!read_slot(slots[(h + i) % num_slots], k, value, ver)) {
+      return false;
+    }
+    if (k.empty()) {
+      return false;
+    }
+    if (k != key) {
+      continue;
+    }
+
+    struct stat st;
+    if (::stat(fpath.c_str(), &st) != 0 || !(file_version::of(st) == ver)) {
+      return false;
+    }
+
+    // File timestamps come from a coarse clock: a file modified within
+    // the same tick as ver may still have the same version.  Like git's
+    // racily clean entries, such entries are not trusted.
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    auto now_ns = int64_t(now.tv_sec) * 1000000000 + now.tv_nsec;
+    return now_ns - ver.mtime_ns > racy_ns &&
+           now_ns - ver.ctime_ns > racy_ns;
+  }
+  return false;
+}
+
+void ShmCache::put(const std::string& key, const std::string& value,
+                   const file_version& ver)
+{
+  if (!slots || key.empty() || key.size() > MAX_KEY_PATH_LEN ||
+      value.size() > MAX_VALUE_LEN) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(write_mutex);
+
+  // A forked child shares the open file of its parent, and with it the
+  // flock, so it needs a descriptor of its own.
+  if (getpid() != owner) {
+    int nfd = open(shm_path, O_RDWR | O_CLOEXEC);
+    if (nfd < 0) {
+      return;
+    }
+    close(fd);
+    fd = nfd;
+    owner = getpid();
+  }
+
+  if (flock(fd, LOCK_EX) != 0) {
+    return;
+  }
+
+  // Reuse the slot of the key or the first free one in the probe window,
+  // otherwise evict one.
+  auto h = hash_key(key);
+  slot* target = nullptr;
+  for (uint32_t i = 0; i < probe_len; ++i) {
+    slot& s = slots[(h + i) % num_slots];
+    if (s.key_len == key.size() && memcmp(s.key, key.data(), s.key_len) == 0) {
+      target = &s;
+      break;
+    }
+    if (!target && s.key_len == 0) {
+      target = &s;
+    }
+  }
+  if (!target) {
+    target = &slots[(h + hdr->next_victim++ % probe_len) % num_slots];
+  }
+  write_slot(*target, key, value, ver);
+
+  flock(fd, LOCK_UN);
+}
+
+} // namespace kv
@@ -0,0 +1,88 @@
+#pragma once
+
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "kv.hpp"
+
+namespace kv
+{
+
+/* Identifies a revision of a key file.  Any write to the file (through
+ * the library or not) changes at least one of these. */
+struct file_version
+{
+  uint64_t ino = 0;
+  int64_t size = 0;
+  int64_t mtime_ns = 0;
+  int64_t ctime_ns = 0;
+
+  static file_version of(const struct stat& st);
+  bool operator==(const file_version& other) const;
+};
+
+/* Cache of temp region values shared by all processes through a memory
+ * mapped hash table.  The key files stay the backing store: entries are
+ * tagged with the file_version of the file they were read from or written
+ * to, and a lookup only returns a value if the file still has that
+ * version, so keys written directly to /tmp/cache_store by scripts are
+ * never served stale (values written in the last few milliseconds are
+ * always read from the file).  Lookups are lock-free (a seqlock per
+ * slot), so a hit costs a stat() instead of a mkdir check, open, flock,
+ * read and close.  Updates are serialized with a flock on the segment.
+ *
+ * If the segment cannot be set up every lookup is a miss and the
+ * library falls back to the files alone. */
+class ShmCache
+{
+  public:
+
+    static ShmCache& instance();
+
+    /* Looks up key, whose file is fpath.  Returns false on a miss. */
+    bool get(const std::string& key, const std::string& fpath,
+             std::string& value);
+
+    /* Records that the file of key at version ver holds value. */
+    void put(const std::string& key, const std::string& value,
+             const file_version& ver);
+
+    ShmCache(const ShmCache&) = delete;
+    ShmCache(ShmCache&&) = delete;
+    ShmCache& operator=(const ShmCache&) = delete;
+    ShmCache& operator=(ShmCache&&) = delete;
+
+  private:
+
+    struct slot;
+    struct header;
+
+    ShmCache();
+    ~ShmCache();
+
+    bool read_slot(const slot& s, std::string& key, std::string& value,
+                   file_version& ver) const;
+    void write_slot(slot& s, const std::string& key,
+                    const std::string& value, const file_version& ver);
+
+    int fd = -1;
+    pid_t owner = 0;
+    header* hdr = nullptr;
+    slot* slots = nullptr;
+    size_t map_len = 0;
+    // Entries this recent are not trusted, see get().
+    int64_t racy_ns = 10000000;
+
+    // flock() does not exclude threads sharing the segment fd.
+    std::mutex write_mutex;
+};
+
+} // namespace kv
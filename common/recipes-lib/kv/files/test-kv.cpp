@@ -2,11 +2,23 @@
  * Copyright 2015-present Facebook. All Rights Reserved.
  */
 
+#include <poll.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <chrono>
+#include <memory>
+#include "fileops.hpp"
 #include "kv.hpp"
 
+#ifdef KV_PERSIST_JOURNAL
+constexpr bool kv_journal = true;
+#else
+constexpr bool kv_journal = false;
+#endif
+
 int main(int argc, char *argv[])
 {
   char value[MAX_VALUE_LEN*2];
@@ -19,6 +31,10 @@ int main(int argc, char *argv[])
 
   assert(kv_set("test1", "val", 0, KV_FPERSIST) == 0);
   printf("SUCCESS: Creating persist key func call\n");
+#ifdef KV_PERSIST_JOURNAL
+  assert(access("./test/persist/test1", F_OK) != 0);
+  kv::flush();
+#endif
   assert(access("./test/persist/test1", F_OK) == 0);
   printf("SUCCESS: key file created as expected!\n");
   assert(kv_get("test1", value, NULL, KV_FPERSIST) == 0);
@@ -122,6 +138,245 @@ int main(int argc, char *argv[])
     printf("SUCCESS: Read and write using C++ interface.\n");
   }
 
+  {
+    constexpr auto key = "test6";
+
+    kv::set(key, "cached");
+    assert(kv::get(key) == "cached");
+    assert(kv::get(key) == "cached");
+    assert(access("./test/kv_cache", F_OK) == 0);
+    printf("SUCCESS: Read temp key through the shared cache.\n");
+
+    // Write the file behind the library's back, like scripts do.
+    FILE* f = fopen("./test/tmp/test6", "w");
+    assert(f != nullptr);
+    fputs("direct", f);
+    fclose(f);
+    assert(kv::get(key) == "direct");
+    printf("SUCCESS: Cache does not hide direct writes to the key file.\n");
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+      kv::set(key, "from-child");
+      _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && status == 0);
+    assert(kv::get(key) == "from-child");
+    printf("SUCCESS: Cache is coherent across processes.\n");
+
+    assert(kv_del(key, 0) == 0);
+    assert(kv_get(key, value, NULL, 0) != 0);
+    assert(errno == ENOENT);
+    printf("SUCCESS: Deleted key is not served from the cache.\n");
+  }
+
+  for (auto flags : {0u, unsigned(KV_FPERSIST)}) {
+    const char* keys[] = { "multi1", "multi/2", "multi3" };
+    const char* vals[] = { "one", "two", "three" };
+    char buf[3][MAX_VALUE_LEN];
+    char* bufs[] = { buf[0], buf[1], buf[2] };
+    size_t lens[3];
+
+    assert(kv_get_multi(keys, bufs, NULL, 3, flags) != 0);
+    assert(errno == ENOENT);
+    assert(kv_set_multi(keys, vals, NULL, 3, flags) == 0);
+    assert(kv_get_multi(keys, bufs, lens, 3, flags) == 0);
+    for (int i = 0; i < 3; ++i) {
+      assert(lens[i] == strlen(vals[i]));
+      assert(memcmp(bufs[i], vals[i], lens[i]) == 0);
+    }
+    printf("SUCCESS: Read and write a group of keys.\n");
+
+    const char* create_keys[] = { "multi0", "multi4", "multi1" };
+    const char* create_vals[] = { "zero", "four", "changed" };
+    assert(kv_set_multi(create_keys, create_vals, NULL, 3,
+                        flags | KV_FCREATE) != 0);
+    assert(errno == EEXIST);
+    assert(kv_get("multi0", buf[0], NULL, flags) != 0);
+    assert(kv_get("multi4", buf[0], NULL, flags) != 0);
+    assert(kv_get("multi1", buf[0], NULL, flags) == 0);
+    assert(strcmp(buf[0], "one") == 0);
+    printf("SUCCESS: KV_FCREATE failure leaves the whole group untouched.\n");
+
+    auto r = flags ? kv::region::persist : kv::region::temp;
+    kv::set_multi({{"multi1", "uno"}, {"multi3", "tres"}}, r);
+    auto v = kv::get_multi({"multi1", "multi/2", "multi3"}, r);
+    assert((v == std::vector<std::string>{"uno", "two", "tres"}));
+    printf("SUCCESS: Read and write a group using C++ interface.\n");
+  }
+  assert(access("./test/persist/.multi1.tmp", F_OK) != 0);
+  printf("SUCCESS: Persistent group writes leave no temporary files.\n");
+
+  {
+    // A writer waiting for the lock of a key file being removed (as
+    // KV_FCREATE failures do for the keys they created) writes the new one.
+    auto fp = std::make_unique<kv::FileHandle>();
+    fp->open_and_lock<kv::FileHandle::access::write>("race", kv::region::temp);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+      kv::set("race", "from-child");
+      _exit(0);
+    }
+    usleep(100000);
+    fp->unlink();
+    fp.reset();
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && status == 0);
+    assert(kv::get("race") == "from-child");
+    printf("SUCCESS: Writer waiting on a removed key file is not lost.\n");
+  }
+
+  {
+    std::vector<std::string> changed;
+    auto collect = [&changed](const std::string& key, kv::region) {
+      changed.push_back(key);
+    };
+    auto wait = [](int fd) {
+      struct pollfd pfd = { fd, POLLIN, 0 };
+      return poll(&pfd, 1, 200) == 1;
+    };
+
+    kv::watch w;
+    w.add("watch_");
+    w.add("wdir/", kv::region::persist);
+    assert(!wait(w.fd()));
+
+    kv::set("watch_a", "1");
+    kv::set("unwatched", "1");
+    assert(wait(w.fd()));
+    assert(w.dispatch(collect) == 1);
+    assert((changed == std::vector<std::string>{"watch_a"}));
+    printf("SUCCESS: Watch reports changed keys under its prefix.\n");
+
+    changed.clear();
+    kv::set_multi({{"wdir/sub/b", "2"}, {"wdir/c", "3"}}, kv::region::persist);
+    while (wait(w.fd())) {
+      w.dispatch(collect);
+    }
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    assert((changed == std::vector<std::string>{"wdir/c", "wdir/sub/b"}));
+    printf("SUCCESS: Watch follows new key directories.\n");
+
+    changed.clear();
+    kv::del("watch_a");
+    assert(wait(w.fd()));
+    assert(w.dispatch(collect) == 1);
+    assert((changed == std::vector<std::string>{"watch_a"}));
+    printf("SUCCESS: Watch reports deleted keys.\n");
+
+    int fd = kv_watch_open();
+    assert(fd >= 0);
+    assert(kv_watch_add(fd, "watch_", 0) == 0);
+    assert(kv_set("watch_c", "4", 0, 0) == 0);
+    assert(wait(fd));
+    int calls = 0;
+    assert(kv_watch_dispatch(fd, [](const char* key, unsigned int flags,
+                                    void* arg) {
+      assert(strcmp(key, "watch_c") == 0 && flags == 0);
+      ++*static_cast<int*>(arg);
+    }, &calls) == 1);
+    assert(calls == 1);
+    assert(kv_watch_close(fd) == 0);
+    printf("SUCCESS: Watch using C interface.\n");
+
+    fd = kv_watch_open();
+    assert(fd >= 0);
+    assert(kv_watch_add(fd, "watch_", 0) == 0);
+    assert(kv_set("watch_d", "5", 0, 0) == 0);
+    assert(wait(fd));
+    assert(kv_watch_dispatch(fd, [](const char*, unsigned int, void* arg) {
+      int other = kv_watch_open();
+      assert(other >= 0);
+      assert(kv_watch_add(other, "watch_", 0) == 0);
+      assert(kv_watch_close(other) == 0);
+      assert(kv_watch_close(*static_cast<int*>(arg)) == 0);
+    }, &fd) == 1);
+    assert(kv_watch_close(fd) < 0 && errno == EBADF);
+    printf("SUCCESS: Watch callbacks may use the C interface.\n");
+  }
+
+#ifdef KV_PERSIST_JOURNAL
+  {
+    kv::set("journal1", "a", kv::region::persist);
+    kv::set("journal1", "b", kv::region::persist);
+    kv::set("journal2", "c", kv::region::persist);
+    assert(kv::get("journal1", kv::region::persist) == "b");
+    assert(access("./test/persist/journal1", F_OK) != 0);
+    printf("SUCCESS: Persistent writes are read back from the journal.\n");
+
+    // A frame torn by a crash is dropped, and the next write replaces it.
+    FILE* f = fopen("./test/persist.journal", "a");
+    assert(f != nullptr);
+    fputs("KVJ1 torn", f);
+    fclose(f);
+    pid_t pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+      bool ok = kv::get("journal1", kv::region::persist) == "b";
+      kv::set("journal3", "d", kv::region::persist);
+      _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && status == 0);
+    assert(kv::get("journal3", kv::region::persist) == "d");
+    assert(kv::get("journal2", kv::region::persist) == "c");
+    printf("SUCCESS: Journal replay drops torn frames.\n");
+
+    kv::flush();
+    f = fopen("./test/persist/journal1", "r");
+    assert(f != nullptr);
+    char buf[8] = {};
+    assert(fread(buf, 1, sizeof(buf), f) == 1 && buf[0] == 'b');
+    fclose(f);
+    printf("SUCCESS: Flushing the journal writes the key files.\n");
+  }
+#endif
+
+  {
+    // Bursts of writes to a few persistent keys, e.g. sensor thresholds.
+    constexpr int writes = 4000;
+    constexpr int keys = 16;
+    // Bytes and write calls this process made, see proc(5).
+    struct io { unsigned long long bytes = 0, calls = 0; };
+    auto written = []() {
+      io v;
+      FILE* f = fopen("/proc/self/io", "r");
+      if (f) {
+        if (fscanf(f, "rchar: %*u wchar: %llu syscr: %*u syscw: %llu",
+                   &v.bytes, &v.calls) != 2) {
+          v = io{};
+        }
+        fclose(f);
+      }
+      return v;
+    };
+
+    fflush(stdout);
+    auto before = written();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < writes; ++i) {
+      kv::set("bench/key" + std::to_string(i % keys),
+              "value-" + std::to_string(i), kv::region::persist);
+    }
+    kv::flush();
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    auto after = written();
+
+    for (int i = 0; i < keys; ++i) {
+      assert(kv::get("bench/key" + std::to_string(i), kv::region::persist) ==
+             "value-" + std::to_string(writes - keys + i));
+    }
+    printf("BENCHMARK: %d persistent writes (%s): %.0f writes/sec, "
+           "%llu bytes in %llu write calls\n", writes,
+           kv_journal ? "journal" : "key files", writes / elapsed.count(),
+           after.bytes - before.bytes, after.calls - before.calls);
+  }
+
   assert(system("rm -rf ./test") == 0);
 
   return 0;
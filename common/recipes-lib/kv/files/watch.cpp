@@ -0,0 +1,321 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ * Copyright 2020-present Facebook. All Rights Reserved.
+ */
+#include <sys/inotify.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <memory>
+#include <mutex>
+#include <set>
+
+#include "kv.hpp"
+#include "fileops.hpp"
+#include "journal.hpp"
+#include "log.hpp"
+
+namespace fs = std::filesystem;
+
+namespace kv
+{
+
+/* Events of a key file being written (kv::set closes the file, set_multi
+ * renames it in place) or removed, and of directories of keys showing up. */
+constexpr uint32_t watch_mask =
+    IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_CREATE;
+
+static bool starts_with(const std::string& s, const std::string& prefix)
+{
+  return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+/* Files staged by FileHandle::stage(). */
+static bool is_staged(const std::string& name)
+{
+  return name.size() > 5 && name[0] == '.' &&
+         name.compare(name.size() - 4, 4, ".tmp") == 0;
+}
+
+watch::watch()
+{
+  ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (ifd < 0) {
+    throw fs::filesystem_error(
+        "kv: error calling inotify_init1",
+        std::error_code(errno, std::system_category()));
+  }
+}
+
+watch::~watch()
+{
+  close(ifd);
+}
+
+bool watch::relevant(const std::string& key, region r) const
+{
+  // A directory is of interest if keys under it could match a prefix,
+  // or if a prefix reaches further down through it.
+  if (key.empty()) {
+    return true;
+  }
+  for (const auto& [prefix, pr] : prefixes) {
+    if (pr == r && (starts_with(key + "/", prefix) ||
+                    starts_with(prefix, key + "/"))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void watch::add_dir(const std::string& key, region r, const callback* cb)
+{
+  auto p = FileHandle::key_path(key, r);
+  int wd = inotify_add_watch(ifd, p.c_str(), watch_mask);
+  if (wd < 0) {
+    // Removed again before we got to it.
+    if (errno == ENOENT) {
+      return;
+    }
+    throw fs::filesystem_error(
+        "kv: error calling inotify_add_watch", p,
+        std::error_code(errno, std::system_category()));
+  }
+  dirs[wd] = dir{key, r};
+
+  // Entries which were created before the watch was in place are reported
+  // right away, or the caller would never hear about them.
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(p, ec)) {
+    auto name = entry.path().filename().string();
+    auto child = key.empty() ? name : key + "/" + name;
+    if (entry.is_directory(ec)) {
+      if (relevant(child, r)) {
+        add_dir(child, r, cb);
+      }
+    } else if (cb && !is_staged(name)) {
+      for (const auto& [prefix, pr] : prefixes) {
+        if (pr == r && starts_with(child, prefix)) {
+          (*cb)(child, r);
+          break;
+        }
+      }
+    }
+  }
+}
+
+void watch::add(const std::string& prefix, region r)
+{
+  prefixes.emplace_back(prefix, r);
+
+  // Watch from the directory holding the prefix, which has to exist.
+  auto pos = prefix.rfind('/');
+  auto key = pos == std::string::npos ? std::string() : prefix.substr(0, pos);
+  fs::create_directories(FileHandle::key_path(key, r));
+  add_dir(key, r, nullptr);
+
+  // Journaled persistent writes only show up in the journal.
+  if (journal_enabled && r == region::persist && journal_wd < 0) {
+    auto jdir = fs::path(Journal::path()).parent_path();
+    journal_wd = inotify_add_watch(ifd, jdir.c_str(), IN_MODIFY | IN_MOVED_TO);
+    if (journal_wd < 0) {
+      throw fs::filesystem_error(
+          "kv: error calling inotify_add_watch", jdir,
+          std::error_code(errno, std::system_category()));
+    }
+    Journal::changes(journal_ino, journal_offset, [](const std::string&) {});
+  }
+}
+
+size_t watch::dispatch(const callback& user_cb)
+{
+  alignas(struct inotify_event) char buf[4096];
+
+  // A single kv::set can raise several events for its key, report it once.
+  std::set<std::pair<std::string, region>> reported;
+  callback cb = [&](const std::string& key, region r) {
+    if (reported.emplace(key, r).second) {
+      user_cb(key, r);
+    }
+  };
+
+  for (;;) {
+    auto len = read(ifd, buf, sizeof(buf));
+    if (len < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      throw fs::filesystem_error(
+          "kv: error reading inotify events",
+          std::error_code(errno, std::system_category()));
+    }
+
+    for (char* ptr = buf; ptr < buf + len; ) {
+      auto ev = reinterpret_cast<const struct inotify_event*>(ptr);
+      ptr += sizeof(struct inotify_event) + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        // Events were lost: everything may have changed.
+        KV_WARN("kv: watch event queue overflow");
+        for (const auto& [prefix, r] : prefixes) {
+          cb(prefix, r);
+        }
+        continue;
+      }
+
+      if (ev->wd == journal_wd) {
+        if (ev->len != 0 &&
+            fs::path(Journal::path()).filename() == ev->name) {
+          Journal::changes(journal_ino, journal_offset,
+              [&](const std::string& key) {
+                for (const auto& [prefix, pr] : prefixes) {
+                  if (pr == region::persist && starts_with(key, prefix)) {
+                    cb(key, pr);
+                    break;
+                  }
+                }
+              });
+        }
+        continue;
+      }
+
+      auto it = dirs.find(ev->wd);
+      if (it == dirs.end()) {
+        continue;
+      }
+      auto [key, r] = it->second;
+      if (ev->mask & IN_IGNORED) {
+        dirs.erase(it);
+        continue;
+      }
+      if (ev->len == 0) {
+        continue;
+      }
+
+      std::string name = ev->name;
+      auto child = key.empty() ? name : key + "/" + name;
+      if (ev->mask & IN_ISDIR) {
+        if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && relevant(child, r)) {
+          add_dir(child, r, &cb);
+        }
+        continue;
+      }
+      // Creating a key file is followed by its IN_CLOSE_WRITE.
+      if ((ev->mask & IN_CREATE) || is_staged(name)) {
+        continue;
+      }
+      for (const auto& [prefix, pr] : prefixes) {
+        if (pr == r && starts_with(child, prefix)) {
+          cb(child, r);
+          break;
+        }
+      }
+    }
+  }
+  return reported.size();
+}
+
+} // namespace kv
+
+/* The watches handed out through the C API, by descriptor.  The map is
+ * only locked to look a watch up; the watch itself has its own lock, so the
+ * callbacks of one watch do not hold up the others and may open, close or
+ * add to other watches, or close their own. */
+struct watch_entry {
+  std::mutex mutex;
+  kv::watch w;
+};
+
+static std::mutex watches_mutex;
+static std::map<int, std::shared_ptr<watch_entry>> watches;
+
+static std::shared_ptr<watch_entry> find_watch(int fd)
+{
+  std::lock_guard<std::mutex> lock(watches_mutex);
+  auto it = watches.find(fd);
+  if (it == watches.end()) {
+    errno = EBADF;
+    return nullptr;
+  }
+  return it->second;
+}
+
+int kv_watch_open(void)
+{
+  try {
+    auto e = std::make_shared<watch_entry>();
+    int fd = e->w.fd();
+    std::lock_guard<std::mutex> lock(watches_mutex);
+    watches[fd] = std::move(e);
+    return fd;
+  } catch (std::filesystem::filesystem_error& e) {
+    errno = e.code().value();
+    KV_WARN("kv_watch_open: %s", e.what());
+    return -1;
+  }
+}
+
+int kv_watch_add(int fd, const char *prefix, unsigned int flags)
+{
+  if (prefix == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  auto e = find_watch(fd);
+  if (e == nullptr) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(e->mutex);
+  try {
+    e->w.add(prefix, (flags & KV_FPERSIST) ? kv::region::persist
+                                           : kv::region::temp);
+  } catch (std::filesystem::filesystem_error& ex) {
+    errno = ex.code().value();
+    KV_WARN("kv_watch_add: %s", ex.what());
+    return -1;
+  }
+  return 0;
+}
+
+int kv_watch_dispatch(int fd, kv_watch_cb cb, void *arg)
+{
+  if (cb == nullptr) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  // Holding e keeps the watch alive if a callback closes it.
+  auto e = find_watch(fd);
+  if (e == nullptr) {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(e->mutex);
+  try {
+    return e->w.dispatch([cb, arg](const std::string& key, kv::region r) {
+      cb(key.c_str(), r == kv::region::persist ? KV_FPERSIST : 0, arg);
+    });
+  } catch (std::filesystem::filesystem_error& ex) {
+    errno = ex.code().value();
+    KV_WARN("kv_watch_dispatch: %s", ex.what());
+    return -1;
+  }
+}
+
+int kv_watch_close(int fd)
+{
+  std::shared_ptr<watch_entry> e;
+  {
+    std::lock_guard<std::mutex> lock(watches_mutex);
+    auto it = watches.find(fd);
+    if (it == watches.end()) {
+      errno = EBADF;
+      return -1;
+    }
+    e = std::move(it->second);
+    watches.erase(it);
+  }
+  // The watch goes away, closing fd, once no dispatch holds it anymore.
+  return 0;
+}
@@ -23,14 +23,24 @@
 #include <fcntl.h>
 #include <algorithm>
 #include <cstring>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include "pldm.h"
 #include "oem_pldm.hpp"
 #include "fw_update.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <time.h>
 
-#define MAX_TRANSFER_SIZE 1024
 #define DEFAULT_INSTANCE_ID 0
+// Read ahead of the device requests, in this many bytes at a time.
+#define PREFETCH_WINDOW (256 * 1024)
 
 using namespace std;
 
@@ -103,13 +113,87 @@ static uint32_t crc_table[] = {
   0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d};
 
-const int maxTransferSize = 1024;
+// Offered to the device in RequestUpdate, set for each update.
+static uint32_t maxTransferSize = MAX_TRANSFER_SIZE;
+static uint8_t maxOutstandingTransferReq = PLDM_FWUP_MIN_OUTSTANDING_REQ;
 // It will re-init when function call oem_parse_pldm_package()
 pldm_package_header_information pkg_header{};
 vector<firmware_device_id_record_t> pkg_devices{};
 vector<component_image_info_t> pkg_comps{};
 vector<vector<struct device_id_record_descriptor>> query_device_descriptors;
 
+/*
+ * The package, mapped once for the whole update: RequestFirmwareData is
+ * answered straight from the mapping, and the part of the component the
+ * device is about to ask for is read ahead.
+ */
+class fw_package_map
+{
+  public:
+    explicit fw_package_map(const char* path)
+    {
+      int fd = open(path, O_RDONLY);
+      if (fd < 0)
+        return;
+      struct stat st;
+      if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr != MAP_FAILED) {
+          data = (const uint8_t*)addr;
+          size = st.st_size;
+        }
+      }
+      close(fd);
+    }
+    ~fw_package_map()
+    {
+      if (data != nullptr)
+        munmap((void*)data, size);
+    }
+    fw_package_map(const fw_package_map&) = delete;
+    fw_package_map& operator=(const fw_package_map&) = delete;
+
+    bool valid() const { return data != nullptr; }
+
+    bool contains(size_t offset, size_t length) const
+    {
+      return offset <= size && length <= size - offset;
+    }
+
+    void advise(size_t offset, size_t length, int advice) const
+    {
+      static const size_t page = sysconf(_SC_PAGESIZE);
+      size_t start = offset & ~(page - 1);
+      if (offset >= size)
+        return;
+      length = min(length + (offset - start), size - start);
+      madvise((void*)(data + start), length, advice);
+    }
+
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+};
+
+/*
+ * Update of one endpoint. Endpoints are updated each by its own thread and
+ * firmware update connection, the package is shared.
+ */
+struct fw_endpoint_update
+{
+  uint8_t eid = 0;
+  int sockfd = -1;
+  bool verbose = true;              // print each step, if updating only one
+  // device record and component images of the package selected for the
+  // endpoint, the package itself is left untouched
+  vector<firmware_device_id_record_t> devices{};
+  vector<component_image_info_t> comps{};
+  atomic<uint8_t> status{FW_DEVICE_STATUS::IDLE};
+  atomic<int> percent{-1};          // download progress of the component
+  size_t prefetched = 0;            // read ahead was asked up to this offset
+  int ret = -1;
+  bool done = false;
+};
+
 static string
 variable_field_to_str(const variable_field& field)
 {
@@ -658,13 +742,14 @@ pldm_cancel_update(int fd, uint8_t eid)
 }
 
 static int
-pldm_request_update(int fd, uint8_t eid, uint8_t record_id)
+pldm_request_update(const fw_endpoint_update& ep, uint8_t record_id)
 {
-  auto pkgData_len = pkg_devices[record_id].deviceIdRecHeader.fw_device_pkg_data_length;
-  auto compVer_len = pkg_devices[record_id].deviceIdRecHeader.comp_image_set_version_string_length;
+  auto& device = ep.devices[record_id];
+  auto pkgData_len = device.deviceIdRecHeader.fw_device_pkg_data_length;
+  auto compVer_len = device.deviceIdRecHeader.comp_image_set_version_string_length;
   variable_field compVer{};
-  compVer.length = pkg_devices[record_id].compImageSetVersionStr.size();
-  compVer.ptr = (const uint8_t*)pkg_devices[record_id].compImageSetVersionStr.c_str();
+  compVer.length = device.compImageSetVersionStr.size();
+  compVer.ptr = (const uint8_t*)device.compImageSetVersionStr.c_str();
 
   vector<uint8_t> response{};
   vector<uint8_t> request(
@@ -677,8 +762,8 @@ pldm_request_update(int fd, uint8_t eid, uint8_t record_id)
   int ret = encode_request_update_req (
     DEFAULT_INSTANCE_ID,
     maxTransferSize,
-    pkg_comps.size(),
-    PLDM_FWUP_MIN_OUTSTANDING_REQ,
+    ep.comps.size(),
+    maxOutstandingTransferReq,
     pkgData_len,
     PLDM_STR_TYPE_ASCII,
     compVer_len,
@@ -693,7 +778,7 @@ pldm_request_update(int fd, uint8_t eid, uint8_t record_id)
     return -1;
   }
 
-  return oem_pldm_send_recv_w_fd(fd, eid, request, response);
+  return oem_pldm_send_recv_w_fd(ep.sockfd, ep.eid, request, response);
 }
 
 static uint8_t
@@ -712,13 +797,14 @@ pldm_get_tag(size_t curr, size_t end)
 }
 
 static int
-pldm_pass_comp_table(int fd, uint8_t eid, size_t index)
+pldm_pass_comp_table(const fw_endpoint_update& ep, size_t index)
 {
-  uint8_t transferFlag = pldm_get_tag(index, pkg_comps.size());
-  auto compVer_len = pkg_comps[index].compImageInfo.comp_version_string_length;
+  auto& comp = ep.comps[index];
+  uint8_t transferFlag = pldm_get_tag(index, ep.comps.size());
+  auto compVer_len = comp.compImageInfo.comp_version_string_length;
   variable_field compVer{};
-  compVer.length = pkg_comps[index].compVersion.size();
-  compVer.ptr = (const uint8_t*)pkg_comps[index].compVersion.c_str();
+  compVer.length = comp.compVersion.size();
+  compVer.ptr = (const uint8_t*)comp.compVersion.c_str();
   vector<uint8_t> response{};
   vector<uint8_t> request (
     sizeof(pldm_msg_hdr) +
@@ -730,10 +816,10 @@ pldm_pass_comp_table(int fd, uint8_t eid, size_t index)
   int ret = encode_pass_component_table_req(
     0x00,
     transferFlag,
-    pkg_comps[index].compImageInfo.comp_classification,
-    pkg_comps[index].compImageInfo.comp_identifier,
+    comp.compImageInfo.comp_classification,
+    comp.compImageInfo.comp_identifier,
     index,
-    pkg_comps[index].compImageInfo.comp_comparison_stamp,
+    comp.compImageInfo.comp_comparison_stamp,
     PLDM_STR_TYPE_ASCII,
     compVer_len,
     &compVer,
@@ -747,17 +833,18 @@ pldm_pass_comp_table(int fd, uint8_t eid, size_t index)
     return -1;
   }
 
-  return oem_pldm_send_recv_w_fd(fd, eid, request, response);
+  return oem_pldm_send_recv_w_fd(ep.sockfd, ep.eid, request, response);
 }
 
 static int
-pldm_update_comp(int fd, uint8_t eid, size_t index)
+pldm_update_comp(const fw_endpoint_update& ep, size_t index)
 {
-  uint32_t updateOptionFlags = pkg_comps[index].compImageInfo.comp_options.value;
-  auto compVer_len = pkg_comps[index].compImageInfo.comp_version_string_length;
+  auto& comp = ep.comps[index];
+  uint32_t updateOptionFlags = comp.compImageInfo.comp_options.value;
+  auto compVer_len = comp.compImageInfo.comp_version_string_length;
   variable_field compVer{};
-  compVer.length = pkg_comps[index].compVersion.size();
-  compVer.ptr = (const uint8_t*)pkg_comps[index].compVersion.c_str();
+  compVer.length = comp.compVersion.size();
+  compVer.ptr = (const uint8_t*)comp.compVersion.c_str();
 
   vector<uint8_t> response{};
   vector<uint8_t> request (
@@ -769,11 +856,11 @@ pldm_update_comp(int fd, uint8_t eid, size_t index)
 
   int ret = encode_update_component_req(
     0x00,
-    pkg_comps[index].compImageInfo.comp_classification,
-    pkg_comps[index].compImageInfo.comp_identifier,
+    comp.compImageInfo.comp_classification,
+    comp.compImageInfo.comp_identifier,
     index,
-    pkg_comps[index].compImageInfo.comp_comparison_stamp,
-    pkg_comps[index].compImageInfo.comp_size,
+    comp.compImageInfo.comp_comparison_stamp,
+    comp.compImageInfo.comp_size,
     bitfield32_t{updateOptionFlags},
     PLDM_STR_TYPE_ASCII,
     compVer_len,
@@ -788,20 +875,53 @@ pldm_update_comp(int fd, uint8_t eid, size_t index)
     return -1;
   }
 
-  return oem_pldm_send_recv_w_fd(fd, eid, request, response);
+  return oem_pldm_send_recv_w_fd(ep.sockfd, ep.eid, request, response);
+}
+
+// Send RequestFirmwareData response, its data straight from the package.
+static int
+pldm_send_firmware_data(int sockfd, uint8_t eid, const vector<uint8_t>& response,
+                        const uint8_t* data, size_t length, size_t padding)
+{
+  static const uint8_t zeros[PLDM_FWUP_BASELINE_TRANSFER_SIZE] = {};
+  uint8_t prefix[2] = {eid, MCTP_PLDM_TYPE};
+
+  struct iovec iov[4];
+  iov[0].iov_base = prefix;
+  iov[0].iov_len = sizeof(prefix);
+  iov[1].iov_base = (void*)response.data();
+  iov[1].iov_len = response.size();
+  iov[2].iov_base = (void*)data;
+  iov[2].iov_len = length;
+  iov[3].iov_base = (void*)zeros;
+  iov[3].iov_len = padding;
+
+  struct msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = sizeof(iov) / sizeof(iov[0]);
+
+  for (int retry = 0; retry < 2; retry++) {
+    if (sendmsg(sockfd, &msg, MSG_NOSIGNAL) >= 0)
+      return 0;
+    if (errno != EAGAIN)
+      break;
+  }
+  cerr << __func__ << " send failed." << endl;
+  return -1;
 }
 
 static int
-pldm_request_firmware_data_handle(int sockfd, uint8_t eid, size_t comps_index,
-                                  vector<uint8_t>& request, int file)
+pldm_request_firmware_data_handle(fw_endpoint_update& ep, size_t comps_index,
+                                  vector<uint8_t>& request,
+                                  const fw_package_map& pkg)
 {
   int ret = 0;
   uint8_t completionCode = PLDM_SUCCESS;
   uint32_t offset = 0;
   uint32_t length = 0;
   vector<uint8_t> response(sizeof(pldm_msg_hdr) + sizeof(completionCode));
-  auto compSize = pkg_comps[comps_index].compImageInfo.comp_size;
-  auto compOffset = pkg_comps[comps_index].compImageInfo.comp_location_offset;
+  size_t compSize = ep.comps[comps_index].compImageInfo.comp_size;
+  size_t compOffset = ep.comps[comps_index].compImageInfo.comp_location_offset;
   auto requestMsg = reinterpret_cast<pldm_msg*>(request.data());
   auto responseMsg = reinterpret_cast<pldm_msg*>(response.data());
 
@@ -815,62 +935,47 @@ pldm_request_firmware_data_handle(int sockfd, uint8_t eid, size_t comps_index,
     return -1;
   // PLDM_FWUP_INVALID_TRANSFER_LENGTH
   } else if (length < PLDM_FWUP_BASELINE_TRANSFER_SIZE || length > maxTransferSize) {
-    ret = encode_request_firmware_data_resp(
-      requestMsg->hdr.instance_id,
-      PLDM_FWUP_INVALID_TRANSFER_LENGTH,
-      responseMsg, sizeof(completionCode));
-    if (ret) {
-      cerr << "Encoding RequestFirmwareData response failed." << endl;
-      return -1;
-    }
+    completionCode = PLDM_FWUP_INVALID_TRANSFER_LENGTH;
   // PLDM_FWUP_DATA_OUT_OF_RANGE
-  } else if (offset + length > compSize + PLDM_FWUP_BASELINE_TRANSFER_SIZE) {
-    ret = encode_request_firmware_data_resp(
-      requestMsg->hdr.instance_id,
-      PLDM_FWUP_DATA_OUT_OF_RANGE,
-      responseMsg, sizeof(completionCode));
-    if (ret) {
-      cerr << "Encoding RequestFirmwareData response failed." << endl;
-      return -1;
-    }
-  // SUCCESS
-  } else {
-    // encode pldm response header
-    response.resize(sizeof(pldm_msg_hdr) + sizeof(completionCode) + length);
+  } else if ((size_t)offset + length > compSize + PLDM_FWUP_BASELINE_TRANSFER_SIZE) {
+    completionCode = PLDM_FWUP_DATA_OUT_OF_RANGE;
+  }
 
-    // read file to payload
-    if (lseek(file, offset+compOffset, SEEK_SET) != offset+compOffset) {
-      cerr << __func__ << " lseek failed." << endl;
-      return -1;
-    } else {
-      if (read(file, response.data()+sizeof(pldm_msg_hdr)+sizeof(completionCode), length) < 0)
-      {
-        cerr << __func__ << " read failed." << endl;
-        return -1;
-      }
-    }
+  ret = encode_request_firmware_data_resp(
+    requestMsg->hdr.instance_id, completionCode,
+    responseMsg, sizeof(completionCode));
+  if (ret) {
+    cerr << "Encoding RequestFirmwareData response failed." << endl;
+    return -1;
+  }
+  if (completionCode != PLDM_SUCCESS) {
+    return oem_pldm_send(ep.sockfd, ep.eid, response);
+  }
 
-    responseMsg = reinterpret_cast<pldm_msg*>(response.data());
-    ret = encode_request_firmware_data_resp(
-      requestMsg->hdr.instance_id, completionCode,
-      responseMsg, sizeof(completionCode));
-    if (ret) {
-      cerr << "Encoding RequestFirmwareData response failed." << endl;
-      return -1;
-    }
+  // The device reads the component in order, read the next part ahead.
+  if (offset + length > ep.prefetched) {
+    ep.prefetched = offset + PREFETCH_WINDOW;
+    pkg.advise(compOffset + offset, PREFETCH_WINDOW, MADV_WILLNEED);
+  }
+
+  // Past the end of the component (last transfer) is padded with zeros.
+  size_t dataLength = offset < compSize ? min<size_t>(length, compSize - offset) : 0;
+  ret = pldm_send_firmware_data(ep.sockfd, ep.eid, response,
+                                pkg.data + compOffset + offset, dataLength,
+                                length - dataLength);
 
-    cout << "\rDownload "
-         << "offset : 0x"  << setfill('0') << setw(8) << hex << offset
-         << "/0x" << setfill('0') << setw(8) << hex << compSize
-         << ", size : 0x"  << setfill('0') << setw(8) << hex << length
-         << flush;
+  // (offset + dataLength) * 100 overflows a 32-bit size_t past 42MB.
+  int percent = compSize ? uint64_t(offset + dataLength) * 100 / compSize : 100;
+  if (percent != ep.percent && ep.verbose) {
+    cout << "\rDownload " << dec << percent << "%" << flush;
   }
+  ep.percent = percent;
 
-  return oem_pldm_send(sockfd, eid, response);
+  return ret;
 }
 
 static int
-pldm_transfer_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, uint8_t& status)
+pldm_transfer_complete_handle(fw_endpoint_update& ep, vector<uint8_t>& request)
 {
   int ret = 0;
   uint8_t completionCode = PLDM_SUCCESS;
@@ -894,8 +999,9 @@ pldm_transfer_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request,
   }
   // SUCCESS
   else {
-    status = FW_DEVICE_STATUS::VERIFY;
-    cout << "\nTransferComplete." << endl;
+    ep.status = FW_DEVICE_STATUS::VERIFY;
+    if (ep.verbose)
+      cout << "\nTransferComplete." << endl;
   }
 
   ret = encode_transfer_complete_resp(
@@ -907,11 +1013,11 @@ pldm_transfer_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request,
     return -1;
   }
 
-  return oem_pldm_send(sockfd, eid, response);
+  return oem_pldm_send(ep.sockfd, ep.eid, response);
 }
 
 static int
-pldm_verify_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, uint8_t& status)
+pldm_verify_complete_handle(fw_endpoint_update& ep, vector<uint8_t>& request)
 {
   int ret = 0;
   uint8_t completionCode = PLDM_SUCCESS;
@@ -935,8 +1041,9 @@ pldm_verify_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, u
   }
   // SUCCESS
   else {
-    status = FW_DEVICE_STATUS::APPLY;
-    cout << "VerifyComplete." << endl;
+    ep.status = FW_DEVICE_STATUS::APPLY;
+    if (ep.verbose)
+      cout << "VerifyComplete." << endl;
   }
 
   ret = encode_verify_complete_resp(
@@ -948,11 +1055,11 @@ pldm_verify_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, u
     return -1;
   }
 
-  return oem_pldm_send(sockfd, eid, response);
+  return oem_pldm_send(ep.sockfd, ep.eid, response);
 }
 
 static int
-pldm_apply_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, uint8_t& status)
+pldm_apply_complete_handle(fw_endpoint_update& ep, vector<uint8_t>& request)
 {
   int ret = 0;
   uint8_t completionCode = PLDM_SUCCESS;
@@ -979,8 +1086,9 @@ pldm_apply_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, ui
   }
   // SUCCESS
   else {
-    status = FW_DEVICE_STATUS::READY_XFER;
-    cout << "ApplyComplete." << endl;
+    ep.status = FW_DEVICE_STATUS::READY_XFER;
+    if (ep.verbose)
+      cout << "ApplyComplete." << endl;
   }
 
   ret = encode_apply_complete_resp(
@@ -992,17 +1100,18 @@ pldm_apply_complete_handle(int sockfd, uint8_t eid, vector<uint8_t>& request, ui
     return -1;
   }
 
-  return oem_pldm_send(sockfd, eid, response);
+  return oem_pldm_send(ep.sockfd, ep.eid, response);
 }
 
 static int
-pldm_do_download(int sockfd, uint8_t eid, size_t index, uint8_t& curr_stat, int file, int wait_apply_time = 0)
+pldm_do_download(fw_endpoint_update& ep, size_t index,
+                 const fw_package_map& pkg, int wait_apply_time = 0)
 {
   int ret = 0;
   vector<uint8_t> request{};
 
-  if (curr_stat == FW_DEVICE_STATUS::APPLY) {
-    if (wait_apply_time != 0) {
+  if (ep.status == FW_DEVICE_STATUS::APPLY) {
+    if (wait_apply_time != 0 && ep.verbose) {
       cout << dec << "Wait for loading firmware, no more than " << wait_apply_time << "s..." << endl;
     }
     struct timespec start_time;
@@ -1011,7 +1120,7 @@ pldm_do_download(int sockfd, uint8_t eid, size_t index, uint8_t& curr_stat, int
     clock_gettime(CLOCK_MONOTONIC, &start_time);
 
     while (current_time.tv_sec <= (start_time.tv_sec + wait_apply_time)) {
-      if (oem_pldm_recv(sockfd, eid, request) == PLDM_SUCCESS) {
+      if (oem_pldm_recv(ep.sockfd, ep.eid, request) == PLDM_SUCCESS) {
 	break;
       }
 
@@ -1023,8 +1132,8 @@ pldm_do_download(int sockfd, uint8_t eid, size_t index, uint8_t& curr_stat, int
       return -1;
     }
   } else {
-    if (oem_pldm_recv(sockfd, eid, request) != PLDM_SUCCESS) {
-      curr_stat = FW_DEVICE_STATUS::IDLE;
+    if (oem_pldm_recv(ep.sockfd, ep.eid, request) != PLDM_SUCCESS) {
+      ep.status = FW_DEVICE_STATUS::IDLE;
       cerr << "Recv failed in download phase." << endl;
       return -1;
     }
@@ -1033,16 +1142,16 @@ pldm_do_download(int sockfd, uint8_t eid, size_t index, uint8_t& curr_stat, int
   auto requestMsg = reinterpret_cast<pldm_msg*>(request.data());
   switch (requestMsg->hdr.command) {
     case PLDM_REQUEST_FIRMWARE_DATA:
-      ret = pldm_request_firmware_data_handle(sockfd, eid, index, request, file);
+      ret = pldm_request_firmware_data_handle(ep, index, request, pkg);
       break;
     case PLDM_TRANSFER_COMPLETE:
-      ret = pldm_transfer_complete_handle(sockfd, eid, request, curr_stat);
+      ret = pldm_transfer_complete_handle(ep, request);
       break;
     case PLDM_VERIFY_COMPLETE:
-      ret = pldm_verify_complete_handle(sockfd, eid, request, curr_stat);
+      ret = pldm_verify_complete_handle(ep, request);
       break;
     case PLDM_APPLY_COMPLETE:
-      ret = pldm_apply_complete_handle(sockfd, eid, request, curr_stat);
+      ret = pldm_apply_complete_handle(ep, request);
       break;
     default:
       cerr << "Unexpected pldm command: 0x"
@@ -1055,7 +1164,7 @@ pldm_do_download(int sockfd, uint8_t eid, size_t index, uint8_t& curr_stat, int
 
   // The things with the basic pldm connection are going wrong.
   if (ret == -1) {
-    curr_stat = FW_DEVICE_STATUS::IDLE;
+    ep.status = FW_DEVICE_STATUS::IDLE;
   }
 
   return ret;
@@ -1084,22 +1193,46 @@ pldm_activate_firmware(int sockfd, uint8_t eid)
     return -1;
   }
 
-  cout << "ActivateFirmwareComplete." << endl;
   return oem_pldm_send_recv_w_fd(sockfd, eid, request, response);
 }
 
-int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_standard_descriptor, 
-    string component, int wait_apply_time, uint8_t specified_comp)
+// Parse the package and check it against its mapping, once for all endpoints.
+static int
+pldm_load_package(const char* path, const fw_package_map& pkg)
 {
-  int ret, sockfd, file;
-  int index = 0;
-  uint8_t status = 0;
-
-  sockfd = oem_pldm_init_fwupdate_fd(bus);
-  if (sockfd < 0) {
-    cerr << "Failed to connect pldm daemon." << endl;
+  if (oem_parse_pldm_package(path) < 0) {
+    cerr << "Failed to parse pldm package header." << endl;
+    return -1;
+  }
+  if (!pkg.valid()) {
+    cerr << "Cannot map " << path << endl;
     return -1;
   }
+  for (auto& comp : pkg_comps) {
+    if (!pkg.contains(comp.compImageInfo.comp_location_offset,
+                      comp.compImageInfo.comp_size)) {
+      cerr << "Component image is out of " << path << endl;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Select the device record and component images of the package to update the
+ * endpoint with. They are kept by the endpoint, so endpoints needing other
+ * images of the same package can be updated at the same time.
+ */
+static int
+pldm_select_component(uint8_t bus, fw_endpoint_update& ep, bool is_standard_descriptor,
+                      const string& component, uint8_t specified_comp)
+{
+  int ret = 0;
+  int index = 0;
+  uint8_t eid = ep.eid;
+
+  ep.devices.clear();
+  ep.comps.clear();
 
   if (is_standard_descriptor) {
     ret = pldm_query_device_identifiers(bus, eid);
@@ -1113,37 +1246,7 @@ int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_stand
       cerr << "Failed to get downstream device identifier." << endl;
       return -1;
     }
-  }
-
-  ret = oem_parse_pldm_package(path);
-  if (ret < 0) {
-    cerr << "Failed to parse pldm package header." << endl;
-    close(sockfd);
-    return -1;
-  } else {
-    file = open(path, O_RDONLY);
-    if (file < 0) {
-      cerr << "Cannot open " << path << endl;
-      close(sockfd);
-      return -1;
-    }
-  }
-
-  // try reset firmware device status
-  ret = pldm_get_status(sockfd, eid, status);
-  if (ret < 0) {
-    cerr << "Failed to get status." << endl;
-    goto exit;
-  } else if (status != FW_DEVICE_STATUS::IDLE &&
-              status != FW_DEVICE_STATUS::APPLY) {
-    ret = pldm_cancel_update(sockfd, eid);
-    if (ret < 0) {
-      cerr << "Failed to reset pldm update status." << endl;
-      goto exit;
-    }
-  }
 
-  if (is_standard_descriptor) {
     // Find the component need to update
     for (index = 0; index < (int)pkg_devices.size(); ++index) {
       ret = pldm_check_descriptors_is_match(pkg_devices.at(index).recordDescriptors);
@@ -1160,13 +1263,8 @@ int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_stand
             if (specified_comp != 0xFF) {
               comp.compImageInfo.comp_identifier = specified_comp;
             }
-            pkg_comps.clear();
-            pkg_comps.emplace_back(comp);
-
-            auto device = pkg_devices.at(index);
-            pkg_devices.clear();
-            pkg_devices.emplace_back(device);
-
+            ep.comps.emplace_back(comp);
+            ep.devices.emplace_back(pkg_devices.at(index));
             break;
           }
         }
@@ -1174,12 +1272,13 @@ int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_stand
       }
     }
 
-    if ((ret != 0) || (pkg_devices.size() != 1)) {
+    if ((ret != 0) || (ep.devices.size() != 1)) {
       cerr << "Failed to find corresponding component image." << endl;
-      ret = -1;
-      goto exit;
+      return -1;
     }
   } else {
+    ep.devices = pkg_devices;
+    ep.comps = pkg_comps;
     // It means that only one comp image UA wanna use
     // when specified_comp not equals to 0xFF. (For GT pex update)
     if (specified_comp != 0xFF) {
@@ -1190,51 +1289,92 @@ int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_stand
       );
       if (it == pkg_comps.end()) {
 	cerr << "Failed to find corresponding component image." << endl;
-	ret = -1;
-	goto exit;
+	return -1;
       } else {
-	auto comp = *it;
-	pkg_comps.clear();
-	pkg_comps.emplace_back(comp);
+	ep.comps = {*it};
       }
     }
+    if (ep.devices.empty()) {
+      cerr << "No device identifier record in the package." << endl;
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// Update the endpoint with the selected components, up to activation.
+static int
+pldm_update_endpoint(uint8_t bus, fw_endpoint_update& ep,
+                     const fw_package_map& pkg, int wait_apply_time)
+{
+  int ret, sockfd;
+  int index = 0;
+  uint8_t status = 0;
+  uint8_t eid = ep.eid;
+
+  sockfd = ep.sockfd = oem_pldm_init_fwupdate_fd(bus);
+  if (sockfd < 0) {
+    cerr << "Failed to connect pldm daemon." << endl;
+    return -1;
+  }
+
+  // try reset firmware device status
+  ret = pldm_get_status(sockfd, eid, status);
+  if (ret < 0) {
+    cerr << "Failed to get status." << endl;
+    goto exit;
+  } else if (status != FW_DEVICE_STATUS::IDLE &&
+              status != FW_DEVICE_STATUS::APPLY) {
+    ret = pldm_cancel_update(sockfd, eid);
+    if (ret < 0) {
+      cerr << "Failed to reset pldm update status." << endl;
+      goto exit;
+    }
   }
 
   // send RequestUpdate (Next State: LEARN COMPONENTS)
-  ret = pldm_request_update(sockfd, eid, 0); // only support 1 device record for now
+  ret = pldm_request_update(ep, 0); // only support 1 device record for now
   if (ret < 0) {
     cerr << "Failed to send RequestUpdate." << endl;
     goto exit;
   }
-  cout << "RequestUpdate Success." << endl;
-  status = FW_DEVICE_STATUS::LEARN_COMPONENTS;
+  if (ep.verbose)
+    cout << "RequestUpdate Success." << endl;
+  ep.status = FW_DEVICE_STATUS::LEARN_COMPONENTS;
 
   // send PassComponentTable (Next State: READY XFER)
-  for (index = 0; index < (int)pkg_comps.size(); ++index) {
-    ret = pldm_pass_comp_table(sockfd, eid, index);
+  for (index = 0; index < (int)ep.comps.size(); ++index) {
+    ret = pldm_pass_comp_table(ep, index);
     if (ret < 0) {
       cerr << "Failed to send PassComponentTable." << endl;
       goto exit;
     }
   }
-  cout << "PassComponentTable Success." << endl;
-  status = FW_DEVICE_STATUS::READY_XFER;
+  if (ep.verbose)
+    cout << "PassComponentTable Success." << endl;
+  ep.status = FW_DEVICE_STATUS::READY_XFER;
 
   // send UpdateComponent (Next State: DOWNLOAD)
-  for (index = 0; index < (int)pkg_comps.size(); ++index) {
-    ret = pldm_update_comp(sockfd, eid, index);
+  for (index = 0; index < (int)ep.comps.size(); ++index) {
+    ret = pldm_update_comp(ep, index);
     if (ret < 0) {
       cerr << "Failed to send UpdateComponent." << endl;
       goto exit;
     } else {
-      cout << "UpdateComponent Success." << endl;
-      status = FW_DEVICE_STATUS::DOWNLOAD;
+      if (ep.verbose)
+        cout << "UpdateComponent Success." << endl;
+      ep.status = FW_DEVICE_STATUS::DOWNLOAD;
+      ep.percent = -1;
+      ep.prefetched = 0;
+      pkg.advise(ep.comps[index].compImageInfo.comp_location_offset,
+                 ep.comps[index].compImageInfo.comp_size, MADV_SEQUENTIAL);
       while (true) {
-        ret = pldm_do_download(sockfd, eid, index, status, file, wait_apply_time);
+        ret = pldm_do_download(ep, index, pkg, wait_apply_time);
         if (ret < 0) {
           cerr << "Failed at download state ." << endl;
           goto exit;
-        } else if (status == FW_DEVICE_STATUS::READY_XFER) {
+        } else if (ep.status == FW_DEVICE_STATUS::READY_XFER) {
           break;
         }
       }
@@ -1242,14 +1382,141 @@ int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_stand
   }
 
 exit:
-  if (ret == 0 && status == FW_DEVICE_STATUS::READY_XFER)
+  if (ret == 0 && ep.status == FW_DEVICE_STATUS::READY_XFER) {
+    ep.status = FW_DEVICE_STATUS::ACTIVATE;
+    if (ep.verbose)
+      cout << "ActivateFirmwareComplete." << endl;
     ret = pldm_activate_firmware(sockfd, eid);
+  }
 
   if (ret < 0)
     pldm_cancel_update(sockfd, eid);
 
   close(sockfd);
-  close(file);
+  return ret;
+}
+
+static void
+pldm_set_transfer_limits(uint32_t max_transfer_size, uint8_t max_outstanding_req)
+{
+  maxTransferSize = max<uint32_t>(max_transfer_size, PLDM_FWUP_BASELINE_TRANSFER_SIZE);
+  maxOutstandingTransferReq = max<uint8_t>(max_outstanding_req, PLDM_FWUP_MIN_OUTSTANDING_REQ);
+}
+
+int oem_pldm_fw_update(uint8_t bus, uint8_t eid, const char* path, bool is_standard_descriptor, 
+    string component, int wait_apply_time, uint8_t specified_comp,
+    uint32_t max_transfer_size, uint8_t max_outstanding_req)
+{
+  fw_package_map pkg(path);
+  if (pldm_load_package(path, pkg) < 0) {
+    return -1;
+  }
+  pldm_set_transfer_limits(max_transfer_size, max_outstanding_req);
+
+  fw_endpoint_update ep;
+  ep.eid = eid;
+  if (pldm_select_component(bus, ep, is_standard_descriptor,
+                            component, specified_comp) < 0) {
+    return -1;
+  }
+
+  return pldm_update_endpoint(bus, ep, pkg, wait_apply_time);
+}
+
+static string
+pldm_update_progress(const vector<unique_ptr<fw_endpoint_update>>& eps)
+{
+  static const char* status_str[] = {
+    "Idle", "LearnComponents", "ReadyXfer", "Download", "Verify", "Apply", "Activate",
+  };
+  ostringstream os;
+
+  for (auto& ep : eps) {
+    os << "eid " << (int)ep->eid << ": ";
+    if (ep->done) {
+      os << (ep->ret == 0 ? "Done" : "Failed");
+    } else if (ep->status == FW_DEVICE_STATUS::DOWNLOAD) {
+      os << "Download " << max(ep->percent.load(), 0) << "%";
+    } else {
+      os << status_str[min<size_t>(ep->status, FW_DEVICE_STATUS::ACTIVATE)];
+    }
+    os << "  ";
+  }
+  return os.str();
+}
+
+int oem_pldm_fw_update_multi(uint8_t bus, const vector<uint8_t>& eids, const char* path,
+    bool is_standard_descriptor, string component, map<uint8_t, int>& results,
+    int wait_apply_time, uint8_t specified_comp,
+    uint32_t max_transfer_size, uint8_t max_outstanding_req)
+{
+  vector<unique_ptr<fw_endpoint_update>> eps;
+  vector<thread> threads;
+  mutex lock;
+  condition_variable cv;
+  size_t running = 0;
+  int ret = 0;
+
+  results.clear();
+  fw_package_map pkg(path);
+  if (pldm_load_package(path, pkg) < 0) {
+    return -1;
+  }
+  pldm_set_transfer_limits(max_transfer_size, max_outstanding_req);
+
+  // Each endpoint gets the component images of the package matching it.
+  for (auto eid : eids) {
+    if (results.count(eid) != 0) {
+      continue;
+    }
+    results[eid] = -1;
+    unique_ptr<fw_endpoint_update> ep(new fw_endpoint_update);
+    ep->eid = eid;
+    ep->verbose = false;
+    if (pldm_select_component(bus, *ep, is_standard_descriptor,
+                              component, specified_comp) < 0) {
+      cerr << "eid " << (int)eid << ": no component image to update." << endl;
+      continue;
+    }
+    eps.emplace_back(move(ep));
+  }
+
+  running = eps.size();
+  for (auto& ep : eps) {
+    threads.emplace_back([&, ep = ep.get()] {
+      int rc = pldm_update_endpoint(bus, *ep, pkg, wait_apply_time);
+      lock_guard<mutex> guard(lock);
+      ep->ret = rc;
+      ep->done = true;
+      --running;
+      cv.notify_all();
+    });
+  }
+
+  {
+    unique_lock<mutex> guard(lock);
+    while (running != 0) {
+      cv.wait_for(guard, chrono::seconds(1));
+      cout << "\r" << pldm_update_progress(eps) << flush;
+    }
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  if (!eps.empty()) {
+    cout << endl;
+  }
+
+  for (auto& ep : eps) {
+    results[ep->eid] = ep->ret;
+  }
+  for (auto& result : results) {
+    cout << "eid " << (int)result.first << ": "
+         << (result.second == 0 ? "Update Success." : "Update Failed.") << endl;
+    if (result.second != 0) {
+      ret = -1;
+    }
+  }
   return ret;
 }
 
@@ -23,6 +23,8 @@
 
 #define PLDM_CMD_QUERY_DOWNSTREAM_DEVICE_IDENTIFIERS 0x04
 #define PLDM_QUERY_DOWNSTREAM_DEVICE_IDENTIFIERS_WAIT_TIME_US 100000
+// Largest RequestFirmwareData the update agent offers by default.
+#define MAX_TRANSFER_SIZE 1024
 
 enum class TRANSFER_OPERATION_FLAG : uint8_t
 {
@@ -79,7 +81,15 @@ struct firmware_parameters {
 
 int oem_parse_pldm_package (const char *path);
 int oem_pldm_fw_update (uint8_t bus, uint8_t eid, const char *path, bool is_standard_descriptor, 
-    std::string component, int wait_apply_time = 0, uint8_t specified_comp = 0xFF);
+    std::string component, int wait_apply_time = 0, uint8_t specified_comp = 0xFF,
+    uint32_t max_transfer_size = MAX_TRANSFER_SIZE,
+    uint8_t max_outstanding_req = PLDM_FWUP_MIN_OUTSTANDING_REQ);
+// Update many endpoints with the same package at a time, results by eid.
+int oem_pldm_fw_update_multi (uint8_t bus, const std::vector<uint8_t>& eids,
+    const char *path, bool is_standard_descriptor, std::string component,
+    std::map<uint8_t, int>& results, int wait_apply_time = 0,
+    uint8_t specified_comp = 0xFF, uint32_t max_transfer_size = MAX_TRANSFER_SIZE,
+    uint8_t max_outstanding_req = PLDM_FWUP_MIN_OUTSTANDING_REQ);
 int pldm_get_firmware_parameters(uint8_t bus, uint8_t eid, 
     firmware_parameters& firmwareParameters);
 
@@ -55,7 +55,7 @@ void pldm_msg_handle (uint8_t payload_id, uint8_t* req, size_t req_size, uint8_t
   }
 }
 
-static int connect_to_socket (const char * path, int length) {
+int pldm_connect_socket (const char * path, int length) {
   int returnCode = 0;
   int sockfd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
 
@@ -189,28 +189,14 @@ int oem_pldm_recv (int eid, int pldmd_fd,
 int oem_pldm_send_recv (uint8_t bus, int eid,
                       const uint8_t *pldm_req_msg, size_t req_msg_len,
                       uint8_t **pldm_resp_msg, size_t *resp_msg_len) {
-  std::string path = "pldm-mux" + std::to_string(bus);
-  int pldmd_fd = connect_to_socket(path.c_str(), path.length());
+  oem_pldm_conn* conn = oem_pldm_conn_get(bus);
 
-  if (pldmd_fd < 0) {
+  if (conn == nullptr) {
     return PLDM_REQUESTER_OPEN_FAIL;
   }
 
-  auto rc = oem_pldm_send_recv_w_fd (eid, pldmd_fd,
-                                     pldm_req_msg, req_msg_len,
-                                     pldm_resp_msg, resp_msg_len);
-
-  oem_pldm_close(pldmd_fd);
-
-  if (rc != PLDM_REQUESTER_SUCCESS) {
-    return PLDM_ERROR_NOT_READY;
-  }
-
-  if(*resp_msg_len < PLDM_RESP_HEADER_SIZE)
-     return PLDM_ERROR_INVALID_LENGTH;
-
-  auto cc = *(*pldm_resp_msg+PLDM_RESP_HEADER_SIZE-1);
-  return cc ;
+  return oem_pldm_conn_send_recv(conn, eid, pldm_req_msg, req_msg_len,
+                                 pldm_resp_msg, resp_msg_len);
 }
 
 int oem_pldm_send_recv_w_fd (int eid, int pldmd_fd,
@@ -248,7 +234,7 @@ int oem_pldm_send_recv_w_fd (int eid, int pldmd_fd,
 
 int oem_pldm_init_fd (uint8_t bus) {
   std::string path = "pldm-mux" + std::to_string(bus);
-  int fd = connect_to_socket(path.c_str(), path.length());
+  int fd = pldm_connect_socket(path.c_str(), path.length());
   if (fd < 0) {
     return PLDM_REQUESTER_OPEN_FAIL;
   }
@@ -258,7 +244,7 @@ int oem_pldm_init_fd (uint8_t bus) {
 
 int oem_pldm_init_fwupdate_fd (uint8_t bus) {
   std::string path = "pldm-fwup-mux" + std::to_string(bus);
-  int fd = connect_to_socket(path.c_str(), path.length());
+  int fd = pldm_connect_socket(path.c_str(), path.length());
   if (fd < 0) {
     return PLDM_REQUESTER_OPEN_FAIL;
   }
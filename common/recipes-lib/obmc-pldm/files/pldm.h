@@ -61,6 +61,7 @@ int oem_pldm_recv (int eid, int pldmd_fd,
 /**
  * @brief Send a PLDM request message to PLDM Daemon. Wait for corresponding
           response message, which once received, is returned to the caller.
+          Uses the connection of the process to the bus, see oem_pldm_conn_get().
  *
  * @param[in]  bus           - bus number
  * @param[in]  eid           - destination MCTP eid
@@ -94,6 +95,66 @@ int oem_pldm_send_recv_w_fd (int eid, int pldmd_fd,
                         const uint8_t *pldm_req_msg, size_t req_msg_len,
                         uint8_t **pldm_resp_msg, size_t *resp_msg_len);
 
+/**
+ * @brief Persistent connection to PLDM daemon. Many requests, from any
+ *        thread, may be in flight over it at a time: responses are matched
+ *        to their request by eid and instance id. Reconnects by itself when
+ *        PLDM daemon is restarted.
+ */
+typedef struct oem_pldm_conn oem_pldm_conn;
+
+/**
+ * @brief Open a connection to PLDM daemon, or get the one of the process.
+ *        oem_pldm_send_recv() uses the latter, which must not be closed.
+ * @param[in]  bus           - bus number
+ *
+ * @return connection, NULL if PLDM daemon can't be connected.
+ */
+oem_pldm_conn* oem_pldm_conn_open (uint8_t bus);
+oem_pldm_conn* oem_pldm_conn_get (uint8_t bus);
+void oem_pldm_conn_close (oem_pldm_conn* conn);
+
+/**
+ * @brief Send a PLDM request message over a connection without waiting for
+ *        the response. The instance id of the request is replaced by one of
+ *        the connection, its response must be got by oem_pldm_conn_recv().
+ *
+ * @param[in]  conn          - connection
+ * @param[in]  eid           - destination MCTP eid
+ * @param[in]  pldm_req_msg  - caller owned pointer to PLDM request msg
+ * @param[in]  req_msg_len   - size of PLDM request msg
+ * @param[out] instance_id   - instance id the request was sent with
+ *
+ * @return pldm_requester_rc_t
+ */
+int oem_pldm_conn_send (oem_pldm_conn* conn, int eid,
+                        const uint8_t *pldm_req_msg, size_t req_msg_len,
+                        uint8_t *instance_id);
+
+/**
+ * @brief Wait for the response of a request sent by oem_pldm_conn_send().
+ *
+ * @param[in]  conn          - connection
+ * @param[in]  eid           - destination MCTP eid
+ * @param[in]  instance_id   - instance id the request was sent with
+ * @param[out] pldm_resp_msg - *pldm_resp_msg will point to PLDM response msg,
+ *                             this function allocates memory, caller to
+ *                             free(*pldm_resp_msg) on success.
+ * @param[out] resp_msg_len  - caller owned pointer that will be made point to
+ *                             the size of the PLDM response msg.
+ *
+ * @return pldm_requester_rc_t
+ */
+int oem_pldm_conn_recv (oem_pldm_conn* conn, int eid, uint8_t instance_id,
+                        uint8_t **pldm_resp_msg, size_t *resp_msg_len);
+
+/**
+ * @brief Same as oem_pldm_send_recv(), over a connection.
+ */
+int oem_pldm_conn_send_recv (oem_pldm_conn* conn, int eid,
+                             const uint8_t *pldm_req_msg, size_t req_msg_len,
+                             uint8_t **pldm_resp_msg, size_t *resp_msg_len);
+
 /**
  * @brief Init PLDM (firmware update) fd which connect to PLDM daemon.
  * @param[in]  bus           - bus number
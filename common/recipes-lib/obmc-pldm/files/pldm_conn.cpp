@@ -0,0 +1,295 @@
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <libpldm/base.h>
+#include <libpldm/pldm.h>
+#include "pldm.h"
+
+using namespace std::chrono;
+
+// Same as the receive timeout of the one-shot requests.
+const milliseconds PLDM_CONN_TIMEOUT(10000);
+
+// in pldm.cpp
+int pldm_connect_socket (const char * path, int length);
+
+/*
+ * A request in flight, by the instance id it was sent with. The PLDM daemon
+ * gives its own instance id to every request forwarded to the device, and
+ * restores ours in the response.
+ */
+struct pldm_conn_slot
+{
+  bool used = false;
+  bool done = false;
+  int eid = 0;
+  int rc = PLDM_REQUESTER_SUCCESS;
+  std::vector<uint8_t> resp;
+};
+
+struct oem_pldm_conn
+{
+  uint8_t bus = 0;
+  int fd = -1;
+  pid_t pid = 0;
+  std::mutex lock;
+  std::condition_variable cv;
+  bool reading = false;  // one waiting thread receives for all of them
+  uint8_t last_iid = 0;
+  std::array<pldm_conn_slot, 32> slots;
+};
+
+static int conn_connect (oem_pldm_conn* conn)
+{
+  std::string path = "pldm-mux" + std::to_string(conn->bus);
+  conn->fd = pldm_connect_socket(path.c_str(), path.length());
+  conn->pid = getpid();
+  return conn->fd;
+}
+
+// Connection lost: fail all the requests in flight, reconnect on next send.
+static void conn_fail (oem_pldm_conn* conn)
+{
+  if (conn->fd >= 0) {
+    close(conn->fd);
+    conn->fd = -1;
+  }
+  for (auto& slot : conn->slots) {
+    if (slot.used && !slot.done) {
+      slot.done = true;
+      slot.rc = PLDM_REQUESTER_RECV_FAIL;
+    }
+  }
+  conn->cv.notify_all();
+}
+
+// Receive one message and hand it to its request, called without the lock.
+static int conn_read (int fd, int timeout_ms, std::vector<uint8_t>& msg)
+{
+  struct pollfd pfd = {fd, POLLIN, 0};
+  int rc = poll(&pfd, 1, timeout_ms);
+  if (rc <= 0) {
+    return (rc < 0 && errno != EINTR) ? -1 : 0;
+  }
+
+  ssize_t length = recv(fd, NULL, 0, MSG_PEEK | MSG_TRUNC);
+  if (length <= 0) {
+    return -1;
+  }
+  msg.resize(length);
+  if (recv(fd, msg.data(), length, 0) != length) {
+    return -1;
+  }
+  return 1;
+}
+
+static void conn_dispatch (oem_pldm_conn* conn, std::vector<uint8_t>& msg)
+{
+  size_t prefix_len = 2;  // eid + mctp message type
+  if (msg.size() < prefix_len + sizeof(struct pldm_msg_hdr) ||
+      msg[1] != MCTP_PLDM_TYPE) {
+    return;
+  }
+
+  auto hdr = reinterpret_cast<struct pldm_msg_hdr*>(msg.data() + prefix_len);
+  auto& slot = conn->slots[hdr->instance_id];
+  if (hdr->request != PLDM_RESPONSE || !slot.used || slot.done ||
+      slot.eid != msg[0]) {
+    return;  // late response of a request given up
+  }
+  slot.resp.assign(msg.begin() + prefix_len, msg.end());
+  slot.rc = PLDM_REQUESTER_SUCCESS;
+  slot.done = true;
+}
+
+oem_pldm_conn* oem_pldm_conn_open (uint8_t bus)
+{
+  auto conn = new oem_pldm_conn;
+  conn->bus = bus;
+  if (conn_connect(conn) < 0) {
+    delete conn;
+    return nullptr;
+  }
+  return conn;
+}
+
+void oem_pldm_conn_close (oem_pldm_conn* conn)
+{
+  if (conn == nullptr) {
+    return;
+  }
+  if (conn->fd >= 0) {
+    close(conn->fd);
+  }
+  delete conn;
+}
+
+int oem_pldm_conn_send (oem_pldm_conn* conn, int eid,
+                        const uint8_t *pldm_req_msg, size_t req_msg_len,
+                        uint8_t *instance_id)
+{
+  auto hdr = (const struct pldm_msg_hdr *)pldm_req_msg;
+  if (req_msg_len < sizeof(struct pldm_msg_hdr) ||
+      (hdr->request != PLDM_REQUEST &&
+       hdr->request != PLDM_ASYNC_REQUEST_NOTIFY)) {
+    return PLDM_REQUESTER_NOT_REQ_MSG;
+  }
+
+  std::unique_lock<std::mutex> lock(conn->lock);
+
+  // Reconnect after a failure, or in a child process.  The requests in
+  // flight are the parent's, a child starts over with all ids free.
+  if (conn->fd >= 0 && conn->pid != getpid()) {
+    close(conn->fd);
+    conn->fd = -1;
+    conn->slots.fill(pldm_conn_slot{});
+    conn->reading = false;
+    conn->last_iid = 0;
+  }
+  if (conn->fd < 0 && conn_connect(conn) < 0) {
+    return PLDM_REQUESTER_OPEN_FAIL;
+  }
+
+  // Take instance ids in turn, so a late response hardly finds a new request.
+  uint8_t iid = conn->last_iid;
+  size_t i;
+  for (i = 0; i < conn->slots.size(); i++) {
+    iid = (iid + 1) % conn->slots.size();
+    if (!conn->slots[iid].used) {
+      break;
+    }
+  }
+  if (i == conn->slots.size()) {
+    return PLDM_REQUESTER_SEND_FAIL;
+  }
+  conn->last_iid = iid;
+
+  uint8_t prefix[3] = {(uint8_t)eid, MCTP_PLDM_TYPE, pldm_req_msg[0]};
+  reinterpret_cast<struct pldm_msg_hdr*>(prefix + 2)->instance_id = iid;
+
+  struct iovec iov[2];
+  iov[0].iov_base = prefix;
+  iov[0].iov_len = sizeof(prefix);
+  iov[1].iov_base = (uint8_t *)pldm_req_msg + 1;
+  iov[1].iov_len = req_msg_len - 1;
+
+  struct msghdr msg = {};
+  msg.msg_iov = iov;
+  msg.msg_iovlen = sizeof(iov) / sizeof(iov[0]);
+
+  if (sendmsg(conn->fd, &msg, MSG_NOSIGNAL) < 0) {
+    // Let the receiving thread find out and close the connection.
+    if (conn->reading) {
+      shutdown(conn->fd, SHUT_RDWR);
+      return PLDM_REQUESTER_SEND_FAIL;
+    }
+    // The daemon may have been restarted, try once more.
+    conn_fail(conn);
+    if (conn_connect(conn) < 0 || sendmsg(conn->fd, &msg, MSG_NOSIGNAL) < 0) {
+      return PLDM_REQUESTER_SEND_FAIL;
+    }
+  }
+
+  auto& slot = conn->slots[iid];
+  slot.used = true;
+  slot.done = false;
+  slot.eid = eid;
+  slot.resp.clear();
+  *instance_id = iid;
+  return PLDM_REQUESTER_SUCCESS;
+}
+
+int oem_pldm_conn_recv (oem_pldm_conn* conn, int eid, uint8_t instance_id,
+                        uint8_t **pldm_resp_msg, size_t *resp_msg_len)
+{
+  std::unique_lock<std::mutex> lock(conn->lock);
+  if (instance_id >= conn->slots.size() ||
+      !conn->slots[instance_id].used || conn->slots[instance_id].eid != eid) {
+    return PLDM_REQUESTER_RECV_FAIL;
+  }
+
+  auto& slot = conn->slots[instance_id];
+  auto deadline = steady_clock::now() + PLDM_CONN_TIMEOUT;
+  std::vector<uint8_t> msg;
+
+  while (!slot.done) {
+    auto left = duration_cast<milliseconds>(deadline - steady_clock::now());
+    if (left.count() <= 0) {
+      slot.done = true;
+      slot.rc = PLDM_REQUESTER_RECV_FAIL;
+      break;
+    }
+    if (conn->reading) {
+      conn->cv.wait_until(lock, deadline);
+      continue;
+    }
+
+    // Receive for every thread waiting, until our response comes.
+    conn->reading = true;
+    int fd = conn->fd;
+    lock.unlock();
+    int rc = conn_read(fd, left.count(), msg);
+    lock.lock();
+    conn->reading = false;
+    if (rc < 0) {
+      conn_fail(conn);
+    } else if (rc > 0) {
+      conn_dispatch(conn, msg);
+    }
+    conn->cv.notify_all();
+  }
+
+  int rc = slot.rc;
+  if (rc == PLDM_REQUESTER_SUCCESS) {
+    *pldm_resp_msg = (uint8_t *)malloc(slot.resp.size());
+    memcpy(*pldm_resp_msg, slot.resp.data(), slot.resp.size());
+    *resp_msg_len = slot.resp.size();
+  }
+  slot.used = false;
+  slot.resp.clear();
+  return rc;
+}
+
+int oem_pldm_conn_send_recv (oem_pldm_conn* conn, int eid,
+                             const uint8_t *pldm_req_msg, size_t req_msg_len,
+                             uint8_t **pldm_resp_msg, size_t *resp_msg_len)
+{
+  uint8_t iid = 0;
+  int rc = oem_pldm_conn_send(conn, eid, pldm_req_msg, req_msg_len, &iid);
+  if (rc == PLDM_REQUESTER_SUCCESS) {
+    rc = oem_pldm_conn_recv(conn, eid, iid, pldm_resp_msg, resp_msg_len);
+  }
+  if (rc != PLDM_REQUESTER_SUCCESS) {
+    return PLDM_ERROR_NOT_READY;
+  }
+
+  if (*resp_msg_len < PLDM_RESP_HEADER_SIZE) {
+    free(*pldm_resp_msg);
+    *pldm_resp_msg = nullptr;
+    return PLDM_ERROR_INVALID_LENGTH;
+  }
+
+  return *(*pldm_resp_msg + PLDM_RESP_HEADER_SIZE - 1);
+}
+
+// One connection per bus, shared by all the threads of the process.
+oem_pldm_conn* oem_pldm_conn_get (uint8_t bus)
+{
+  static std::mutex lock;
+  static std::map<uint8_t, oem_pldm_conn*> conns;
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto& conn = conns[bus];
+  if (conn == nullptr) {
+    conn = oem_pldm_conn_open(bus);
+  }
+  return conn;
+}
@@ -117,6 +117,16 @@ bool BicFwComponent::is_recovery() {
   return false;
 }
 
+// A runtime BIC update only talks to the BICs of the slot, through the
+// IPMB bus of the slot, so the slots can be updated at the same time.
+// Recovery goes through the UART muxes and is not done concurrently.
+string BicFwComponent::update_resource() {
+  if (is_recovery()) {
+    return Component::update_resource();
+  }
+  return fru();
+}
+
 int BicFwComponent::update_internal(const string& image, bool force) {
   int ret = FW_STATUS_FAILURE;
   char cmd[MAX_CMD_LEN] = {0};
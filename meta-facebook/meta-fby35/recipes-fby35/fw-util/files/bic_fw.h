@@ -40,6 +40,7 @@ class BicFwComponent : public Component {
     int get_version(json& j) override;
     bool is_recovery();
     int get_slot_id() { return slot_id; };
+    std::string update_resource() override;
 };
 
 class PldmBicFwComponent : public PldmComponent, public BicFwComponent {
@@ -54,6 +55,8 @@ class PldmBicFwComponent : public PldmComponent, public BicFwComponent {
     int try_pldm_update(const std::string& /*image*/, bool /*force*/, uint8_t specified_comp = 0xFF);
     int update(string /*image*/) override;
     int fupdate(string /*image*/) override;
+    // The PLDM package is parsed into library globals.
+    std::string update_resource() override { return PldmComponent::update_resource(); }
 };
 
 #endif
\ No newline at end of file
@@ -1074,6 +1074,44 @@ int SwbPLDMNicComponent::update(string image)
   return ret;
 }
 
+int SwbPLDMNicGroupComponent::update(string image)
+{
+  int ret = 0;
+  auto& sensors = pldm_signed_info::swb_nic_t;
+  vector<uint8_t> eids{};
+  map<uint8_t, int> results{};
+
+  for (auto& [key, eid] : _nics) {
+    if (sensors.find(key) == sensors.end()) {
+      std::cerr << "Nic card key error, unable to disable bic polling." << std::endl;
+      return -1;
+    }
+  }
+
+  syslog(LOG_CRIT, "Component %s upgrade initiated", _component.c_str());
+
+  //Since NIC PLDM update need to take more than 10 minutes, we extend the timeout.
+  set_update_ongoing(60 * 20);
+  for (auto& [key, eid] : _nics) {
+    bic_sensor_polling_enabled(sensors.at(key), false);
+    eids.push_back(eid);
+  }
+  ret = oem_pldm_fw_update_multi(_bus_id, eids, image.c_str(), false,
+                                 _component, results, 600);
+  for (auto& [key, eid] : _nics) {
+    bic_sensor_polling_enabled(sensors.at(key), true);
+    syslog(LOG_CRIT, "Component %s upgrade %s", key.c_str(),
+           results[eid] ? "fail" : "completed");
+  }
+
+  if (ret)
+    syslog(LOG_CRIT, "Component %s upgrade fail", _component.c_str());
+  else
+    syslog(LOG_CRIT, "Component %s upgrade completed", _component.c_str());
+
+  return ret;
+}
+
 int
 cb_bic_recovery_pre() {
   // Set CB BIC boot from UART through CB CPLD
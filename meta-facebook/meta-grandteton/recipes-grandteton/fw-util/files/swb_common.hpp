@@ -172,6 +172,18 @@ class SwbPLDMNicComponent : public PLDMNicComponent {
     int update(string /*image*/) override;
 };
 
+// Updates all the SWB NICs with the same package at a time.
+class SwbPLDMNicGroupComponent : public Component {
+  protected:
+    uint8_t _bus_id;
+    vector<pair<string, uint8_t>> _nics;  // version key, eid
+  public:
+    SwbPLDMNicGroupComponent(const string& fru, const string& comp, uint8_t bus,
+                             const vector<pair<string, uint8_t>>& nics):
+      Component(fru, comp), _bus_id(bus), _nics(nics) {}
+    int update(string /*image*/) override;
+};
+
 //Artemis VR Component
 class GTAVrComponent : public GTSwbVrComponent {
   public:
@@ -9,5 +9,8 @@ SwbPLDMNicComponent swb_nic4("swb", "swb_nic4", "SWB_NIC4", 0x14, SWB_BUS_ID);
 SwbPLDMNicComponent swb_nic5("swb", "swb_nic5", "SWB_NIC5", 0x15, SWB_BUS_ID);
 SwbPLDMNicComponent swb_nic6("swb", "swb_nic6", "SWB_NIC6", 0x16, SWB_BUS_ID);
 SwbPLDMNicComponent swb_nic7("swb", "swb_nic7", "SWB_NIC7", 0x17, SWB_BUS_ID);
+SwbPLDMNicGroupComponent swb_nics("swb", "swb_nics", SWB_BUS_ID, {
+  {"SWB_NIC0", 0x10}, {"SWB_NIC1", 0x11}, {"SWB_NIC2", 0x12}, {"SWB_NIC3", 0x13},
+  {"SWB_NIC4", 0x14}, {"SWB_NIC5", 0x15}, {"SWB_NIC6", 0x16}, {"SWB_NIC7", 0x17}});
 
 